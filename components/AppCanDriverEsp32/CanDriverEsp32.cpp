@@ -24,7 +24,14 @@
 #include "driver/twai.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "CanFilter.h"
 #include "lemca/isobus_message.h"
+#include "lemca/pgn_dispatch.h"
+#include "lemca/common/spsc_ring.h"
 
 #define USE_APP_OUTPUT
 #if defined(USE_APP_OUTPUT)
@@ -40,17 +47,218 @@ static void HW_CanMsgPrint(uint8_t canNode_u8, twai_message_t* twai_msg_ps, uint
 #define RX_GPIO_NUM             4
 
 static const twai_timing_config_t t_config = TWAI_TIMING_CONFIG_250KBITS();
-static const twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+static twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
 //static const twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT((gpio_num_t)TX_GPIO_NUM, (gpio_num_t)RX_GPIO_NUM, CAN_MODE_NORMAL);
 static const twai_general_config_t g_config = {.mode = TWAI_MODE_NORMAL,
                                               .tx_io = (gpio_num_t)TX_GPIO_NUM, .rx_io = (gpio_num_t)RX_GPIO_NUM,
                                               .clkout_io = (gpio_num_t)TWAI_IO_UNUSED, .bus_off_io = (gpio_num_t)TWAI_IO_UNUSED,
                                               .tx_queue_len = 150, .rx_queue_len = 1000,
-                                              .alerts_enabled = TWAI_ALERT_NONE,
+                                              .alerts_enabled = TWAI_ALERT_RX_DATA | TWAI_ALERT_RX_QUEUE_FULL | TWAI_ALERT_BUS_ERROR | TWAI_ALERT_BUS_OFF,
                                               .clkout_divider = 0,
 											  .intr_flags = ESP_INTR_FLAG_LEVEL1};
 
 
+/* ################### CAN receive task ################ */
+
+/* The RX task blocks on the driver alerts, drains the TWAI queue, stamps each
+   frame and hands it to the ISOBUS loop through a lock-free ring. */
+#define CAN_RX_RING_SIZE        512     /* power of 2 */
+#define CAN_RX_TASK_CORE        0
+#define CAN_RX_TASK_PRIORITY    12
+#define CAN_RX_TASK_STACK       3072
+#define CAN_RX_ALERT_WAIT_MS    20      /* max delay to park the task for a filter reload */
+
+typedef struct
+{
+   twai_message_t msg;
+   int64_t        timestamp_us;
+} CanRxFrame_t;
+
+static CanRxFrame_t s_rxRingBuf[CAN_RX_RING_SIZE];
+static SpscRing     s_rxRing;
+static TaskHandle_t s_rxTask = NULL;
+
+static uint32_t s_rxReceived_u32 = 0u;
+static uint32_t s_rxQueueFull_u32 = 0u;
+static uint32_t s_busErrors_u32 = 0u;
+static uint32_t s_busOff_u32 = 0u;
+
+/* frames lost by the filter reloads, and the driver counters of the previous
+   installs (they restart at 0 with each twai_driver_install) */
+static uint32_t s_reloadRxDropped_u32 = 0u;
+static uint32_t s_reloadTxDropped_u32 = 0u;
+static uint32_t s_missedBase_u32 = 0u;
+static uint32_t s_overrunBase_u32 = 0u;
+
+/* The driver must be reinstalled to change the acceptance filter: the RX task
+   is parked outside of the driver calls while the main task does it. */
+static volatile uint8_t s_rxParkReq_u8 = 0u;
+static SemaphoreHandle_t s_rxParked = NULL;
+static SemaphoreHandle_t s_rxResume = NULL;
+
+static void CanRxTask(void* arg)
+{
+   (void)arg;
+   for (;;)
+   {
+      if (s_rxParkReq_u8 != 0u)
+      {
+         xSemaphoreGive(s_rxParked);
+         xSemaphoreTake(s_rxResume, portMAX_DELAY);
+         continue;
+      }
+
+      uint32_t alerts_u32 = 0u;
+      if (twai_read_alerts(&alerts_u32, CAN_RX_ALERT_WAIT_MS / portTICK_PERIOD_MS) != ESP_OK)
+      {
+         continue;
+      }
+
+      if (alerts_u32 & TWAI_ALERT_RX_QUEUE_FULL)
+      {
+         s_rxQueueFull_u32++;
+      }
+      if (alerts_u32 & TWAI_ALERT_BUS_ERROR)
+      {
+         s_busErrors_u32++;
+      }
+      if (alerts_u32 & TWAI_ALERT_BUS_OFF)
+      {
+         s_busOff_u32++;
+      }
+
+      if (alerts_u32 & (TWAI_ALERT_RX_DATA | TWAI_ALERT_RX_QUEUE_FULL))
+      {
+         CanRxFrame_t frame;
+         while (twai_receive(&frame.msg, 0) == ESP_OK)
+         {
+            frame.timestamp_us = esp_timer_get_time();
+            s_rxReceived_u32++;
+            (void)spsc_ring_push(&s_rxRing, &frame, 1u);
+         }
+      }
+   }
+}
+
+/* ################### CAN acceptance filter ################ */
+
+/* PGNs consumed by the ISOBUS stack, the application ones come from
+   pgn_dispatch_get_pgns(). PDU1 PGNs are accepted for the global address
+   and the own address.
+   Add the PGNs of the file server / sequence control clients if they are used. */
+static const uint32_t s_stackPgns_au32[] =
+{
+   PGN_ADDRESS_CLAIMED,
+   PGN_REQUEST_PGN,
+   PGN_N_ACK,
+   PGN_TP_CM,
+   PGN_TP_DT,
+   PGN_ETP_CM,
+   PGN_ETP_DT,
+   PGN_VTtoECU,
+   PGN_ECUtoVT,            /* auxiliary input status of other working sets */
+   PGN_PROCESS_DATA,
+   PGN_LANGUAGE_COMMAND,
+   PGN_WHEEL_BASED_SPEED,  /* see AppImpl_AL2() */
+};
+
+static CanFilterPlan_t s_filterPlan = { 0xFEu, 0u, 0u, 1uL << 18 };
+static uint32_t s_filterReloads_u32 = 0u;
+
+/* The TWAI driver of IDF 4.4 takes the acceptance filter only in
+   twai_driver_install(): there is no call to change it on a running driver,
+   and the ACR/AMR registers are only writable in reset mode, which the driver
+   enters at install only (the HAL context is private to the driver). So the
+   driver is stopped and installed again:
+   - the pending TX frames get 10 ticks to leave, the rest is discarded by
+     twai_stop() and counted in reloadTxDropped_u32
+   - the RX queue is moved to the ring after twai_stop(), while the RX task is
+     parked, so only what is left in it is lost (reloadRxDropped_u32)
+   - frames on the bus during the reinstall itself (a few 100 us) are missed */
+static void CanFilterReload(const twai_filter_config_t* filter_ps)
+{
+   twai_status_info_t twaistatus_info;
+   CanRxFrame_t frame;
+
+   /* let the pending frames (e.g. the address claim) leave */
+   for (uint8_t wait_u8 = 0u; wait_u8 < 10u; wait_u8++)
+   {
+      if ((twai_get_status_info(&twaistatus_info) != ESP_OK) || (twaistatus_info.msgs_to_tx == 0u))
+      {
+         break;
+      }
+      vTaskDelay(1);
+   }
+
+   s_rxParkReq_u8 = 1u;
+   xSemaphoreTake(s_rxParked, portMAX_DELAY);
+
+   if (twai_get_status_info(&twaistatus_info) == ESP_OK)
+   {
+      s_reloadTxDropped_u32 += twaistatus_info.msgs_to_tx;
+   }
+   ESP_ERROR_CHECK(twai_stop());
+
+   /* the RX task is parked: this task is the only producer of the ring */
+   while (twai_receive(&frame.msg, 0) == ESP_OK)
+   {
+      frame.timestamp_us = esp_timer_get_time();
+      s_rxReceived_u32++;
+      (void)spsc_ring_push(&s_rxRing, &frame, 1u);
+   }
+   if (twai_get_status_info(&twaistatus_info) == ESP_OK)
+   {
+      s_reloadRxDropped_u32 += twaistatus_info.msgs_to_rx;
+      s_missedBase_u32 += twaistatus_info.rx_missed_count;
+      s_overrunBase_u32 += twaistatus_info.rx_overrun_count;
+   }
+
+   f_config = *filter_ps;
+   ESP_ERROR_CHECK(twai_driver_uninstall());
+   ESP_ERROR_CHECK(twai_driver_install(&g_config, &t_config, &f_config));
+   ESP_ERROR_CHECK(twai_start());
+   s_filterReloads_u32++;
+
+   s_rxParkReq_u8 = 0u;
+   xSemaphoreGive(s_rxResume);
+}
+
+void hw_CanFilterUpdate(uint8_t sa_u8)
+{
+   uint32_t pgns_au32[CAN_FILTER_MAX_PGNS];
+   uint8_t  numPgns_u8 = sizeof(s_stackPgns_au32) / sizeof(s_stackPgns_au32[0]);
+   twai_filter_config_t filter;
+   CanFilterPlan_t plan;
+
+   if ((sa_u8 == 0xFEu) && (s_filterPlan.sa_u8 != 0xFEu))
+   {  /* logout or address conflict: the filter of the old address passes the
+         address claim and the global PGNs, the next address reloads it.
+         No reinstall in the middle of the claim. */
+      hw_DebugPrint("*** can filter SA %02X kept at logout\n", s_filterPlan.sa_u8);
+      return;
+   }
+
+   for (uint8_t i_u8 = 0u; i_u8 < numPgns_u8; i_u8++)
+   {
+      pgns_au32[i_u8] = s_stackPgns_au32[i_u8];
+   }
+   numPgns_u8 += pgn_dispatch_get_pgns(&pgns_au32[numPgns_u8], CAN_FILTER_MAX_PGNS - numPgns_u8);
+
+   CanFilterPlan(pgns_au32, numPgns_u8, sa_u8, &filter, &plan);
+   if ((filter.acceptance_code == f_config.acceptance_code) && (filter.acceptance_mask == f_config.acceptance_mask)
+       && (filter.single_filter == f_config.single_filter))
+   {
+      s_filterPlan = plan;
+      return;
+   }
+
+   CanFilterReload(&filter);
+   s_filterPlan = plan;
+   hw_DebugPrint("*** can filter SA %02X %s code %08X mask %08X accepts %u/%u ids\n",
+      sa_u8, (plan.dual_u8 != 0u) ? "dual" : "single", filter.acceptance_code, filter.acceptance_mask,
+      plan.acceptedKeys_u32, 1u << 18);
+}
+
 /* ################### CAN Functions ################ */
 
 #if !defined(CCI_CAN_API)  // the implementation is not required if CAN is out sourced into a DLL
@@ -63,10 +271,22 @@ void hw_CanInit(uint8_t maxCanNodes_u8)
 
     ESP_ERROR_CHECK(twai_start());
     ESP_LOGI(CANBUS_TAG, "Driver started");
+
+    spsc_ring_init(&s_rxRing, s_rxRingBuf, sizeof(CanRxFrame_t), CAN_RX_RING_SIZE);
+    s_rxParked = xSemaphoreCreateBinary();
+    s_rxResume = xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(CanRxTask, "can_rx", CAN_RX_TASK_STACK, NULL,
+                            CAN_RX_TASK_PRIORITY, &s_rxTask, CAN_RX_TASK_CORE);
 }
 
 void hw_CanClose(void)
 {
+    if (s_rxTask != NULL)
+    {
+       vTaskDelete(s_rxTask);
+       s_rxTask = NULL;
+    }
+
     //Uninstall CAN driver
     ESP_ERROR_CHECK(twai_stop());
     ESP_LOGI(CANBUS_TAG, "Driver stopped");
@@ -91,6 +311,15 @@ int16_t hw_CanSendMsg(uint8_t canNode_u8, uint32_t canId_u32, const uint8_t canD
 	   twai_msg_send.data[iLoop] = canData_au8[iLoop];
    }
 
+   if (CAN_IS_BULK_FRAME(canId_u32))
+   {
+      twai_status_info_t twaistatus_info;
+      if ((twai_get_status_info(&twaistatus_info) == ESP_OK) && (twaistatus_info.msgs_to_tx >= CAN_TX_BULK_MAX))
+      {
+         return -6; /* E_OVERFLOW, not an error: the transfer waits for the queue */
+      }
+   }
+
    esp_err_t ok_can    = ESP_OK;
 
    ok_can 		= twai_transmit(&twai_msg_send, 0);
@@ -115,15 +344,14 @@ int16_t hw_CanSendMsg(uint8_t canNode_u8, uint32_t canId_u32, const uint8_t canD
 
 int16_t hw_CanReadMsg(uint8_t canNode_u8, uint32_t *canId_pu32, uint8_t canData_pau8[], uint8_t *canDataLength_pu8)
 {
-   twai_message_t twai_msg_read;
-   esp_err_t err = ESP_FAIL;
+   CanRxFrame_t frame;
 
-	err = twai_receive(&twai_msg_read, 0);
-   if (err == ESP_OK)
+   if (spsc_ring_pop(&s_rxRing, &frame, 1u) == 1u)
    {
+      twai_message_t &twai_msg_read = frame.msg;
       if (twai_msg_read.identifier != 0xCCCCCCCCuL)
       {
-         onIsobusMessage(canNode_u8, &twai_msg_read, 1u);
+         onIsobusMessage(canNode_u8, &twai_msg_read, 1u, frame.timestamp_us);
          HW_CanMsgPrint(canNode_u8, &twai_msg_read, 1u);
          *canId_pu32 = twai_msg_read.identifier;
          *canDataLength_pu8 = twai_msg_read.data_length_code;
@@ -151,6 +379,56 @@ int16_t hw_CanGetFreeSendMsgBufferSize(uint8_t canNode_u8) {
 	return a + b;
 }
 
+void hw_CanGetRxStats(CanRxStats_t* stats_ps)
+{
+   twai_status_info_t twaistatus_info;
+
+   stats_ps->received_u32 = s_rxReceived_u32;
+   stats_ps->ringDropped_u32 = s_rxRing.dropped;
+   stats_ps->ringHighWater_u32 = s_rxRing.high_water;
+   stats_ps->queueFull_u32 = s_rxQueueFull_u32;
+   stats_ps->busErrors_u32 = s_busErrors_u32;
+   stats_ps->busOff_u32 = s_busOff_u32;
+   stats_ps->filterReloads_u32 = s_filterReloads_u32;
+   stats_ps->reloadRxDropped_u32 = s_reloadRxDropped_u32;
+   stats_ps->reloadTxDropped_u32 = s_reloadTxDropped_u32;
+   stats_ps->driverMissed_u32 = s_missedBase_u32;
+   stats_ps->driverOverrun_u32 = s_overrunBase_u32;
+   if (twai_get_status_info(&twaistatus_info) == ESP_OK)
+   {
+      stats_ps->driverMissed_u32 += twaistatus_info.rx_missed_count;
+      stats_ps->driverOverrun_u32 += twaistatus_info.rx_overrun_count;
+   }
+}
+
+/* The controller does not count the frames rejected by the acceptance filter:
+   the received rate is printed with the share of the identifier space the
+   filter lets through. */
+void hw_CanPrintRxStats(void)
+{
+   static uint32_t lastReceived_u32 = 0u;
+   static int64_t  lastTime_us = 0;
+   CanRxStats_t stats;
+   hw_CanGetRxStats(&stats);
+
+   int64_t now_us = esp_timer_get_time();
+   uint32_t fps_u32 = 0u;
+   if ((lastTime_us != 0) && (now_us > lastTime_us))
+   {
+      fps_u32 = (uint32_t)(((int64_t)(stats.received_u32 - lastReceived_u32) * 1000000) / (now_us - lastTime_us));
+   }
+   lastReceived_u32 = stats.received_u32;
+   lastTime_us = now_us;
+   hw_DebugPrint("*** can rx %u frames/s, filter SA %02X %s accepts %u/%u ids, %u reloads lost rx %u tx %u\n",
+      fps_u32, s_filterPlan.sa_u8, (s_filterPlan.dual_u8 != 0u) ? "dual" : "single",
+      s_filterPlan.acceptedKeys_u32, 1u << 18, stats.filterReloads_u32,
+      stats.reloadRxDropped_u32, stats.reloadTxDropped_u32);
+   hw_DebugPrint("*** can rx %u ring dropped %u high water %u/%u queue full %u missed %u overrun %u bus errors %u bus off %u\n",
+      stats.received_u32, stats.ringDropped_u32, stats.ringHighWater_u32, CAN_RX_RING_SIZE,
+      stats.queueFull_u32, stats.driverMissed_u32, stats.driverOverrun_u32,
+      stats.busErrors_u32, stats.busOff_u32);
+}
+
 static void HW_CanMsgPrint(uint8_t canNode_u8, twai_message_t* twai_msg_ps, uint8_t isRX)
 {
    return; //disable CANPrint.
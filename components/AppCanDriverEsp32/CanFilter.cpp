@@ -0,0 +1,173 @@
+/* ************************************************************************ */
+/*!
+   \file
+   \brief      TWAI acceptance filter planner
+   \par        History:
+   \par
+   - created: acceptance code and mask computed from the consumed PGNs
+*/
+/* ************************************************************************ */
+
+#include "CanFilter.h"
+
+/* ************************************************************************ */
+/* A frame is described by its 18 bit key = ID[25:8] (EDP, DP, PF, PS).
+   Priority ID[28:26] and source address ID[7:0] are never compared.
+
+   Single filter: the 29 bit ID is in code/mask bits 31..3, RTR in bit 2.
+   Dual filters (extended frames): only ID[28:13] is compared, filter 1 in
+   bits 31..16 and filter 2 in bits 15..0, so PS[4:0] is always don't care.
+   A mask bit set to 1 is don't care. */
+
+#define KEY_BITS           18u
+#define KEY_MASK           0x3FFFFuL
+#define DUAL_KEY_SHIFT     5u       /* ID[12:8] not seen by the dual filters */
+#define PRIO_MASK          0x7uL
+#define PF_PDU2            0xF0u
+#define DA_GLOBAL          0xFFu
+#define SA_NULL            0xFEu
+#define MAX_KEYS           (2u * CAN_FILTER_MAX_PGNS)
+
+static uint8_t CanFilterBits(uint32_t value_u32)
+{
+   uint8_t bits_u8 = 0u;
+   while (value_u32 != 0u)
+   {
+      value_u32 &= value_u32 - 1u;
+      bits_u8++;
+   }
+   return bits_u8;
+}
+
+static uint8_t CanFilterAddKey(uint32_t keys_au32[], uint8_t numKeys_u8, uint32_t key_u32)
+{
+   for (uint8_t i_u8 = 0u; i_u8 < numKeys_u8; i_u8++)
+   {
+      if (keys_au32[i_u8] == key_u32)
+      {
+         return numKeys_u8;
+      }
+   }
+   keys_au32[numKeys_u8] = key_u32;
+   return numKeys_u8 + 1u;
+}
+
+/* Accepted keys of a dual filter matching every key of a group */
+static uint32_t CanFilterDualCost(uint32_t diff_u32, uint8_t used_u8)
+{
+   return (used_u8 != 0u) ? (1uL << (CanFilterBits(diff_u32) + DUAL_KEY_SHIFT)) : 0uL;
+}
+
+static void CanFilterAcceptAll(twai_filter_config_t* config_ps, CanFilterPlan_t* plan_ps)
+{
+   config_ps->acceptance_code = 0uL;
+   config_ps->acceptance_mask = 0xFFFFFFFFuL;
+   config_ps->single_filter = true;
+   plan_ps->dual_u8 = 0u;
+   plan_ps->acceptedKeys_u32 = 1uL << KEY_BITS;
+}
+
+void CanFilterPlan(const uint32_t pgns_au32[], uint8_t numPgns_u8, uint8_t sa_u8,
+                   twai_filter_config_t* config_ps, CanFilterPlan_t* plan_ps)
+{
+   uint32_t keys_au32[MAX_KEYS];
+   uint8_t  numKeys_u8 = 0u;
+
+   plan_ps->sa_u8 = sa_u8;
+   plan_ps->numKeys_u8 = 0u;
+   if ((sa_u8 >= SA_NULL) || (numPgns_u8 == 0u) || (numPgns_u8 > CAN_FILTER_MAX_PGNS))
+   {  /* address claim in progress: keep all frames */
+      CanFilterAcceptAll(config_ps, plan_ps);
+      return;
+   }
+
+   for (uint8_t i_u8 = 0u; i_u8 < numPgns_u8; i_u8++)
+   {
+      uint32_t key_u32 = pgns_au32[i_u8] & KEY_MASK;
+      if (((key_u32 >> 8u) & 0xFFu) < PF_PDU2)
+      {  /* PDU1: PS is the destination address */
+         key_u32 &= ~0xFFuL;
+         numKeys_u8 = CanFilterAddKey(keys_au32, numKeys_u8, key_u32 | DA_GLOBAL);
+         numKeys_u8 = CanFilterAddKey(keys_au32, numKeys_u8, key_u32 | sa_u8);
+      }
+      else
+      {
+         numKeys_u8 = CanFilterAddKey(keys_au32, numKeys_u8, key_u32);
+      }
+   }
+   plan_ps->numKeys_u8 = numKeys_u8;
+
+   /* single filter: every bit differing between two keys is don't care */
+   uint32_t diff_u32 = 0uL;
+   for (uint8_t i_u8 = 1u; i_u8 < numKeys_u8; i_u8++)
+   {
+      diff_u32 |= keys_au32[i_u8] ^ keys_au32[0];
+   }
+   uint32_t singleCost_u32 = 1uL << CanFilterBits(diff_u32);
+
+   /* dual filters: split the 13 bit keys in two groups, each group seeded
+      by a key and given the keys nearer to its seed (Hamming distance) */
+   uint32_t dualKeys_au32[MAX_KEYS];
+   uint8_t  numDual_u8 = 0u;
+   for (uint8_t i_u8 = 0u; i_u8 < numKeys_u8; i_u8++)
+   {
+      numDual_u8 = CanFilterAddKey(dualKeys_au32, numDual_u8, keys_au32[i_u8] >> DUAL_KEY_SHIFT);
+   }
+
+   uint32_t dualCost_u32 = 0xFFFFFFFFuL;
+   uint32_t refA_u32 = 0uL, diffA_u32 = 0uL, refB_u32 = 0uL, diffB_u32 = 0uL;
+   for (uint8_t a_u8 = 0u; a_u8 < numDual_u8; a_u8++)
+   {
+      for (uint8_t b_u8 = a_u8; b_u8 < numDual_u8; b_u8++)
+      {
+         uint32_t seedA_u32 = dualKeys_au32[a_u8];
+         uint32_t seedB_u32 = dualKeys_au32[b_u8];
+         uint32_t dA_u32 = 0uL, dB_u32 = 0uL;
+         uint8_t  usedB_u8 = 0u;
+         for (uint8_t k_u8 = 0u; k_u8 < numDual_u8; k_u8++)
+         {
+            uint32_t key_u32 = dualKeys_au32[k_u8];
+            if (CanFilterBits(key_u32 ^ seedA_u32) <= CanFilterBits(key_u32 ^ seedB_u32))
+            {
+               dA_u32 |= key_u32 ^ seedA_u32;
+            }
+            else
+            {
+               dB_u32 |= key_u32 ^ seedB_u32;
+               usedB_u8 = 1u;
+            }
+         }
+         uint32_t cost_u32 = CanFilterDualCost(dA_u32, 1u) + CanFilterDualCost(dB_u32, usedB_u8);
+         if (cost_u32 < dualCost_u32)
+         {
+            dualCost_u32 = cost_u32;
+            refA_u32 = seedA_u32;
+            diffA_u32 = dA_u32;
+            /* an unused second filter repeats the first one */
+            refB_u32 = (usedB_u8 != 0u) ? seedB_u32 : seedA_u32;
+            diffB_u32 = (usedB_u8 != 0u) ? dB_u32 : dA_u32;
+         }
+      }
+   }
+
+   if (dualCost_u32 < singleCost_u32)
+   {
+      uint32_t maskA_u32 = (PRIO_MASK << 13u) | diffA_u32;
+      uint32_t maskB_u32 = (PRIO_MASK << 13u) | diffB_u32;
+      config_ps->acceptance_code = (refA_u32 << 16u) | refB_u32;
+      config_ps->acceptance_mask = (maskA_u32 << 16u) | maskB_u32;
+      config_ps->single_filter = false;
+      plan_ps->dual_u8 = 1u;
+      plan_ps->acceptedKeys_u32 = dualCost_u32;
+   }
+   else
+   {
+      uint32_t id_u32 = keys_au32[0] << 8u;
+      uint32_t idMask_u32 = (PRIO_MASK << 26u) | (diff_u32 << 8u) | 0xFFuL;
+      config_ps->acceptance_code = id_u32 << 3u;
+      config_ps->acceptance_mask = (idMask_u32 << 3u) | 0x7uL; /* RTR and unused bits */
+      config_ps->single_filter = true;
+      plan_ps->dual_u8 = 0u;
+      plan_ps->acceptedKeys_u32 = singleCost_u32;
+   }
+}
@@ -0,0 +1,35 @@
+/* ************************************************************************ */
+/*!
+   \file
+   \brief      TWAI acceptance filter planner
+   \par        History:
+   \par
+   - created: acceptance code and mask computed from the consumed PGNs
+*/
+/* ************************************************************************ */
+
+#ifndef COMPONENTS_APPCANDRIVERESP32_CANFILTER_H_
+#define COMPONENTS_APPCANDRIVERESP32_CANFILTER_H_
+
+#include <stdint.h>
+#include "driver/twai.h"
+
+/* Maximum number of PGNs given to the planner */
+#define CAN_FILTER_MAX_PGNS      32u
+
+typedef struct
+{
+   uint8_t  sa_u8;            /* own source address the plan was made for */
+   uint8_t  dual_u8;          /* 1 = dual 16 bit filters, 0 = single 32 bit filter */
+   uint8_t  numKeys_u8;       /* PGN/DA combinations to accept */
+   uint32_t acceptedKeys_u32; /* DP/PF/PS combinations passing the filter (out of 2^18) */
+} CanFilterPlan_t;
+
+/* Computes the tightest acceptance code/mask passing every extended frame
+   with one of the given PGNs. PDU1 PGNs are accepted for the global address
+   and for sa_u8. Priority and source address are always don't care.
+   With sa_u8 >= 0xFE (no address claimed yet) everything is accepted. */
+void CanFilterPlan(const uint32_t pgns_au32[], uint8_t numPgns_u8, uint8_t sa_u8,
+                   twai_filter_config_t* config_ps, CanFilterPlan_t* plan_ps);
+
+#endif /* COMPONENTS_APPCANDRIVERESP32_CANFILTER_H_ */
@@ -24,12 +24,15 @@
 #include "AppHW.h"
 #include "Settings/settings.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #if defined(_WIN32) && defined(linux)
 #error _WIN32 and linux can not defined at the same time!!!
 #endif 
 
 #ifdef ESP_PLATFORM
+#include <fcntl.h>
+#include <unistd.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "sdkconfig.h"
@@ -172,11 +175,23 @@ void hw_LogError(const char_t format[], ...)
    va_end(args);
 }
 
+static hw_TimeSource_t m_TimeSource_pf = esp_timer_get_time;
+
+void hw_SetTimeSource(hw_TimeSource_t timeSource_pf)
+{
+   m_TimeSource_pf = (timeSource_pf != NULL) ? timeSource_pf : esp_timer_get_time;
+}
+
+int64_t hw_GetTimeUs(void)
+{
+   return m_TimeSource_pf();
+}
+
 int32_t hw_GetTimeMs(void)
 {
-    uint32_t tt = esp_log_timestamp();
-	iso_s32 timeInMilliseconds = tt;
-	return timeInMilliseconds;
+   /* same clock as hw_GetTimeUs(), iso_s32 wraps after 24 days as before */
+   iso_s32 timeInMilliseconds = (iso_s32)(m_TimeSource_pf() / 1000);
+   return timeInMilliseconds;
 }
 
 
@@ -372,10 +387,35 @@ void hw_SimDoSleep(uint32_t milliseconds)
 }
 
 /* ************************************************************************ */
+#ifdef ESP_PLATFORM
+/* the console (UART0) is read without blocking the ISOBUS loop: one
+   character read ahead by hw_SimGetKbHit() for hw_SimGetCharEx() */
+static int_t s_consoleChar = -1;
+static uint8_t s_consoleNonBlock_u8 = 0u;
+#endif // def ESP_PLATFORM
+
 int_t hw_SimGetKbHit(void)
 {
 #if defined(_WIN32)
    return _kbhit();
+#elif defined(ESP_PLATFORM)
+   if (s_consoleNonBlock_u8 == 0u)
+   {
+      (void)fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+      s_consoleNonBlock_u8 = 1u;
+   }
+   if (s_consoleChar < 0)
+   {
+      uint8_t c_u8;
+      if (read(STDIN_FILENO, &c_u8, 1u) == 1)
+      {
+         s_consoleChar = c_u8;
+      }
+   }
+   return (s_consoleChar >= 0) ? 1 : 0;
+#elif defined(linux)
+   int n = 0;
+   return ((ioctl(STDIN_FILENO, FIONREAD, &n) == 0) && (n > 0)) ? 1 : 0;
 #else 
     return 0;
 #endif 
@@ -392,6 +432,20 @@ int_t hw_SimGetCharEx(uint8_t noEcho)
       ch = (noEcho == 1u) ? _getch() : _getche();
    }
    return ch;
+#elif defined(ESP_PLATFORM)
+   int_t ch = s_consoleChar;
+   (void)noEcho;   /* the monitor echoes locally */
+   if (ch < 0)
+   {
+      (void)hw_SimGetKbHit();
+      ch = s_consoleChar;
+   }
+   s_consoleChar = -1;
+   return (ch < 0) ? 0 : ch;
+#elif defined(linux)
+   int_t ch = getchar();
+   (void)noEcho;   /* line buffered terminal, the echo is the terminal's */
+   return (ch == EOF) ? 0 : ch;
 #else // _WIN32
     return 0;
 #endif // def _WIN32
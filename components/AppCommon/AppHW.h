@@ -71,6 +71,12 @@ extern "C" {
    void     hw_vDebugTrace(const char_t format[], va_list args); 
 
    int32_t  hw_GetTimeMs(void);
+   int64_t  hw_GetTimeUs(void);
+
+   /* time source of hw_GetTimeMs() and hw_GetTimeUs(), in us since start,
+      NULL = esp_timer_get_time(). The host simulation installs a virtual clock. */
+   typedef int64_t (*hw_TimeSource_t)(void);
+   void     hw_SetTimeSource(hw_TimeSource_t timeSource_pf);
 
 #if !defined(CCI_CAN_API)   // the declaration is not required if CAN is out sourced into a DLL
    void     hw_CanInit(uint8_t maxCanNodes_u8);
@@ -78,6 +84,34 @@ extern "C" {
    int16_t  hw_CanSendMsg(uint8_t canNode_u8, uint32_t canId_u32, const uint8_t canData_au8[], uint8_t canDataLength_u8);
    int16_t  hw_CanReadMsg(uint8_t canNode_u8, uint32_t *canId_pu32, uint8_t canData_pau8[], uint8_t *canDataLength_pu8);
    int16_t  hw_CanGetFreeSendMsgBufferSize(uint8_t canNode_u8);
+
+   /* TP.DT and ETP.DT frames (pool upload, DDOP, long VT commands) are refused
+      with E_OVERFLOW while CAN_TX_BULK_MAX frames wait in the TX queue, so a
+      VT command queued behind a transfer waits ~20 ms at 250 kbit/s, not the
+      whole queue. The transport protocols send them again on the next loop. */
+   #define CAN_TX_BULK_MAX          32
+   #define CAN_IS_BULK_FRAME(id)    ((((id) >> 16) & 0xFFu) == 0xEBu || (((id) >> 16) & 0xFFu) == 0xC7u)
+
+   typedef struct
+   {
+      uint32_t received_u32;       /* frames taken from the driver queue */
+      uint32_t ringDropped_u32;    /* frames lost because the RX ring was full */
+      uint32_t ringHighWater_u32;  /* max frames waiting in the RX ring */
+      uint32_t queueFull_u32;      /* driver RX queue full alerts */
+      uint32_t driverMissed_u32;   /* frames lost by the driver (queue full) */
+      uint32_t driverOverrun_u32;  /* frames lost by the controller (RX FIFO overrun) */
+      uint32_t busErrors_u32;
+      uint32_t busOff_u32;
+      uint32_t filterReloads_u32;  /* acceptance filter changes (driver reinstalled) */
+      uint32_t reloadRxDropped_u32;/* RX frames discarded by the filter reloads */
+      uint32_t reloadTxDropped_u32;/* TX frames discarded by the filter reloads */
+   } CanRxStats_t;
+
+   void     hw_CanGetRxStats(CanRxStats_t* stats_ps);
+   void     hw_CanPrintRxStats(void);
+   /* programs the acceptance filter for the claimed source address,
+      0xFE (logout) keeps the filter of the last address */
+   void     hw_CanFilterUpdate(uint8_t sa_u8);
 #endif // !defined(CCI_CAN_API) 
 
    void     hw_SimDoSleep(uint32_t milliseconds);
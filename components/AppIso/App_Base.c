@@ -28,6 +28,7 @@
 #endif /* defined(ISO_CLIENT_NETWORK_DISTRIBUTOR) */
 
 #include "SerialNumber.h"
+#include "lemca/speed/speed.h"
 
 #define SA_PREFERRED     0x8Cu      // Preferred source address of CF
 
@@ -80,6 +81,12 @@ void AppImpl_doProcess()
    if( q_Ignition )
    {
       // Cyclic e. g. setting of PGNs 
+#if defined(_LAY10_) /* TC client enabled */
+      // distance integrated from the arbitrated speed (ground, GNSS or wheel)
+      SpeedData speed;
+      speed_get(&speed, hw_GetTimeUs());
+      IsoTC_SetDistance(speed.distance_mm);
+#endif /* defined(_LAY10_) */
    }
 }
 
@@ -174,6 +181,9 @@ static void CbIsoNetwork(const ISONETEVENT_T* psNetEv)
                      }
                 }
                 
+                // only the PGNs sent to this address or to all pass the CAN controller
+                hw_CanFilterUpdate(psNetEv->u8SAMember);
+
                 if( psNetEv->eNetEvent == Isonet_MemberActive )
                 {  // Initialise PGNs e. g. diagnostic interface
                    AppImpl_AL2();
@@ -182,6 +192,7 @@ static void CbIsoNetwork(const ISONETEVENT_T* psNetEv)
              case Isonet_MemberAddressConflict:
              case Isonet_MemberInactive:              // logout
                 s16NmHandImp1 = HANDLE_UNVALID;        
+                hw_CanFilterUpdate(0xFEu);
                 break;
              case Isonet_MemberAddressViolation:  
                 // Part 5 - 4.4.4.3: set diagnostic trouble code with SPN=2000 + SA and FMI=31
@@ -310,11 +321,7 @@ static void CbPGNReceiveWheelbasedSpeed(const PGNDAT_T* psData)
 #if defined(_LAY78_)
    if (psData->qTimedOut == ISO_FALSE)
    {
-#if defined(_LAY10_) /* TC client enabled */
-      iso_u32 u32DatVal2 = 0uL;
-      iso_SpnDataReadCom(16, 32, psData->pau8Data, &u32DatVal2);
-      IsoTC_SetDistance(u32DatVal2);      // Giving distance to TC client
-#endif /* defined(_LAY10_) */
+      // speed and distance are taken from lemca/speed, see AppImpl_doProcess()
    }
    else
    {
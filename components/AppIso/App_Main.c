@@ -34,6 +34,10 @@
 #include "lemca/uart/my_uart.h"
 #include "lemca/lemca.h"
 #include "lemca/gpio.h"
+#include "lemca/control_task.h"
+#include "lemca/isobus_message.h"
+#include "lemca/adc/adc_calib.h"
+#include "lemca/valve/valve_map.h"
 
 /* **************************  function declarations  ********************* */
 
@@ -66,6 +70,9 @@ static void Do_ReceiveCanMessages(void);
 
 /* **************************  const data initialization ****************** */
 
+/* Frames are already buffered by the CAN RX task, drain them in bulk */
+#define CAN_RX_MAX_PER_CYCLE  250u
+
 /* **************************  module global data  ************************ */
 
 iso_bool b__AppRuning = ISO_TRUE;
@@ -100,23 +107,24 @@ int isobus_main(int_t argc, char_t* argv[])
    }
 #endif 
 
+   /* tractor PGN handlers, before the first frame is read */
+   isobus_message_init();
    /* Initialize ISOBUS library and samples */
    AppIso_Init();
    uart_init();
    setup_gpio();
+   /* hydraulic control runs on its own task (core 1), this loop stays on core 0 */
+   control_task_start();
    /* sample main loop */
    while (hw_PowerSwitchIsOn() && (b__AppRuning == ISO_TRUE))
    {
-      lemca_loop();
       /* run cyclic application function */
       AppIso_Cyclic();
-      lemca_loop();
 
       uart_loop();
       lemca_loop();
 
       hw_SimDoSleep(ISO_NM_LOOPTIME);  // Simulate loop time "5ms"
-      lemca_loop();
       
       DoKeyBoard();
    }
@@ -271,7 +279,7 @@ static void Do_ReceiveCanMessages(void)
             msgCount++;
          }
       } /* end for */
-   } while ((msgFound == ISO_TRUE) && (msgCount <= 40u));
+   } while ((msgFound == ISO_TRUE) && (msgCount < CAN_RX_MAX_PER_CYCLE));
 }
 /*! [Do_ReceiveCanMessages] */
 
@@ -287,9 +295,17 @@ static void PrintKeyBoard(void)
    hw_DebugPrint("5 - VT - Pool reload\n");
    hw_DebugPrint("6 - VT - Move to another VT\n");
    hw_DebugPrint("7 - \n");
-   hw_DebugPrint("8 - \n\n");
+   hw_DebugPrint("8 - \n");
+   hw_DebugPrint("c - Sensors - Teach-in 0 %%\n");
+   hw_DebugPrint("v - Sensors - Teach-in 50 %%\n");
+   hw_DebugPrint("b - Sensors - Teach-in 100 %%\n");
+   hw_DebugPrint("x - Sensors - Clear calibration\n");
+   hw_DebugPrint("p - Sensors - Print calibration and valve maps\n");
+   hw_DebugPrint("t - Control - Autotune angle and height\n\n");
    hw_DebugPrint("h - Help \n");
+#if !defined(ESP_PLATFORM)
    hw_DebugPrint("q - Quit\n\n");
+#endif /* !defined(ESP_PLATFORM) */
 
 }
 
@@ -335,13 +351,40 @@ static void DoKeyBoard(void)
          hw_DebugPrint("8 - \n"); 
          break;
 #endif /* defined(_LAY10_) */
+      case 'c':
+         hw_DebugPrint("c - Teach-in 0 %%\n");
+         adc_calib_teach_all(Q16_FROM_INT(0));
+         break;
+      case 'v':
+         hw_DebugPrint("v - Teach-in 50 %%\n");
+         adc_calib_teach_all(Q16_FROM_INT(50));
+         break;
+      case 'b':
+         hw_DebugPrint("b - Teach-in 100 %%\n");
+         adc_calib_teach_all(Q16_FROM_INT(100));
+         break;
+      case 'x':
+         hw_DebugPrint("x - Clear calibration\n");
+         adc_calib_clear_all();
+         break;
+      case 'p':
+         adc_calib_print();
+         valve_map_print();
+         break;
+      case 't':
+         hw_DebugPrint("t - Autotune\n");
+         startAutotune();
+         break;
       case 'h':
          PrintKeyBoard();
          break;
+#if !defined(ESP_PLATFORM)
+      /* the console of the target stays on the serial monitor: no quit */
       case 'q':
          hw_DebugPrint("quit \n");
          b__AppRuning = ISO_FALSE;
          break;
+#endif /* !defined(ESP_PLATFORM) */
       default: break;
       }
    }
@@ -27,6 +27,7 @@
 #include "App_VTClient.h"
 #include "VIEngine.h"
 #include "App_VTClientLev2.h"
+#include "lemca/vt/vt_shadow.h"
 
 #include "MyProject1.iop.h"
 #include "MyProject1.c.h"
@@ -36,6 +37,7 @@
 
 #endif /* defined(CCI_USE_POOLBUFFER) */
 #include "AppPool/AppPool.h"
+#include "AppPool/PoolPartition.h"
 
 #if defined(_LAY6_) && defined(ISO_VTC_GRAPHIC_AUX)
 #include "../Samples/VtcWithAuxPoolUpload/GAux.h"
@@ -191,6 +193,8 @@ static void CbVtConnCtrl(const ISOVT_EVENT_DATA_T* psEvData)
       /* fall through */
       /* no break */
    case IsoEvMaskPoolReloadFinished:
+      /* objects back to the values of the pool */
+      vt_shadow_invalidate();
       if (u8_poolChannel > 0u)
       {
          poolFree(u8_poolChannel);
@@ -261,17 +265,27 @@ static void AppPoolSettings(const ISOVT_EVENT_DATA_T* psEvData, iso_u8* pu8PoolC
    if (*pu8PoolChannel > 0)
    {  // clean-up a previously open pool.
       poolFree(*pu8PoolChannel);  
+      *pu8PoolChannel = 0U;
    }
 
+   // pool partition mapped in the flash cache: uploaded in place, no pool channel
+   pu8PoolData = poolPartitionMap(POOL_PARTITION_LABEL, &u32PoolSize);
+   if (pu8PoolData != 0)
+   {
+      *pu8PoolChannel = 0U;
+   }
+   else
+   {
 #if !defined(CCI_USE_POOLBUFFER)
-   *pu8PoolChannel = poolLoadByFilename(POOL_FILENAME);
+      *pu8PoolChannel = poolLoadByFilename(POOL_FILENAME);
 #else // !defined(CCI_USE_POOLBUFFER)
-   *pu8PoolChannel = poolLoadByByteArray((iso_u8*)&pool_iop[0], sizeof(pool_iop));
+      *pu8PoolChannel = poolLoadByByteArray((iso_u8*)&pool_iop[0], sizeof(pool_iop));
 #endif // !defined(CCI_USE_POOLBUFFER)
 
-   poolOpen(*pu8PoolChannel, colour_256); // open a complete pool for a 256 colour VT
-   u32PoolSize = (uint32_t)poolGetSize(*pu8PoolChannel);
-   pu8PoolData = poolGetData(*pu8PoolChannel);
+      poolOpen(*pu8PoolChannel, colour_256); // open a complete pool for a 256 colour VT
+      u32PoolSize = (uint32_t)poolGetSize(*pu8PoolChannel);
+      pu8PoolData = poolGetData(*pu8PoolChannel);
+   }
 
    IsoVtcPoolLoad(psEvData->u8Instance, (iso_u8 *)ISO_VERSION_LABEL, // Instance, Version,
       ISO_DESIGNATOR_WIDTH, ISO_DESIGNATOR_HEIGHT, ISO_MASK_SIZE,                                 // SKM width and height, DM res.
@@ -389,6 +403,11 @@ static void CbVtMessages( const ISOVT_MSG_STA_T * pIsoMsgSta )
       // Receiving string see Page 3
       //VTC_process_VT_change_string_value(pIsoMsgSta);
       break;
+   case change_numeric_value :
+   case change_string_value :
+      /* response of the VT to a value command of vt_queue.c */
+      vt_shadow_response(pIsoMsgSta->wObjectID, pIsoMsgSta->iErrorCode);
+      break;
    case auxiliary_assign_type_1 :
        break;
    case auxiliary_assign_type_2 :
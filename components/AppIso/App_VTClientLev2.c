@@ -29,12 +29,29 @@
 #include "AppCommon/AppHW.h"
 
 #include "lemca/lemca.h"
+#include "lemca/vt/vt_shadow.h"
+#include "lemca/vt/vt_queue.h"
+#include "lemca/common/fmt.h"
 #include "AppIso/config.h"
 
 #define BEACON_PIN 6
 #define WORKLIGHT_PIN 7
 #define REVERSE_PIN 8
 
+// min interval between two commands of an object, updateVTC() runs at 10 Hz
+#define VT_BARS_MIN_MS 100
+#define VT_STATE_MIN_MS 500
+#define VT_SPEED_MIN_MS 500
+// unchanged values sent again
+#define VT_REFRESH_MS 5000
+// CAN frames of cyclic VT commands per loop (5 ms), ~20 % of 250 kbit/s
+#define VT_FRAMES_DEFAULT 2
+#define VT_FRAMES_MAX CAN_TX_BULK_MAX
+// CAN tx buffers left to the rest of the stack (TC, pool upload), below the
+// 150 buffers of the ESP driver
+#define VT_TX_RESERVE_DEFAULT 8
+#define VT_TX_RESERVE_MAX 100
+
 
 //********************************************************************************************
 // Each command has several Unique Features. here they are encapsulated !
@@ -100,6 +117,8 @@ void VTC_setPoolManipulation(const ISOVT_EVENT_DATA_T* psEvData)
 
 iso_s8 vtc_instance = 0;
 
+static void updateVTCFeedback();
+
 void VTC_handleSoftkeysAndButtons_RELEASED(const struct ButtonActivation_S *pButtonData) {
 	// what button was released
 	switch (pButtonData->objectIdOfButtonObject) {
@@ -140,51 +159,98 @@ void VTC_handleSoftkeysAndButtons_RELEASED(const struct ButtonActivation_S *pBut
 		default:
 			break;
 	}
+	updateVTCFeedback();
 
 	vtc_instance = pButtonData->u8Instance;
 	//updateVTC();
 }
 
 enum State last_state = State_off;
+// "work a 12.3 h -4.5", without printf (fmt.h)
+static void formatState(FmtBuf * f){
+	enum State state = getState();
+	if(state == State_off){
+		fmt_str(f, "off");
+	} else if(state == State_autotune){
+		fmt_str(f, "tune ");
+		fmt_str(f, getAutotuneAxis() == 0 ? "a " : "h ");
+		fmt_int(f, getAutotuneProgress(), FMT_INT);
+		fmt_str(f, " %");
+	} else {
+		if(state == State_time){
+			fmt_str(f, "time a ");
+		} else if(state == State_up){
+			fmt_str(f, "up a ");
+		} else {
+			fmt_str(f, "work a ");
+		}
+		fmt_q16(f, getCorrAngQ16(), FMT_DEC1);
+		fmt_str(f, " h ");
+		fmt_q16(f, getCorrHQ16(), FMT_DEC1);
+	}
+	last_state = state;
+}
+
+static void formatSpeed(FmtBuf * f){
+	int speed_10 = getSpeedKmH10();
+	if(speed_10 < 0){
+		fmt_str(f, "--");
+	} else {
+		fmt_int(f, speed_10, FMT_DEC1);
+	}
+	fmt_str(f, " km/h");
+}
+
+// answer to a button, before the cyclic values
+static void updateVTCFeedback(){
+	if(vtc_instance == 0){
+		return;
+	}
+	uint32_t now_ms = (uint32_t)hw_GetTimeMs();
+	char state[VT_QUEUE_STRING_MAX];
+	FmtBuf f;
+	fmt_init(&f, state, sizeof(state));
+	formatState(&f);
+	vt_shadow_string(StringVariable_State, state, VtPriority_feedback, now_ms);
+	vt_shadow_numeric(work_h, getWorkHeight(), VtPriority_feedback, now_ms);
+}
+
 void updateVTC(){
 	if(vtc_instance == 0){
 		return;
 	}
 
 	//hw_DebugPrint("updateVTC\n");
-	double speed = getSpeedKmH();
-	char data[30];
-	sprintf(data,"%.1f km/h", speed);
+	uint32_t now_ms = (uint32_t)hw_GetTimeMs();
+	// the strings are only formatted when they can be sent
+	char data[VT_QUEUE_STRING_MAX];
+	FmtBuf f;
+	if(vt_shadow_due(StringVariable_State, now_ms)){
+		fmt_init(&f, data, sizeof(data));
+		formatState(&f);
+		vt_shadow_string(StringVariable_State, data, VtPriority_cosmetic, now_ms);
+	}
 
-	enum State state = getState();
-	char data2[30];
-	double coor_a = getCorrAng();
-	double coor_h = getCorrH();
-	if(state == State_off){
-		sprintf(data2,"off");
-	} else if(state == State_time){
-		sprintf(data2,"time a %.1f h %.1f", coor_a, coor_h);
-	} else if(state == State_up){
-		sprintf(data2,"up a %.1f h %.1f", coor_a, coor_h);
-	} else if(state == State_work){
-		sprintf(data2,"work a %.1f h %.1f", coor_a, coor_h);
+	if(vt_shadow_due(StringVariable_Vitesse, now_ms)){
+		fmt_init(&f, data, sizeof(data));
+		formatSpeed(&f);
+		vt_shadow_string(StringVariable_Vitesse, data, VtPriority_cosmetic, now_ms);
 	}
-	last_state = state;
-	IsoVtcCmd_String(vtc_instance, StringVariable_State, (iso_u8 *)data2);
-
-    IsoVtcCmd_String(vtc_instance, StringVariable_Vitesse, (iso_u8 *)data);
-	IsoVtcCmd_NumericValue(vtc_instance, aggress_hyd_21000, getAgressHyd());
-	IsoVtcCmd_NumericValue(vtc_instance, NumberVariable_Left, getLastLeft());
-	IsoVtcCmd_NumericValue(vtc_instance, NumberVariable_Right, getLastRight());
-	IsoVtcCmd_NumericValue(vtc_instance, work_h, getWorkHeight());
-	IsoVtcCmd_NumericValue(vtc_instance, NumberVariable_v_max_ang, getVitesseMaxAng());
-	IsoVtcCmd_NumericValue(vtc_instance, NumberVariable_v_max_h, getVitesseMaxH());
+
+	vt_shadow_numeric(NumberVariable_Left, getLastLeft(), VtPriority_cyclic, now_ms);
+	vt_shadow_numeric(NumberVariable_Right, getLastRight(), VtPriority_cyclic, now_ms);
+	vt_shadow_numeric(aggress_hyd_21000, getAgressHyd(), VtPriority_cyclic, now_ms);
+	vt_shadow_numeric(work_h, getWorkHeight(), VtPriority_cyclic, now_ms);
+	vt_shadow_numeric(NumberVariable_v_max_ang, getVitesseMaxAng(), VtPriority_cyclic, now_ms);
+	vt_shadow_numeric(NumberVariable_v_max_h, getVitesseMaxH(), VtPriority_cyclic, now_ms);
 	//ESP_LOGI("lemca", "updateVTC");
 }
 
 void VTC_handleNumericValues(const struct InputNumber_S * pInputNumberData) {
 	// what number was entered
 	hw_DebugPrint("VTC_handleNumericValues %d %d\n", pInputNumberData->objectIdOfInputNumber, pInputNumberData->newValue);
+	// already displayed by the VT, not sent back
+	vt_shadow_set_known(pInputNumberData->objectIdOfInputNumber, pInputNumberData->newValue);
 	switch (pInputNumberData->objectIdOfInputNumber) {
 		case aggress_hyd_21000:
 			setAgressHyd(pInputNumberData->newValue);
@@ -214,6 +280,22 @@ void VTC_setNewVT(const ISOVT_EVENT_DATA_T* psEvData)
 void VTC_setPoolReady(const ISOVT_EVENT_DATA_T* psEvData)
 {
 	vtc_instance = psEvData->u8Instance;
+	// the queue takes uint8_t
+	int32_t frames = getS32("LEMCA", "VT_FRAMES", VT_FRAMES_DEFAULT);
+	int32_t tx_reserve = getS32("LEMCA", "VT_TX_RESERVE", VT_TX_RESERVE_DEFAULT);
+	frames = frames < 1 ? 1 : (frames > VT_FRAMES_MAX ? VT_FRAMES_MAX : frames);
+	tx_reserve = tx_reserve < 0 ? 0 : (tx_reserve > VT_TX_RESERVE_MAX ? VT_TX_RESERVE_MAX : tx_reserve);
+	vt_queue_init(vtc_instance, (uint8_t)frames, (uint8_t)tx_reserve);
+	// the VT shows the values of the pool
+	vt_shadow_init();
+	vt_shadow_add(StringVariable_State, VT_STATE_MIN_MS, VT_REFRESH_MS);
+	vt_shadow_add(StringVariable_Vitesse, VT_SPEED_MIN_MS, VT_REFRESH_MS);
+	vt_shadow_add(NumberVariable_Left, VT_BARS_MIN_MS, VT_REFRESH_MS);
+	vt_shadow_add(NumberVariable_Right, VT_BARS_MIN_MS, VT_REFRESH_MS);
+	vt_shadow_add(aggress_hyd_21000, 0, VT_REFRESH_MS);
+	vt_shadow_add(work_h, 0, VT_REFRESH_MS);
+	vt_shadow_add(NumberVariable_v_max_ang, 0, VT_REFRESH_MS);
+	vt_shadow_add(NumberVariable_v_max_h, 0, VT_REFRESH_MS);
 	//updateVTC();
 }
 
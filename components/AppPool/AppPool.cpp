@@ -3,8 +3,10 @@
 
 /* ************************************************************************ */
 #include <stdint.h> // malloc
+#include <stdio.h>
 #include <string.h>
 #include <map>
+#include <utility>
 #include <IsoCommonDef.h>
 #include <IsoVtcApi.h>
 #include "AppPool.h"
@@ -220,22 +222,10 @@ static std::vector<uint8_t> getDataFromFile(const char* fileName)
    return data;
 }
 
-static std::vector<uint8_t> getDataFromMemory(const uint8_t* poolData, uint32_t poolSize)
-{
-   std::vector<uint8_t> data;
-
-   if ((poolData != nullptr) && (poolSize > 0))
-   {
-      data.resize(poolSize);
-      memcpy(data.data(), poolData, poolSize);
-   }
-
-   return data;
-}
-
 AppPool::AppPool(const uint8_t* data, uint32_t dataSize)
-   : AppPool(getDataFromMemory(data, dataSize))
+   : m_pool()
 {
+   setPool(PoolView(data, dataSize));
 }
 
 AppPool::AppPool(const char* fileName)
@@ -243,9 +233,19 @@ AppPool::AppPool(const char* fileName)
 {
 }
 
-AppPool::AppPool(const std::vector<uint8_t>& data) 
+AppPool::AppPool(std::vector<uint8_t>&& data) 
    : m_pool()
    // TODO m_mode(0U),
+{
+   m_pool[POOL::ALL].buffer = std::move(data);
+   setPool(PoolView(m_pool[POOL::ALL].buffer));
+   if (m_pool[POOL::ALL].numObj == 0U)
+   {  /* not a pool: release the buffer */
+      std::vector<uint8_t>().swap(m_pool[POOL::ALL].buffer);
+   }
+}
+
+void AppPool::setPool(PoolView data)
 {
    if (data.empty())
    {
@@ -345,19 +345,20 @@ uint32_t AppPool::read(uint8_t* dst, uint32_t u32BlockSizeReq)
 #endif /* !defined(CCI_USE_ARCHIVE) */
 }
 
-const std::vector<uint8_t>& AppPool::getOriginalPool() const
+PoolView AppPool::getOriginalPool() const
 {
    return m_pool[POOL::ALL].data;
 }
 
-const std::vector<uint8_t>& AppPool::getOpenPool() const
+PoolView AppPool::getOpenPool() const
 {
    return m_pool[POOL::ALL].data;
 }
 
 void AppPool::close()
 {
-   m_pool[POOL::ALL].data.clear();
+   m_pool[POOL::ALL].data = PoolView();
+   std::vector<uint8_t>().swap(m_pool[POOL::ALL].buffer);   /* clear() keeps the capacity */
 }
 
 bool AppPool::isOpen()const
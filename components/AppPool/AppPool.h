@@ -56,18 +56,41 @@ uint32_t poolGetMaxObjectSize(uint8_t channel);
 
 #ifdef __cplusplus
 
+/* Non-owning view of pool data: the buffer of an AppPool, or memory which
+   outlives the pool channel (pool_iop[] with CCI_USE_POOLBUFFER, flash). */
+class PoolView
+{
+public:
+   PoolView() = default;
+   PoolView(const uint8_t* data, uint32_t size) : m_data(data), m_size((data != nullptr) ? size : 0U) {}
+   PoolView(const std::vector<uint8_t>& data) : m_data(data.data()), m_size(static_cast<uint32_t>(data.size())) {}
+
+   const uint8_t* data() const { return m_data; }
+   uint32_t size() const { return m_size; }
+   bool empty() const { return m_size == 0U; }
+   const uint8_t& operator[](uint32_t idx) const { return m_data[idx]; }
+   const uint8_t* begin() const { return m_data; }
+   const uint8_t* end() const { return m_data + m_size; }
+
+private:
+   const uint8_t* m_data = nullptr;
+   uint32_t m_size = 0U;
+};
+
 class AppPool
 {
 public:
 // TODO	static const uint32_t MODE_READ = 1U;
 
-   AppPool(const uint8_t* data, uint32_t dataSize);
+   AppPool(const uint8_t* data, uint32_t dataSize);   /* not copied: data must stay valid until the pool is freed */
    AppPool(const char* fileName);
-   AppPool(const std::vector<uint8_t>& data);
+   AppPool(std::vector<uint8_t>&& data);
+   AppPool(const AppPool&) = delete;                  /* the view may point into the own buffer */
+   AppPool& operator=(const AppPool&) = delete;
    ~AppPool();
 
-   const std::vector<uint8_t>& getOriginalPool() const;
-   const std::vector<uint8_t>& getOpenPool() const;
+   PoolView getOriginalPool() const;
+   PoolView getOpenPool() const;
    bool open(uint32_t mode);
    void close();
    bool isOpen()const;
@@ -93,10 +116,13 @@ private:
 
    struct PoolData
    {
-      std::vector<uint8_t> data;		
+      std::vector<uint8_t> buffer;   /* owned pool (file), empty when data is a view on external memory */
+      PoolView data;
       uint16_t numObj = 0;
    } m_pool[POOL::SIZE];
 
+   void setPool(PoolView data);
+
 // TDOD   const uint32_t m_mode;
    uint16_t m_numObj;
    uint32_t m_pos = 0U;
@@ -0,0 +1,173 @@
+/* ************************************************************************ */
+/*!
+   \file
+   \brief      Object pool read in place from the raw "pools" data partition
+*/
+/* ************************************************************************ */
+#include <stddef.h>
+#include <string.h>
+
+#include "PoolPartition.h"
+#include "AppCommon/AppHW.h"
+
+#if defined(ESP_PLATFORM)
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#else
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif /* defined(ESP_PLATFORM) */
+
+/* ************************************************************************ */
+typedef enum
+{
+   PoolImage_unknown = 0,
+   PoolImage_valid,
+   PoolImage_none         /* no partition or no valid image, not checked again */
+} PoolImageState_e;
+
+static PoolImageState_e s_eState = PoolImage_unknown;
+static const uint8_t*   s_pu8Image = NULL;
+static uint32_t         s_u32PoolSize = 0U;
+
+/* ************************************************************************ */
+static uint32_t readU32(const uint8_t* pu8Data)
+{
+   return (uint32_t)pu8Data[0] | ((uint32_t)pu8Data[1] << 8) |
+          ((uint32_t)pu8Data[2] << 16) | ((uint32_t)pu8Data[3] << 24);
+}
+
+#if defined(ESP_PLATFORM)
+static uint32_t poolCrc32(const uint8_t* pu8Data, uint32_t u32Size)
+{
+   return esp_rom_crc32_le(0U, pu8Data, u32Size);
+}
+
+static spi_flash_mmap_handle_t s_hMap;
+
+/* whole partition mapped, the pool size is only known from the header */
+static const uint8_t* mapImage(const char* pcLabel, uint32_t* pu32ImageSize)
+{
+   const esp_partition_t* psPart = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+      (esp_partition_subtype_t)POOL_PARTITION_SUBTYPE, pcLabel);
+   const void* pvMapped = NULL;
+
+   if (psPart == NULL)
+   {
+      return NULL;
+   }
+   if (esp_partition_mmap(psPart, 0U, psPart->size, SPI_FLASH_MMAP_DATA, &pvMapped, &s_hMap) != ESP_OK)
+   {
+      hw_DebugPrint("*** pool partition %s not mapped\n", pcLabel);
+      return NULL;
+   }
+   *pu32ImageSize = psPart->size;
+   return (const uint8_t*)pvMapped;
+}
+
+/* the pages of the cache MMU go back to the other mappings */
+static void unmapImage(const uint8_t* pu8Image, uint32_t u32ImageSize)
+{
+   (void)pu8Image;
+   (void)u32ImageSize;
+   spi_flash_munmap(s_hMap);
+}
+#else
+static uint32_t poolCrc32(const uint8_t* pu8Data, uint32_t u32Size)
+{
+   uint32_t u32Crc = 0xFFFFFFFFUL;
+   uint32_t u32I;
+   for (u32I = 0U; u32I < u32Size; u32I++)
+   {
+      int_t iBit;
+      u32Crc ^= pu8Data[u32I];
+      for (iBit = 0; iBit < 8; iBit++)
+      {
+         u32Crc = (u32Crc >> 1) ^ (0xEDB88320UL & (0U - (u32Crc & 1U)));
+      }
+   }
+   return ~u32Crc;
+}
+
+static const uint8_t* mapImage(const char* pcLabel, uint32_t* pu32ImageSize)
+{
+   const char* pcFile = getenv("LEMCA_POOL_IMAGE");
+   struct stat sStat;
+   void* pvMapped;
+   int iFd;
+
+   (void)pcLabel;
+   if (pcFile == NULL)
+   {
+      return NULL;
+   }
+   iFd = open(pcFile, O_RDONLY);
+   if (iFd < 0)
+   {
+      return NULL;
+   }
+   if ((fstat(iFd, &sStat) != 0) || (sStat.st_size < (off_t)POOL_IMAGE_HEADER_SIZE))
+   {
+      close(iFd);
+      return NULL;
+   }
+   pvMapped = mmap(NULL, (size_t)sStat.st_size, PROT_READ, MAP_PRIVATE, iFd, 0);
+   close(iFd);
+   if (pvMapped == MAP_FAILED)
+   {
+      return NULL;
+   }
+   *pu32ImageSize = (uint32_t)sStat.st_size;
+   return (const uint8_t*)pvMapped;
+}
+
+static void unmapImage(const uint8_t* pu8Image, uint32_t u32ImageSize)
+{
+   (void)munmap((void*)pu8Image, (size_t)u32ImageSize);
+}
+#endif /* defined(ESP_PLATFORM) */
+
+/* ************************************************************************ */
+const uint8_t* poolPartitionMap(const char* pcLabel, uint32_t* pu32PoolSize)
+{
+   if (s_eState == PoolImage_none)
+   {
+      return NULL;
+   }
+   if (s_eState == PoolImage_unknown)
+   {
+      uint32_t u32ImageSize = 0U;
+      const uint8_t* pu8Image = mapImage(pcLabel, &u32ImageSize);
+      uint32_t u32PoolSize;
+
+      if (pu8Image == NULL)
+      {
+         s_eState = PoolImage_none;
+         return NULL;
+      }
+      u32PoolSize = readU32(&pu8Image[4]);
+      if ((readU32(&pu8Image[0]) != POOL_IMAGE_MAGIC) ||
+          (u32PoolSize > (u32ImageSize - POOL_IMAGE_HEADER_SIZE)) ||
+          (poolCrc32(&pu8Image[POOL_IMAGE_HEADER_SIZE], u32PoolSize) != readU32(&pu8Image[8])))
+      {
+         /* erased or old partition: unmapped, and not checked again at the next
+            VT or pool reload, the image does not change at run time */
+         hw_DebugPrint("*** pool partition %s: no valid pool image\n", pcLabel);
+         unmapImage(pu8Image, u32ImageSize);
+         s_eState = PoolImage_none;
+         return NULL;
+      }
+      s_pu8Image = pu8Image;
+      s_u32PoolSize = u32PoolSize;
+      s_eState = PoolImage_valid;
+      hw_DebugPrint("*** pool partition %s: %u bytes mapped\n", pcLabel, u32PoolSize);
+   }
+
+   *pu32PoolSize = s_u32PoolSize;
+   return &s_pu8Image[POOL_IMAGE_HEADER_SIZE];
+}
+
+/* ************************************************************************ */
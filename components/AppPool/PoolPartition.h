@@ -0,0 +1,41 @@
+/* ************************************************************************ */
+/*!
+   \file
+   \brief      Object pool read in place from the raw "pools" data partition
+*/
+/* ************************************************************************ */
+#ifndef DEF_POOLPARTITION_H
+#define DEF_POOLPARTITION_H
+
+#include <stdint.h>
+
+/* ************************************************************************ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* ************************************************************************ */
+
+#define POOL_PARTITION_LABEL    "pools"
+#define POOL_PARTITION_SUBTYPE  0x40     /* data, custom */
+
+/* image of tools/pool_image.py: header then the pool */
+#define POOL_IMAGE_MAGIC        0x4C4F504CUL   /* "LPOL" */
+#define POOL_IMAGE_HEADER_SIZE  16U
+
+/* Maps the partition in the flash cache (esp_partition_mmap) and checks the
+   header and the CRC of the pool. The pool is handed to IsoVtcPoolLoad()
+   with PoolTransferFlash: no copy in RAM. A valid image stays mapped, it is
+   only address space of the cache MMU, for the next VT or pool reload; an
+   invalid one is unmapped.
+   Returns NULL when there is no valid pool image (pool file used instead),
+   the result is kept until the reboot.
+   On the host the partition is the file $LEMCA_POOL_IMAGE, mapped with mmap. */
+const uint8_t* poolPartitionMap(const char* pcLabel, uint32_t* pu32PoolSize);
+
+/* ************************************************************************ */
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+/* ************************************************************************ */
+#endif /* DEF_POOLPARTITION_H */
+/* ************************************************************************ */
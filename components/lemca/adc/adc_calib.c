@@ -0,0 +1,186 @@
+#include "adc_calib.h"
+
+#include <stdio.h>
+
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+
+#include "adc_sampler.h"
+#include "Settings/settings.h"
+#include "AppCommon/AppHW.h"
+
+#define ADC_CALIB_DEFAULT_MAX 3200  // former fixed scale
+#define ADC_CALIB_DEFAULT_VREF 1100 // only used without eFuse calibration
+
+typedef struct {
+    int32_t mv;
+    q16_t percent;
+} CalibPoint;
+
+typedef struct {
+    uint8_t n;
+    CalibPoint points[ADC_CALIB_MAX_POINTS];  // increasing mV
+} SensorCalib;
+
+static SensorCalib s_calib[AdcSensor_count];
+
+// double buffered: the control task reads s_lut[sensor][s_active[sensor]]
+static q16_t s_lut[AdcSensor_count][2][ADC_CALIB_LUT_SIZE];
+static uint8_t s_active[AdcSensor_count];
+
+static esp_adc_cal_characteristics_t s_adc_chars;
+
+// piecewise linear, extrapolated on the first and last segments
+static q16_t calib_interp(const CalibPoint * p, uint8_t n, int32_t x){
+    uint8_t i = 1;
+    while(i < n - 1 && x > p[i].mv){
+        ++i;
+    }
+    const CalibPoint * a = &p[i - 1];
+    const CalibPoint * b = &p[i];
+    return a->percent + (q16_t)(((int64_t)(b->percent - a->percent) * (x - a->mv)) / (b->mv - a->mv));
+}
+
+static void calib_build(int sensor){
+    const SensorCalib * c = &s_calib[sensor];
+    uint8_t next = s_active[sensor] ^ 1;
+    q16_t * lut = s_lut[sensor][next];
+    for(int k = 0; k < ADC_CALIB_LUT_SIZE; ++k){
+        int32_t raw = k << ADC_CALIB_LUT_SHIFT;
+        if(c->n >= 2){
+            // the ADC curve is taken out through the eFuse calibration
+            int32_t mv = esp_adc_cal_raw_to_voltage(raw > 4095 ? 4095 : raw, &s_adc_chars);
+            lut[k] = calib_interp(c->points, c->n, mv);
+        } else {
+            lut[k] = Q16_FROM_RATIO(raw * 100, ADC_CALIB_DEFAULT_MAX);
+            if(sensor == AdcSensor_machine_l){
+                // mounted the other way
+                lut[k] = Q16_FROM_INT(100) - lut[k];
+            }
+        }
+    }
+    __atomic_store_n(&s_active[sensor], next, __ATOMIC_RELEASE);
+}
+
+static void calib_key(char * key, int sensor, char field, int i){
+    sprintf(key, "CAL%d%c%d", sensor, field, i);
+}
+
+static void calib_save(int sensor){
+    const SensorCalib * c = &s_calib[sensor];
+    char key[16];
+    calib_key(key, sensor, 'N', 0);
+    setS32("CALIB", key, c->n);
+    for(int i = 0; i < c->n; ++i){
+        calib_key(key, sensor, 'M', i);
+        setS32("CALIB", key, c->points[i].mv);
+        calib_key(key, sensor, 'P', i);
+        setS32("CALIB", key, c->points[i].percent);
+    }
+}
+
+static void calib_load(int sensor){
+    SensorCalib * c = &s_calib[sensor];
+    char key[16];
+    calib_key(key, sensor, 'N', 0);
+    int32_t n = getS32("CALIB", key, 0);
+    c->n = (n > 0 && n <= ADC_CALIB_MAX_POINTS) ? n : 0;
+    for(int i = 0; i < c->n; ++i){
+        calib_key(key, sensor, 'M', i);
+        c->points[i].mv = getS32("CALIB", key, 0);
+        calib_key(key, sensor, 'P', i);
+        c->points[i].percent = getS32("CALIB", key, 0);
+        if(i > 0 && c->points[i].mv <= c->points[i - 1].mv){
+            c->n = 0;
+        }
+    }
+}
+
+void adc_calib_init(void){
+    esp_adc_cal_characterize(ADC_UNIT_2, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, ADC_CALIB_DEFAULT_VREF, &s_adc_chars);
+    for(int sensor = 0; sensor < AdcSensor_count; ++sensor){
+        calib_load(sensor);
+        calib_build(sensor);
+    }
+}
+
+q16_t adc_calib_percent(int sensor, int32_t raw){
+    if(raw < 0){
+        raw = 0;
+    }
+    if(raw > 4095){
+        raw = 4095;
+    }
+    const q16_t * lut = s_lut[sensor][__atomic_load_n(&s_active[sensor], __ATOMIC_ACQUIRE)];
+    int32_t i = raw >> ADC_CALIB_LUT_SHIFT;
+    int32_t f = raw & ((1 << ADC_CALIB_LUT_SHIFT) - 1);
+    return lut[i] + (q16_t)(((int64_t)(lut[i + 1] - lut[i]) * f) >> ADC_CALIB_LUT_SHIFT);
+}
+
+int adc_calib_teach(int sensor, q16_t percent){
+    AdcSamples samples;
+    if(!adc_sampler_read(&samples)){
+        return -1;
+    }
+    SensorCalib * c = &s_calib[sensor];
+    int32_t mv = esp_adc_cal_raw_to_voltage(samples.raw[sensor], &s_adc_chars);
+
+    // replace the point taught at the same position or at the same voltage
+    uint8_t n = 0;
+    CalibPoint points[ADC_CALIB_MAX_POINTS];
+    for(int i = 0; i < c->n; ++i){
+        if(c->points[i].percent != percent && c->points[i].mv != mv){
+            points[n++] = c->points[i];
+        }
+    }
+    if(n == ADC_CALIB_MAX_POINTS){
+        return -1;
+    }
+    // sorted insert
+    int i = n;
+    while(i > 0 && points[i - 1].mv > mv){
+        points[i] = points[i - 1];
+        --i;
+    }
+    points[i].mv = mv;
+    points[i].percent = percent;
+    ++n;
+
+    for(i = 0; i < n; ++i){
+        c->points[i] = points[i];
+    }
+    c->n = n;
+    calib_save(sensor);
+    calib_build(sensor);
+    hw_DebugPrint("*** calib sensor %i raw %i = %i mV at %i %%, %i points\n",
+        sensor, samples.raw[sensor], mv, Q16_TO_INT(percent), n);
+    return n;
+}
+
+void adc_calib_teach_all(q16_t percent){
+    for(int sensor = 0; sensor < AdcSensor_count; ++sensor){
+        adc_calib_teach(sensor, percent);
+    }
+}
+
+void adc_calib_clear(int sensor){
+    s_calib[sensor].n = 0;
+    calib_save(sensor);
+    calib_build(sensor);
+}
+
+void adc_calib_clear_all(void){
+    for(int sensor = 0; sensor < AdcSensor_count; ++sensor){
+        adc_calib_clear(sensor);
+    }
+}
+
+void adc_calib_print(void){
+    for(int sensor = 0; sensor < AdcSensor_count; ++sensor){
+        const SensorCalib * c = &s_calib[sensor];
+        hw_DebugPrint("*** calib sensor %i: %i points\n", sensor, c->n);
+        for(int i = 0; i < c->n; ++i){
+            hw_DebugPrint("***-  %i mV = %i %%\n", c->points[i].mv, Q16_TO_INT(c->points[i].percent));
+        }
+    }
+}
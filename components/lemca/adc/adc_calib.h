@@ -0,0 +1,37 @@
+#ifndef LEMCA_ADC_CALIB_H_
+#define LEMCA_ADC_CALIB_H_
+
+#include <stdint.h>
+
+#include "../common/q16.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADC_CALIB_MAX_POINTS 5
+#define ADC_CALIB_LUT_SHIFT 6                               // 64 raw counts between knots
+#define ADC_CALIB_LUT_SIZE ((4096 >> ADC_CALIB_LUT_SHIFT) + 1)
+
+// loads the teach-in points from the settings and builds the tables
+void adc_calib_init(void);
+
+// hot path: raw 12 bits value -> position in percent, one load and one interpolation
+q16_t adc_calib_percent(int sensor, int32_t raw);
+
+// teach-in: the current filtered value of the sensor is the given position.
+// Two points (e.g. both end stops) or more, replaced when taught again at the
+// same position. Returns the number of points, the table is used from 2 points.
+int adc_calib_teach(int sensor, q16_t percent);
+void adc_calib_teach_all(q16_t percent);
+// back to the default scale (3200 counts = 100 %)
+void adc_calib_clear(int sensor);
+void adc_calib_clear_all(void);
+
+void adc_calib_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,214 @@
+#include "adc_sampler.h"
+
+#include <string.h>
+
+#include "driver/adc.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "hal/cpu_hal.h"
+
+#include "../common/seqlock.h"
+#include "../dsp/dsp_filter.h"
+#include "Settings/settings.h"
+#include "AppCommon/AppHW.h"
+
+#define ADC_SAMPLER_TASK_CORE 0
+#define ADC_SAMPLER_TASK_PRIORITY 11
+#define ADC_SAMPLER_TASK_STACK 3072
+
+#define ADC_RESULT_BYTES 4          // ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_FRAME_BYTES 256         // 64 conversions, ~3.2 ms at 20 kHz
+#define ADC_POOL_BYTES 2048         // DMA results waiting for the task
+#define ADC_READ_TIMEOUT_MS 100
+#define ADC_FRAME_RESULTS (ADC_FRAME_BYTES / ADC_RESULT_BYTES)
+#define ADC_FIR_TAPS 32
+
+// same wiring as the former one-shot reads
+static const adc_channel_t s_channels[AdcSensor_count] = {
+    ADC2_CHANNEL_0, // angle
+    ADC2_CHANNEL_1, // h
+    ADC2_CHANNEL_3, // machine_l
+    ADC2_CHANNEL_2, // machine_r
+};
+
+static uint8_t s_frame[ADC_FRAME_BYTES];
+
+// owned by the sampler task
+static int8_t s_sensor_of_channel[16];
+static int s_decim = AdcDecim_median;
+static int s_smooth = AdcSmooth_iir;
+static int16_t s_in[AdcSensor_count][ADC_FRAME_RESULTS];    // frame split by sensor
+static uint8_t s_in_len[AdcSensor_count];
+static int16_t s_decimated[ADC_FRAME_RESULTS];
+static uint16_t s_block[AdcSensor_count][ADC_SAMPLER_BLOCK];
+static uint8_t s_block_len[AdcSensor_count];
+static DspFirDecim s_fir[AdcSensor_count];
+static DspBiquad s_biquad[AdcSensor_count];
+static DspMovingAverage s_average[AdcSensor_count];
+static int32_t s_iir_q4[AdcSensor_count];    // 4 fractional bits
+static uint8_t s_iir_started[AdcSensor_count];
+static AdcSamples s_samples;
+
+static AdcSamples s_published;  // read through the seqlock
+static SeqLock s_lock;
+static AdcSamplerStats s_stats;
+
+static uint16_t adc_median(uint16_t * v){
+    // insertion sort, ADC_SAMPLER_BLOCK is small
+    for(int i = 1; i < ADC_SAMPLER_BLOCK; ++i){
+        uint16_t x = v[i];
+        int j = i - 1;
+        while(j >= 0 && v[j] > x){
+            v[j + 1] = v[j];
+            --j;
+        }
+        v[j + 1] = x;
+    }
+    return (v[(ADC_SAMPLER_BLOCK - 1) / 2] + v[ADC_SAMPLER_BLOCK / 2] + 1) / 2;
+}
+
+// 625 Hz value of a sensor -> published value, 4 fractional bits inside
+static void adc_smooth(int sensor, int32_t value){
+    int32_t x_q4 = value << 4;
+    s_stats.blocks++;
+    if(!s_iir_started[sensor]){
+        s_iir_q4[sensor] = x_q4;
+        dsp_biquad_reset(&s_biquad[sensor], x_q4);
+        s_iir_started[sensor] = 1;
+    }
+    if(s_smooth == AdcSmooth_biquad){
+        s_iir_q4[sensor] = dsp_biquad(&s_biquad[sensor], x_q4);
+    } else if(s_smooth == AdcSmooth_average){
+        s_iir_q4[sensor] = dsp_moving_average(&s_average[sensor], x_q4);
+    } else {
+        s_iir_q4[sensor] += (x_q4 - s_iir_q4[sensor]) >> ADC_SAMPLER_IIR_SHIFT;
+    }
+    s_samples.raw[sensor] = (s_iir_q4[sensor] + 8) >> 4;
+}
+
+// returns 1 when at least one decimated value was produced
+static int adc_filter(int sensor, const int16_t * in, int n){
+    if(s_decim == AdcDecim_fir){
+        int n_out = dsp_fir_decim(&s_fir[sensor], in, n, s_decimated);
+        for(int i = 0; i < n_out; ++i){
+            adc_smooth(sensor, s_decimated[i]);
+        }
+        return n_out > 0;
+    }
+    int updated = 0;
+    for(int i = 0; i < n; ++i){
+        s_block[sensor][s_block_len[sensor]++] = in[i];
+        if(s_block_len[sensor] == ADC_SAMPLER_BLOCK){
+            s_block_len[sensor] = 0;
+            adc_smooth(sensor, adc_median(s_block[sensor]));
+            updated = 1;
+        }
+    }
+    return updated;
+}
+
+static void adc_sampler_task(void * arg){
+    for(;;){
+        uint32_t len = 0;
+        esp_err_t err = adc_digi_read_bytes(s_frame, ADC_FRAME_BYTES, &len, ADC_READ_TIMEOUT_MS);
+        if(err == ESP_ERR_INVALID_STATE){
+            // the pool overflowed, the data read is still valid
+            s_stats.overflows++;
+        } else if(err != ESP_OK){
+            continue;
+        }
+
+        uint32_t start = cpu_hal_get_cycle_count();
+        for(uint32_t i = 0; i + ADC_RESULT_BYTES <= len; i += ADC_RESULT_BYTES){
+            const adc_digi_output_data_t * p = (const adc_digi_output_data_t *)&s_frame[i];
+            s_stats.samples++;
+            if(p->type2.unit != 1){
+                s_stats.invalid++;
+                continue;
+            }
+            int sensor = s_sensor_of_channel[p->type2.channel];
+            if(sensor < 0){
+                s_stats.invalid++;
+                continue;
+            }
+            s_in[sensor][s_in_len[sensor]++] = p->type2.data;
+        }
+
+        // one block per sensor, the kernels run on contiguous samples
+        int updated = 0;
+        for(int sensor = 0; sensor < AdcSensor_count; ++sensor){
+            updated |= adc_filter(sensor, s_in[sensor], s_in_len[sensor]);
+            s_in_len[sensor] = 0;
+        }
+        s_stats.filter_cycles = cpu_hal_get_cycle_count() - start;
+
+        if(updated){
+            s_samples.timestamp_us = hw_GetTimeUs();
+            seqlock_write(&s_lock, &s_published, &s_samples, sizeof(AdcSamples));
+        }
+    }
+}
+
+static void adc_filter_init(void){
+    s_decim = getS32("ADC", "ADC_DECIM", AdcDecim_median);
+    s_smooth = getS32("ADC", "ADC_SMOOTH", AdcSmooth_iir);
+    int32_t fc_hz = getS32("ADC", "ADC_FC_HZ", 20);
+    int32_t average_n = getS32("ADC", "ADC_MA_N", 8);
+    float decimated_hz = (float)ADC_SAMPLER_FREQ_HZ / AdcSensor_count / ADC_SAMPLER_BLOCK;
+    for(int i = 0; i < AdcSensor_count; ++i){
+        // cut at the new Nyquist frequency
+        dsp_fir_decim_init(&s_fir[i], ADC_FIR_TAPS, ADC_SAMPLER_BLOCK, 0.5f / ADC_SAMPLER_BLOCK);
+        dsp_biquad_lowpass(&s_biquad[i], fc_hz / decimated_hz, 0.707f);
+        dsp_moving_average_init(&s_average[i], average_n);
+    }
+    dsp_filter_selftest();
+}
+
+void adc_sampler_start(void){
+    uint16_t adc2_mask = 0;
+    adc_filter_init();
+    memset(s_sensor_of_channel, -1, sizeof(s_sensor_of_channel));
+    adc_digi_pattern_config_t pattern[AdcSensor_count];
+    for(int i = 0; i < AdcSensor_count; ++i){
+        s_sensor_of_channel[s_channels[i]] = i;
+        adc2_mask |= 1 << s_channels[i];
+        pattern[i].atten = ADC_ATTEN_DB_11;
+        pattern[i].channel = s_channels[i];
+        pattern[i].unit = 1; // ADC2
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+
+    adc_digi_init_config_t init_config = {
+        .max_store_buf_size = ADC_POOL_BYTES,
+        .conv_num_each_intr = ADC_FRAME_BYTES,
+        .adc1_chan_mask = 0,
+        .adc2_chan_mask = adc2_mask,
+    };
+    ESP_ERROR_CHECK(adc_digi_initialize(&init_config));
+
+    adc_digi_configuration_t digi_config = {
+        .conv_limit_en = 0,
+        .conv_limit_num = 250,
+        .pattern_num = AdcSensor_count,
+        .adc_pattern = pattern,
+        .sample_freq_hz = ADC_SAMPLER_FREQ_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_2,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+    };
+    ESP_ERROR_CHECK(adc_digi_controller_configure(&digi_config));
+
+    xTaskCreatePinnedToCore(adc_sampler_task, "adc", ADC_SAMPLER_TASK_STACK, NULL,
+        ADC_SAMPLER_TASK_PRIORITY, NULL, ADC_SAMPLER_TASK_CORE);
+    ESP_ERROR_CHECK(adc_digi_start());
+}
+
+int adc_sampler_read(AdcSamples * samples){
+    seqlock_read(&s_lock, samples, &s_published, sizeof(AdcSamples));
+    return samples->timestamp_us != 0;
+}
+
+void adc_sampler_get_stats(AdcSamplerStats * stats){
+    *stats = s_stats;
+}
@@ -0,0 +1,63 @@
+#ifndef LEMCA_ADC_SAMPLER_H_
+#define LEMCA_ADC_SAMPLER_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// sensors in the order of readAll2()
+enum AdcSensor {
+    AdcSensor_angle = 0,
+    AdcSensor_h = 1,
+    AdcSensor_machine_l = 2,
+    AdcSensor_machine_r = 3,
+    AdcSensor_count
+};
+
+#define ADC_SAMPLER_FREQ_HZ 20000   // all channels, 5 kHz per sensor
+#define ADC_SAMPLER_BLOCK 8         // samples per median, 625 Hz per sensor after decimation
+#define ADC_SAMPLER_IIR_SHIFT 2     // y += (median - y) / 4 on the decimated values
+
+// pipeline per sensor, from the settings:
+//  ADC_DECIM  5 kHz -> 625 Hz: 0 median of 8 (spikes), 1 FIR low pass 32 taps
+//  ADC_SMOOTH on 625 Hz: 0 IIR above, 1 biquad low pass at ADC_FC_HZ,
+//             2 moving average of ADC_MA_N values
+enum AdcDecim {
+    AdcDecim_median = 0,
+    AdcDecim_fir = 1
+};
+
+enum AdcSmooth {
+    AdcSmooth_iir = 0,
+    AdcSmooth_biquad = 1,
+    AdcSmooth_average = 2
+};
+
+typedef struct {
+    int64_t timestamp_us;           // last block, 0 = no value yet
+    int32_t raw[AdcSensor_count];   // filtered, 12 bits scale
+} AdcSamples;
+
+typedef struct {
+    uint32_t samples;       // conversions read from the DMA
+    uint32_t blocks;        // decimated values, all sensors
+    uint32_t overflows;     // DMA pool full, conversions lost
+    uint32_t invalid;       // results of an unexpected unit / channel
+    uint32_t filter_cycles; // CPU cycles of the filtering of the last frame
+} AdcSamplerStats;
+
+// continuous conversions of the four ADC2 channels, filtered by a task on core 0
+void adc_sampler_start(void);
+
+// lock-free, constant time, callable from the control task
+int adc_sampler_read(AdcSamples * samples);
+
+void adc_sampler_get_stats(AdcSamplerStats * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
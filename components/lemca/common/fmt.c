@@ -0,0 +1,84 @@
+#include "fmt.h"
+
+static const int32_t s_pow10[FMT_MAX_DECIMALS + 1] = { 1, 10, 100, 1000, 10000 };
+
+void fmt_init(FmtBuf * f, char * buf, uint16_t size){
+    f->buf = buf;
+    f->size = size;
+    f->len = 0;
+    if(size > 0){
+        buf[0] = 0;
+    }
+}
+
+void fmt_char(FmtBuf * f, char c){
+    if(f->len + 1 < f->size){
+        f->buf[f->len++] = c;
+        f->buf[f->len] = 0;
+    }
+}
+
+void fmt_str(FmtBuf * f, const char * s){
+    while(*s != 0 && f->len + 1 < f->size){
+        f->buf[f->len++] = *s++;
+    }
+    if(f->size > 0){
+        f->buf[f->len] = 0;
+    }
+}
+
+// magnitude as uint32, INT32_MIN included
+static void fmt_abs(FmtBuf * f, uint32_t abs, int negative, FmtSpec spec){
+    uint8_t decimals = spec.decimals > FMT_MAX_DECIMALS ? FMT_MAX_DECIMALS : spec.decimals;
+    char digits[16];
+    int n = 0;
+    // at least one digit before the point
+    do {
+        digits[n++] = (char)('0' + abs % 10);
+        abs /= 10;
+    } while(abs != 0 || n <= decimals);
+
+    char sign = negative ? '-' : ((spec.flags & FMT_PLUS) ? '+' : 0);
+    int len = n + (decimals > 0) + (sign != 0);
+    int pad = spec.width > len ? spec.width - len : 0;
+    if(spec.flags & FMT_ZERO){
+        if(sign){
+            fmt_char(f, sign);
+        }
+        for(; pad > 0; --pad){
+            fmt_char(f, '0');
+        }
+    } else {
+        for(; pad > 0; --pad){
+            fmt_char(f, ' ');
+        }
+        if(sign){
+            fmt_char(f, sign);
+        }
+    }
+    while(n > 0){
+        if(n == decimals){
+            fmt_char(f, '.');
+        }
+        fmt_char(f, digits[--n]);
+    }
+}
+
+void fmt_int(FmtBuf * f, int32_t value, FmtSpec spec){
+    uint32_t abs = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    fmt_abs(f, abs, value < 0, spec);
+}
+
+void fmt_q16(FmtBuf * f, q16_t value, FmtSpec spec){
+    uint8_t decimals = spec.decimals > FMT_MAX_DECIMALS ? FMT_MAX_DECIMALS : spec.decimals;
+    int64_t scaled = (int64_t)value * s_pow10[decimals];
+    uint64_t abs = scaled < 0 ? (uint64_t)(-scaled) : (uint64_t)scaled;
+    // half to even on the exact ties, like printf
+    uint32_t rem = (uint32_t)(abs & (Q16_ONE - 1));
+    abs >>= 16;
+    if(rem > Q16_ONE / 2 || (rem == Q16_ONE / 2 && (abs & 1))){
+        abs++;
+    }
+    // no "-0.0"
+    fmt_abs(f, (uint32_t)abs, scaled < 0 && abs != 0, spec);
+}
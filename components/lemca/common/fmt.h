@@ -0,0 +1,51 @@
+#ifndef LEMCA_FMT_H_
+#define LEMCA_FMT_H_
+
+#include <stdint.h>
+
+#include "q16.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number and string formatting of the VT strings without printf: integers
+// and fixed point values (tenths, q16) appended to a caller buffer, always
+// '\0' terminated, truncated to the buffer. q16 values are rounded half to
+// even like printf.
+
+#define FMT_PLUS 0x01       // '+' on positive values
+#define FMT_ZERO 0x02       // padded with '0' instead of ' '
+
+typedef struct {
+    uint8_t decimals;
+    uint8_t width;          // minimum, padded on the left
+    uint8_t flags;
+} FmtSpec;
+
+#define FMT_SPEC(decimals, width, flags) ((FmtSpec){ (decimals), (width), (flags) })
+#define FMT_INT FMT_SPEC(0, 0, 0)
+#define FMT_DEC1 FMT_SPEC(1, 0, 0)
+#define FMT_SIGNED_DEC1 FMT_SPEC(1, 0, FMT_PLUS)
+
+#define FMT_MAX_DECIMALS 4
+
+typedef struct {
+    char * buf;
+    uint16_t size;
+    uint16_t len;
+} FmtBuf;
+
+void fmt_init(FmtBuf * f, char * buf, uint16_t size);
+void fmt_char(FmtBuf * f, char c);
+void fmt_str(FmtBuf * f, const char * s);
+// value in units of 10^-decimals: fmt_int(f, 123, FMT_DEC1) -> "12.3"
+void fmt_int(FmtBuf * f, int32_t value, FmtSpec spec);
+// q16 value rounded to the decimals of spec
+void fmt_q16(FmtBuf * f, q16_t value, FmtSpec spec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef LEMCA_Q16_H_
+#define LEMCA_Q16_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Q16.16 fixed point: the control values are percents (+-100) and the gains
+// are small, 16 fractional bits keep 0.00002 % of resolution without overflow.
+typedef int32_t q16_t;
+
+#define Q16_ONE (1 << 16)
+#define Q16_FROM_INT(x) ((q16_t)(x) * Q16_ONE)
+#define Q16_FROM_RATIO(num, den) ((q16_t)(((int64_t)(num) * Q16_ONE) / (den)))
+// truncated toward 0 like a double to int cast
+#define Q16_TO_INT(x) ((int32_t)((x) / Q16_ONE))
+
+static inline q16_t q16_mul(q16_t a, q16_t b){
+    return (q16_t)(((int64_t)a * b + (Q16_ONE / 2)) >> 16);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
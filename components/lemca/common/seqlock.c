@@ -0,0 +1,22 @@
+#include "seqlock.h"
+
+#include <string.h>
+
+void seqlock_write(SeqLock * lock, void * dst, const void * src, size_t size){
+    uint32_t seq = lock->seq;
+    __atomic_store_n(&lock->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(dst, src, size);
+    __atomic_store_n(&lock->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void seqlock_read(const SeqLock * lock, void * dst, const void * src, size_t size){
+    uint32_t before;
+    uint32_t after;
+    do {
+        before = __atomic_load_n(&lock->seq, __ATOMIC_ACQUIRE);
+        memcpy(dst, src, size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&lock->seq, __ATOMIC_RELAXED);
+    } while((before & 1) || (before != after));
+}
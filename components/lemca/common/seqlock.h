@@ -0,0 +1,24 @@
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sequence lock: one writer publishes a small struct, readers on any core get
+// a consistent copy without blocking the writer (they retry instead).
+typedef struct {
+    uint32_t seq;
+} SeqLock;
+
+void seqlock_write(SeqLock * lock, void * dst, const void * src, size_t size);
+void seqlock_read(const SeqLock * lock, void * dst, const void * src, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,83 @@
+#include "spsc_ring.h"
+
+#include <string.h>
+
+#define RING_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define RING_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+void spsc_ring_init(SpscRing * ring, void * buf, uint32_t elem_size, uint32_t capacity){
+    ring->buf = (uint8_t *)buf;
+    ring->elem_size = elem_size;
+    ring->mask = capacity - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+    ring->high_water = 0;
+}
+
+uint32_t spsc_ring_push(SpscRing * ring, const void * elems, uint32_t n){
+    uint32_t head = ring->head;
+    uint32_t tail = RING_LOAD(&ring->tail);
+    uint32_t capacity = ring->mask + 1;
+    uint32_t free = capacity - (head - tail);
+    if(n > free){
+        ring->dropped += n - free;
+        n = free;
+    }
+
+    uint32_t start = head & ring->mask;
+    uint32_t first = capacity - start;
+    if(first > n){
+        first = n;
+    }
+    const uint8_t * src = (const uint8_t *)elems;
+    memcpy(ring->buf + start*ring->elem_size, src, first*ring->elem_size);
+    memcpy(ring->buf, src + first*ring->elem_size, (n - first)*ring->elem_size);
+
+    RING_STORE(&ring->head, head + n);
+
+    uint32_t count = head + n - tail;
+    if(count > ring->high_water){
+        ring->high_water = count;
+    }
+    return n;
+}
+
+uint32_t spsc_ring_pop(SpscRing * ring, void * elems, uint32_t n){
+    uint32_t tail = ring->tail;
+    uint32_t head = RING_LOAD(&ring->head);
+    uint32_t count = head - tail;
+    if(n > count){
+        n = count;
+    }
+
+    uint32_t capacity = ring->mask + 1;
+    uint32_t start = tail & ring->mask;
+    uint32_t first = capacity - start;
+    if(first > n){
+        first = n;
+    }
+    uint8_t * dst = (uint8_t *)elems;
+    memcpy(dst, ring->buf + start*ring->elem_size, first*ring->elem_size);
+    memcpy(dst + first*ring->elem_size, ring->buf, (n - first)*ring->elem_size);
+
+    RING_STORE(&ring->tail, tail + n);
+    return n;
+}
+
+uint32_t spsc_ring_count(const SpscRing * ring){
+    return RING_LOAD(&ring->head) - RING_LOAD(&ring->tail);
+}
+
+uint32_t spsc_ring_peek(const SpscRing * ring, const void ** data){
+    uint32_t tail = ring->tail;
+    uint32_t count = RING_LOAD(&ring->head) - tail;
+    uint32_t start = tail & ring->mask;
+    uint32_t first = ring->mask + 1 - start;
+    *data = ring->buf + start*ring->elem_size;
+    return (count < first) ? count : first;
+}
+
+void spsc_ring_consume(SpscRing * ring, uint32_t n){
+    RING_STORE(&ring->tail, ring->tail + n);
+}
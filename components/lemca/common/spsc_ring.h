@@ -0,0 +1,41 @@
+#ifndef SPSC_RING_H_
+#define SPSC_RING_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lock-free ring for one producer and one consumer (possibly on the other core).
+// head is only written by the producer, tail only by the consumer; both are
+// free running counters, capacity must be a power of 2.
+typedef struct {
+    uint8_t * buf;
+    uint32_t elem_size;
+    uint32_t mask;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t dropped;     // elements refused because the ring was full
+    uint32_t high_water;  // max number of elements seen in the ring
+} SpscRing;
+
+void spsc_ring_init(SpscRing * ring, void * buf, uint32_t elem_size, uint32_t capacity);
+
+// producer side, returns the number of elements pushed, the rest is dropped
+uint32_t spsc_ring_push(SpscRing * ring, const void * elems, uint32_t n);
+
+// consumer side
+uint32_t spsc_ring_pop(SpscRing * ring, void * elems, uint32_t n);
+uint32_t spsc_ring_count(const SpscRing * ring);
+
+// zero-copy read: *data points on the first contiguous readable elements,
+// returns their number. spsc_ring_consume() releases them.
+uint32_t spsc_ring_peek(const SpscRing * ring, const void ** data);
+void spsc_ring_consume(SpscRing * ring, uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,87 @@
+#include "autotune.h"
+
+#include <math.h>
+
+void autotune_start(Autotune * at, q16_t relay, q16_t hysteresis, uint8_t cycles, int64_t timeout_us, int64_t now_us){
+    at->relay = relay;
+    at->hysteresis = hysteresis;
+    at->cycles = cycles;
+    at->timeout_us = timeout_us;
+    at->start_us = now_us;
+    at->last_rise_us = 0;
+    at->out = 0;
+    at->e_min = 0;
+    at->e_max = 0;
+    at->periods = 0;
+    at->sum_period_us = 0;
+    at->sum_amplitude = 0;
+}
+
+enum AutotuneStatus autotune_step(Autotune * at, q16_t error, int64_t now_us, q16_t * out){
+    if(now_us - at->start_us > at->timeout_us){
+        *out = 0;
+        return Autotune_failed;
+    }
+
+    if(error > at->e_max){
+        at->e_max = error;
+    }
+    if(error < at->e_min){
+        at->e_min = error;
+    }
+
+    if(at->out == 0){
+        // first step: kick the loop out of the hysteresis band
+        at->out = (error >= 0) ? at->relay : -at->relay;
+    } else if(at->out < 0 && error > at->hysteresis){
+        // rising switch: end of a period
+        if(at->last_rise_us != 0){
+            at->periods++;
+            if(at->periods > AUTOTUNE_SKIP_CYCLES){
+                at->sum_period_us += now_us - at->last_rise_us;
+                at->sum_amplitude += ((int64_t)at->e_max - at->e_min) / 2;
+            }
+        }
+        at->last_rise_us = now_us;
+        at->e_min = error;
+        at->e_max = error;
+        at->out = at->relay;
+    } else if(at->out > 0 && error < -at->hysteresis){
+        at->out = -at->relay;
+    }
+
+    *out = at->out;
+    if(at->periods >= at->cycles + AUTOTUNE_SKIP_CYCLES){
+        *out = 0;
+        return Autotune_done;
+    }
+    return Autotune_running;
+}
+
+int autotune_progress(const Autotune * at){
+    int total = at->cycles + AUTOTUNE_SKIP_CYCLES;
+    return at->periods * 100 / total;
+}
+
+int autotune_result(const Autotune * at, q16_t * ku, int32_t * tu_us, q16_t * kp, q16_t * ki){
+    if(at->periods <= AUTOTUNE_SKIP_CYCLES){
+        return 0;
+    }
+    // done once, out of the control hot path
+    int n = at->periods - AUTOTUNE_SKIP_CYCLES;
+    double a = (double)at->sum_amplitude / n / Q16_ONE;
+    double eps = (double)at->hysteresis / Q16_ONE;
+    double d = (double)at->relay / Q16_ONE;
+    double tu = (double)at->sum_period_us / n / 1e6;
+    if(a <= eps || tu <= 0){
+        return 0;
+    }
+    double k_u = 4.0 * d / (M_PI * sqrt(a * a - eps * eps));
+    double k_p = 0.45 * k_u;
+    double k_i = k_p * 1.2 / tu;
+    *ku = (q16_t)(k_u * Q16_ONE);
+    *tu_us = (int32_t)(tu * 1e6);
+    *kp = (q16_t)(k_p * Q16_ONE);
+    *ki = (q16_t)(k_i * Q16_ONE);
+    return 1;
+}
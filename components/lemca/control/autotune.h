@@ -0,0 +1,60 @@
+#ifndef LEMCA_AUTOTUNE_H_
+#define LEMCA_AUTOTUNE_H_
+
+#include <stdint.h>
+
+#include "../common/q16.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Relay feedback experiment (Astrom-Hagglund): the output switches between
+// +relay and -relay on the sign of the error (with hysteresis), the loop
+// oscillates at its ultimate period Tu, and the amplitude a of the error gives
+// the ultimate gain Ku = 4 relay / (pi sqrt(a^2 - hysteresis^2)).
+
+#define AUTOTUNE_SKIP_CYCLES 1      // transient before the measure
+
+enum AutotuneStatus {
+    Autotune_running = 0,
+    Autotune_done = 1,
+    Autotune_failed = 2
+};
+
+typedef struct {
+    // configuration
+    q16_t relay;            // % of correction
+    q16_t hysteresis;       // % of error
+    uint8_t cycles;         // measured periods
+    int64_t timeout_us;
+
+    // state
+    int64_t start_us;
+    int64_t last_rise_us;   // last switch to +relay
+    q16_t out;
+    q16_t e_min;
+    q16_t e_max;
+    uint8_t periods;        // including the skipped ones
+    int64_t sum_period_us;
+    int64_t sum_amplitude;  // q16
+} Autotune;
+
+void autotune_start(Autotune * at, q16_t relay, q16_t hysteresis, uint8_t cycles, int64_t timeout_us, int64_t now_us);
+
+// one control step, *out is the correction to apply
+enum AutotuneStatus autotune_step(Autotune * at, q16_t error, int64_t now_us, q16_t * out);
+
+// 0..100
+int autotune_progress(const Autotune * at);
+
+// after Autotune_done: Ku, Tu and the Ziegler-Nichols PI gains
+// (kp = 0.45 Ku, Ti = Tu / 1.2, ki = kp / Ti on the integral of the error).
+// Returns 0 when the oscillation cannot give gains.
+int autotune_result(const Autotune * at, q16_t * ku, int32_t * tu_us, q16_t * kp, q16_t * ki);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,37 @@
+#include "feedforward.h"
+
+#define FEEDFORWARD_RATE_ALPHA Q16_FROM_RATIO(1, 4)
+
+void feedforward_init(Feedforward * ff, uint32_t period_us){
+    ff->k_speed = 0;
+    ff->k_rate = 0;
+    ff->rate_alpha = FEEDFORWARD_RATE_ALPHA;
+    ff->inv_dt = (q16_t)((1000000LL * Q16_ONE + period_us / 2) / period_us);
+    feedforward_reset(ff);
+}
+
+void feedforward_reset(Feedforward * ff){
+    ff->prev_error = 0;
+    ff->rate = 0;
+    ff->started = 0;
+}
+
+q16_t feedforward_step(Feedforward * ff, q16_t error, int32_t speed_mm_s){
+    // no rate on the first step, as the derivative of the PID
+    if(ff->started){
+        int64_t raw = ((int64_t)(error - ff->prev_error) * ff->inv_dt) >> 16;
+        ff->rate += q16_mul(ff->rate_alpha, (q16_t)(raw - ff->rate));
+    }
+    ff->prev_error = error;
+    ff->started = 1;
+
+    int64_t out = ((int64_t)ff->k_speed * speed_mm_s) / 1000;
+    out += q16_mul(ff->k_rate, ff->rate);
+    if(out > Q16_FROM_INT(100)){
+        return Q16_FROM_INT(100);
+    }
+    if(out < -Q16_FROM_INT(100)){
+        return -Q16_FROM_INT(100);
+    }
+    return (q16_t)out;
+}
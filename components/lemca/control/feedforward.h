@@ -0,0 +1,38 @@
+#ifndef LEMCA_FEEDFORWARD_H_
+#define LEMCA_FEEDFORWARD_H_
+
+#include <stdint.h>
+
+#include "../common/q16.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// correction added to the PID output, before any error builds up:
+//   k_speed * speed + k_rate * d(error)/dt (low pass filtered)
+typedef struct {
+    // configuration
+    q16_t k_speed;      // % per m/s, signed
+    q16_t k_rate;       // % per %/s
+    q16_t rate_alpha;   // low pass of the error rate, Q16_ONE = not filtered
+    q16_t inv_dt;       // 1/s
+
+    // state
+    q16_t prev_error;
+    q16_t rate;
+    uint8_t started;
+} Feedforward;
+
+// all gains 0: the output is always 0
+void feedforward_init(Feedforward * ff, uint32_t period_us);
+void feedforward_reset(Feedforward * ff);
+
+// speed_mm_s is 0 when no speed source is valid
+q16_t feedforward_step(Feedforward * ff, q16_t error, int32_t speed_mm_s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,121 @@
+#include "kalman.h"
+
+#include <string.h>
+
+#define DEG_TO_RAD 0.017453292f
+#define KALMAN_P0_HEADING 100.0f     // deg^2, unknown at start
+#define KALMAN_P0_BIAS 1.0f          // (deg/s)^2
+
+void kalman_init(Kalman * kf){
+    for(int i = 0; i < KALMAN_N; ++i){
+        kf->q[i] = 0;
+    }
+    kf->r_row = 1;
+    kf->r_angle = 1;
+    kf->pct_per_m = 0;
+    kalman_reset(kf);
+}
+
+void kalman_reset(Kalman * kf){
+    memset(kf->x, 0, sizeof(kf->x));
+    memset(kf->P, 0, sizeof(kf->P));
+    kf->P[Kalman_offset][Kalman_offset] = kf->r_row;
+    kf->P[Kalman_heading][Kalman_heading] = KALMAN_P0_HEADING;
+    kf->P[Kalman_bias][Kalman_bias] = KALMAN_P0_BIAS;
+    kf->P[Kalman_height][Kalman_height] = kf->r_row;
+    kf->started = 0;
+}
+
+void kalman_predict(Kalman * kf, float dt, float speed_m_s, float yaw_rate_deg_s, int yaw_ok){
+    if(!kf->started){
+        return;
+    }
+    // F = I + the two couplings
+    float f_oh = dt * speed_m_s * kf->pct_per_m * DEG_TO_RAD;
+    float f_hb = yaw_ok ? -dt : 0;
+
+    float * x = kf->x;
+    x[Kalman_offset] += f_oh * x[Kalman_heading];
+    if(yaw_ok){
+        x[Kalman_heading] += dt * (yaw_rate_deg_s - x[Kalman_bias]);
+    }
+
+    // P = F P F^T + Q dt, F only has two off-diagonal terms
+    float (*P)[KALMAN_N] = kf->P;
+    float FP[KALMAN_N][KALMAN_N];
+    for(int j = 0; j < KALMAN_N; ++j){
+        FP[Kalman_offset][j] = P[Kalman_offset][j] + f_oh * P[Kalman_heading][j];
+        FP[Kalman_heading][j] = P[Kalman_heading][j] + f_hb * P[Kalman_bias][j];
+        FP[Kalman_bias][j] = P[Kalman_bias][j];
+        FP[Kalman_height][j] = P[Kalman_height][j];
+    }
+    for(int i = 0; i < KALMAN_N; ++i){
+        P[i][Kalman_offset] = FP[i][Kalman_offset] + f_oh * FP[i][Kalman_heading];
+        P[i][Kalman_heading] = FP[i][Kalman_heading] + f_hb * FP[i][Kalman_bias];
+        P[i][Kalman_bias] = FP[i][Kalman_bias];
+        P[i][Kalman_height] = FP[i][Kalman_height];
+        P[i][i] += kf->q[i] * dt;
+    }
+}
+
+// scalar measurement z = h x + noise(r)
+static void kalman_update(Kalman * kf, const float h[KALMAN_N], float z, float r){
+    float (*P)[KALMAN_N] = kf->P;
+    float Ph[KALMAN_N];
+    float s = r;
+    float y = z;
+    for(int i = 0; i < KALMAN_N; ++i){
+        Ph[i] = 0;
+        for(int j = 0; j < KALMAN_N; ++j){
+            Ph[i] += P[i][j] * h[j];
+        }
+        s += h[i] * Ph[i];
+        y -= h[i] * kf->x[i];
+    }
+    if(s <= 0){
+        return;
+    }
+    float inv_s = 1.0f / s;
+    for(int i = 0; i < KALMAN_N; ++i){
+        kf->x[i] += Ph[i] * inv_s * y;
+    }
+    // P -= K h P = Ph Ph^T / s, kept symmetric
+    for(int i = 0; i < KALMAN_N; ++i){
+        for(int j = i; j < KALMAN_N; ++j){
+            float p = P[i][j] - Ph[i] * Ph[j] * inv_s;
+            P[i][j] = p;
+            P[j][i] = p;
+        }
+    }
+}
+
+void kalman_update_rows(Kalman * kf, float left, float right){
+    if(!kf->started){
+        kf->x[Kalman_offset] = left - right;
+        kf->x[Kalman_height] = (left + right) / 2;
+        kf->started = 1;
+        return;
+    }
+    static const float h_left[KALMAN_N] = { 0.5f, 0, 0, 1 };
+    static const float h_right[KALMAN_N] = { -0.5f, 0, 0, 1 };
+    kalman_update(kf, h_left, left, kf->r_row);
+    kalman_update(kf, h_right, right, kf->r_row);
+}
+
+void kalman_update_angle(Kalman * kf, float heading_deg){
+    if(!kf->started){
+        return;
+    }
+    static const float h_angle[KALMAN_N] = { 0, 1, 0, 0 };
+    kalman_update(kf, h_angle, heading_deg, kf->r_angle);
+}
+
+void kalman_estimate(const Kalman * kf, float latency_s, float speed_m_s, float yaw_rate_deg_s, int yaw_ok, KalmanEstimate * est){
+    float heading = kf->x[Kalman_heading];
+    float heading_rate = yaw_ok ? yaw_rate_deg_s - kf->x[Kalman_bias] : 0;
+    // offset integrated with the mean heading over the latency
+    float heading_mid = heading + heading_rate * latency_s / 2;
+    est->offset = kf->x[Kalman_offset] + latency_s * speed_m_s * kf->pct_per_m * DEG_TO_RAD * heading_mid;
+    est->heading = heading + heading_rate * latency_s;
+    est->height = kf->x[Kalman_height];
+}
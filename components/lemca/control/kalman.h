@@ -0,0 +1,68 @@
+#ifndef LEMCA_KALMAN_H_
+#define LEMCA_KALMAN_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fusion of the row sensors, the angle sensor and the IMU yaw rate.
+// State, sized at compile time:
+//   offset   lateral offset on the row, % of (left - right)
+//   heading  heading error on the row, deg
+//   bias     yaw rate bias of the IMU, deg/s
+//   height   (left + right) / 2, %
+// Model over dt:
+//   offset  += dt * speed * pct_per_m * heading (rad)
+//   heading += dt * (yaw_rate - bias)
+// Measurements: left = height + offset/2, right = height - offset/2,
+// angle sensor = heading. Sequential scalar updates, no matrix inversion.
+// Float: the esp32s3 has a single precision FPU and this runs once per tick.
+
+#define KALMAN_N 4
+
+enum KalmanState {
+    Kalman_offset = 0,
+    Kalman_heading = 1,
+    Kalman_bias = 2,
+    Kalman_height = 3
+};
+
+typedef struct {
+    // configuration
+    float q[KALMAN_N];      // process noise density, unit^2/s
+    float r_row;            // variance of a row sensor, %^2
+    float r_angle;          // variance of the angle sensor, deg^2
+    float pct_per_m;        // offset units per m, 0 = heading not coupled to the offset
+
+    // state
+    float x[KALMAN_N];
+    float P[KALMAN_N][KALMAN_N];
+    uint8_t started;
+} Kalman;
+
+typedef struct {
+    float offset;
+    float heading;
+    float height;
+} KalmanEstimate;
+
+// configuration to be filled by the caller, the state is reset
+void kalman_init(Kalman * kf);
+void kalman_reset(Kalman * kf);
+
+// yaw_ok = 0: no IMU, the heading is a random walk
+void kalman_predict(Kalman * kf, float dt, float speed_m_s, float yaw_rate_deg_s, int yaw_ok);
+void kalman_update_rows(Kalman * kf, float left, float right);
+void kalman_update_angle(Kalman * kf, float heading_deg);
+
+// latency compensation: the filter runs at the time of the measurements,
+// the estimate is extrapolated with the model over the latency
+void kalman_estimate(const Kalman * kf, float latency_s, float speed_m_s, float yaw_rate_deg_s, int yaw_ok, KalmanEstimate * est);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
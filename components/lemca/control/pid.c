@@ -0,0 +1,120 @@
+#include "pid.h"
+
+#define Q16_MAX 0x7FFFFFFF
+#define Q16_MIN (-0x7FFFFFFF - 1)
+
+static q16_t q16_sat(int64_t x){
+    if(x > Q16_MAX){
+        return Q16_MAX;
+    }
+    if(x < Q16_MIN){
+        return Q16_MIN;
+    }
+    return (q16_t)x;
+}
+
+static int64_t q40_clamp(int64_t x, q16_t limit){
+    int64_t max = (int64_t)limit << 24;
+    if(x > max){
+        return max;
+    }
+    if(x < -max){
+        return -max;
+    }
+    return x;
+}
+
+static q16_t q40_to_q16(int64_t x){
+    return (q16_t)((x + (1 << 23)) >> 24);
+}
+
+static q16_t q16_clamp(q16_t x, q16_t min, q16_t max){
+    if(x > max){
+        return max;
+    }
+    if(x < min){
+        return min;
+    }
+    return x;
+}
+
+void pid_init(Pid * pid, uint32_t period_us){
+    pid->kp = 0;
+    pid->ki = 0;
+    pid->kd = 0;
+    pid->kaw = 0;
+    pid->d_alpha = Q16_ONE;
+    pid->i_max = Q16_MAX;
+    pid->out_min = Q16_MIN;
+    pid->out_max = Q16_MAX;
+    pid->dt_q24 = (int32_t)(((int64_t)period_us * (1 << 24) + 500000) / 1000000);
+    pid->inv_dt = (q16_t)((1000000LL * Q16_ONE + period_us / 2) / period_us);
+    pid_reset(pid);
+}
+
+void pid_reset(Pid * pid){
+    pid->integral_q40 = 0;
+    pid->integral = 0;
+    pid->d_filtered = 0;
+    pid->prev_error = 0;
+    pid->started = 0;
+}
+
+q16_t pid_step(Pid * pid, q16_t error, q16_t gain_scale){
+    q16_t kp = q16_mul(pid->kp, gain_scale);
+    q16_t ki = q16_mul(pid->ki, gain_scale);
+    q16_t kd = q16_mul(pid->kd, gain_scale);
+
+    // summed in Q40: rounded to Q16 at each step, error * dt drifted over a long error
+    pid->integral_q40 = q40_clamp(pid->integral_q40 + (int64_t)error * pid->dt_q24, pid->i_max);
+    pid->integral = q40_to_q16(pid->integral_q40);
+
+    if(kd != 0){
+        // no derivative kick on the first step
+        q16_t d_raw = pid->started ? q16_sat(((int64_t)(error - pid->prev_error) * pid->inv_dt) >> 16) : 0;
+        pid->d_filtered += q16_mul(pid->d_alpha, d_raw - pid->d_filtered);
+    }
+    pid->prev_error = error;
+    pid->started = 1;
+
+    int64_t out = (int64_t)q16_mul(kp, error) + q16_mul(ki, pid->integral);
+    if(kd != 0){
+        out += q16_mul(kd, pid->d_filtered);
+    }
+    q16_t out_sat = q16_clamp(q16_sat(out), pid->out_min, pid->out_max);
+
+    // back-calculation: bleed the integral by the saturation excess
+    if(out_sat != out && pid->kaw != 0 && ki != 0){
+        int64_t excess_q40 = (int64_t)q16_mul(pid->kaw, q16_sat(out_sat - out)) * pid->dt_q24;
+        int64_t step = excess_q40 / ki;
+        // beyond any i_max anyway, keeps the step in Q40 from overflowing with a tiny ki
+        if(step > (1LL << 40)){
+            step = 1LL << 40;
+        }
+        if(step < -(1LL << 40)){
+            step = -(1LL << 40);
+        }
+        pid->integral_q40 = q40_clamp(pid->integral_q40 + step * Q16_ONE, pid->i_max);
+        pid->integral = q40_to_q16(pid->integral_q40);
+    }
+    return out_sat;
+}
+
+q16_t pid_schedule_scale(const PidSchedule * schedule, int32_t speed_mm_s){
+    if(schedule->n == 0){
+        return Q16_ONE;
+    }
+    if(speed_mm_s <= schedule->speed_mm_s[0]){
+        return schedule->scale[0];
+    }
+    for(uint8_t i = 1; i < schedule->n; ++i){
+        int32_t s1 = schedule->speed_mm_s[i];
+        if(speed_mm_s < s1){
+            int32_t s0 = schedule->speed_mm_s[i - 1];
+            q16_t k0 = schedule->scale[i - 1];
+            q16_t k1 = schedule->scale[i];
+            return k0 + (q16_t)(((int64_t)(k1 - k0) * (speed_mm_s - s0)) / (s1 - s0));
+        }
+    }
+    return schedule->scale[schedule->n - 1];
+}
@@ -0,0 +1,55 @@
+#ifndef LEMCA_PID_H_
+#define LEMCA_PID_H_
+
+#include <stdint.h>
+
+#include "../common/q16.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PID_SCHEDULE_POINTS 4
+
+// gain factor interpolated on the speed, n = 0 -> 1.0
+typedef struct {
+    uint8_t n;
+    int32_t speed_mm_s[PID_SCHEDULE_POINTS]; // increasing
+    q16_t scale[PID_SCHEDULE_POINTS];
+} PidSchedule;
+
+typedef struct {
+    // configuration
+    q16_t kp;
+    q16_t ki;           // on the integral of the error (error * s)
+    q16_t kd;           // on the filtered derivative of the error
+    q16_t kaw;          // back-calculation anti-windup gain, 1/s
+    q16_t d_alpha;      // derivative low pass, Q16_ONE = not filtered
+    q16_t i_max;        // clamp of the integral of the error, both signs
+    q16_t out_min;
+    q16_t out_max;
+    int32_t dt_q24;     // s, Q8.24: 1311/65536 s in Q16 drifted the integral by 2e-4
+    q16_t inv_dt;       // 1/s
+
+    // state
+    int64_t integral_q40;   // error * dt summed without rounding, Q24.40
+    q16_t integral;         // rounded to Q16
+    q16_t d_filtered;
+    q16_t prev_error;
+    uint8_t started;
+} Pid;
+
+// all gains 0, no anti-windup, no clamp and no output limits
+void pid_init(Pid * pid, uint32_t period_us);
+void pid_reset(Pid * pid);
+
+// one step, the gains are multiplied by gain_scale (see pid_schedule_scale)
+q16_t pid_step(Pid * pid, q16_t error, q16_t gain_scale);
+
+q16_t pid_schedule_scale(const PidSchedule * schedule, int32_t speed_mm_s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+#include "control_task.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_err.h"
+
+#include "lemca.h"
+#include "AppCommon/AppHW.h"
+
+#define CONTROL_TASK_CORE 1
+#define CONTROL_TASK_PRIORITY (configMAX_PRIORITIES - 3)
+#define CONTROL_TASK_STACK 4096
+
+static TaskHandle_t s_control_task = NULL;
+static esp_timer_handle_t s_control_timer = NULL;
+
+// low 32 bits of the timer expiry, a 32 bits store is atomic between the two cores
+static volatile uint32_t s_tick_us = 0;
+
+static ControlTaskStats s_stats;
+
+static void control_timer_cb(void * arg){
+    s_tick_us = (uint32_t)esp_timer_get_time();
+    xTaskNotifyGive(s_control_task);
+}
+
+static void control_task(void * arg){
+    for(;;){
+        uint32_t pending = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t start_us = esp_timer_get_time();
+
+        uint32_t latency_us = (uint32_t)start_us - s_tick_us;
+        if(pending > 1){
+            s_stats.overruns += pending - 1;
+        }
+
+        lemca_control_step(start_us);
+
+        uint32_t exec_us = (uint32_t)(esp_timer_get_time() - start_us);
+        s_stats.last_latency_us = latency_us;
+        if(latency_us > s_stats.max_latency_us){
+            s_stats.max_latency_us = latency_us;
+        }
+        s_stats.last_exec_us = exec_us;
+        if(exec_us > s_stats.max_exec_us){
+            s_stats.max_exec_us = exec_us;
+        }
+        s_stats.cycles++;
+    }
+}
+
+void control_task_start(){
+    if(s_control_task != NULL){
+        return;
+    }
+    hw_DebugPrint("*** control_task_start %i Hz on core %i\n", CONTROL_RATE_HZ, CONTROL_TASK_CORE);
+    lemca_control_init();
+
+    xTaskCreatePinnedToCore(control_task, "lemca_ctrl", CONTROL_TASK_STACK, NULL,
+        CONTROL_TASK_PRIORITY, &s_control_task, CONTROL_TASK_CORE);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = &control_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "lemca_ctrl"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_control_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(s_control_timer, CONTROL_PERIOD_US));
+}
+
+void control_task_get_stats(ControlTaskStats * stats){
+    *stats = s_stats;
+}
+
+void control_task_reset_max(){
+    s_stats.max_latency_us = 0;
+    s_stats.max_exec_us = 0;
+}
+
+void control_task_print_stats(){
+    ControlTaskStats stats;
+    control_task_get_stats(&stats);
+    hw_DebugPrint("*** control cycles %u overruns %u latency %u/%u us exec %u/%u us\n",
+        stats.cycles, stats.overruns,
+        stats.last_latency_us, stats.max_latency_us,
+        stats.last_exec_us, stats.max_exec_us);
+}
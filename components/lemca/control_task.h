@@ -0,0 +1,38 @@
+#ifndef CONTROL_TASK_H_
+#define CONTROL_TASK_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(CONFIG_LEMCA_CONTROL_RATE_HZ)
+#define CONTROL_RATE_HZ CONFIG_LEMCA_CONTROL_RATE_HZ
+#else
+#define CONTROL_RATE_HZ 50
+#endif
+
+#define CONTROL_PERIOD_US (1000000/CONTROL_RATE_HZ)
+
+typedef struct {
+    uint32_t cycles;
+    uint32_t overruns;        // ticks missed because the previous step was still running
+    uint32_t last_latency_us; // timer expiry -> start of the step
+    uint32_t max_latency_us;
+    uint32_t last_exec_us;    // duration of the step
+    uint32_t max_exec_us;
+} ControlTaskStats;
+
+// starts the periodic timer and the control task pinned on core 1
+void control_task_start();
+
+void control_task_get_stats(ControlTaskStats * stats);
+void control_task_reset_max();
+void control_task_print_stats();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,233 @@
+#include "dsp_filter.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "hal/cpu_hal.h"
+
+#include "AppCommon/AppHW.h"
+
+#define DSP_BIQUAD_SHIFT 14
+#define DSP_SELFTEST_LEN 256
+
+#if defined(CONFIG_LEMCA_ESP_DSP)
+// cleared by dsp_filter_selftest() when esp-dsp does not match the scalar FIR
+static int s_use_esp_dsp = 1;
+#endif
+
+static int16_t sat16(int64_t x){
+    if(x > INT16_MAX){
+        return INT16_MAX;
+    }
+    if(x < INT16_MIN){
+        return INT16_MIN;
+    }
+    return (int16_t)x;
+}
+
+void dsp_fir_decim_init(DspFirDecim * fir, int n_taps, int decim, float cutoff){
+    if(n_taps > DSP_FIR_MAX_TAPS){
+        n_taps = DSP_FIR_MAX_TAPS;
+    }
+    if(decim > DSP_FIR_MAX_DECIM){
+        decim = DSP_FIR_MAX_DECIM;
+    }
+    fir->n_taps = n_taps;
+    fir->decim = decim;
+    fir->pos = 0;
+    fir->phase = 0;
+    memset(fir->delay, 0, sizeof(fir->delay));
+
+    // half of the taps, mirrored: symmetric, so the tap order of esp-dsp
+    // (oldest sample first) gives the same result
+    float h[DSP_FIR_MAX_TAPS];
+    float sum = 0;
+    float m = (n_taps - 1) / 2.0f;
+    for(int k = 0; k < (n_taps + 1) / 2; ++k){
+        float t = k - m;
+        float sinc = (t == 0) ? 2 * cutoff : sinf(2 * (float)M_PI * cutoff * t) / ((float)M_PI * t);
+        float w = 0.54f - 0.46f * cosf(2 * (float)M_PI * k / (n_taps - 1));
+        h[k] = sinc * w;
+        h[n_taps - 1 - k] = h[k];
+    }
+    for(int k = 0; k < n_taps; ++k){
+        sum += h[k];
+    }
+    int32_t total = 0;
+    for(int k = 0; k < (n_taps + 1) / 2; ++k){
+        fir->taps[k] = (int16_t)lrintf(h[k] / sum * 32768);
+        fir->taps[n_taps - 1 - k] = fir->taps[k];
+    }
+    for(int k = 0; k < n_taps; ++k){
+        total += fir->taps[k];
+    }
+    // DC gain of 1 up to one LSB, kept symmetric
+    int32_t residual = 32768 - total;
+    fir->taps[n_taps / 2] += (n_taps & 1) ? residual : residual / 2;
+    fir->taps[(n_taps - 1) / 2] += (n_taps & 1) ? 0 : residual / 2;
+
+#if defined(CONFIG_LEMCA_ESP_DSP)
+    memcpy(fir->dsp_taps, fir->taps, sizeof(fir->taps));
+    memset(fir->dsp_delay, 0, sizeof(fir->dsp_delay));
+    dsps_fird_init_s16(&fir->dsp, fir->dsp_taps, fir->dsp_delay, n_taps, decim, 0, 0);
+#endif
+}
+
+int dsp_fir_decim_scalar(DspFirDecim * fir, const int16_t * in, int n_in, int16_t * out){
+    int n_out = 0;
+    for(int i = 0; i < n_in; ++i){
+        fir->delay[fir->pos] = in[i];
+        fir->pos = (fir->pos + 1 == fir->n_taps) ? 0 : fir->pos + 1;
+        if(++fir->phase < fir->decim){
+            continue;
+        }
+        fir->phase = 0;
+        // taps[0] on the newest sample
+        int64_t acc = 1 << 14;
+        int p = fir->pos;
+        for(int k = 0; k < fir->n_taps; ++k){
+            p = (p == 0) ? fir->n_taps - 1 : p - 1;
+            acc += (int32_t)fir->taps[k] * fir->delay[p];
+        }
+        out[n_out++] = sat16(acc >> 15);
+    }
+    return n_out;
+}
+
+#if defined(CONFIG_LEMCA_ESP_DSP)
+// whole decimation blocks go straight to esp-dsp, the rest waits in dsp_pending
+static int dsp_fir_decim_esp(DspFirDecim * fir, const int16_t * in, int n_in, int16_t * out){
+    int n_out = 0;
+    if(fir->phase > 0){
+        int take = fir->decim - fir->phase;
+        if(take > n_in){
+            take = n_in;
+        }
+        memcpy(&fir->dsp_pending[fir->phase], in, take * sizeof(int16_t));
+        fir->phase += take;
+        in += take;
+        n_in -= take;
+        if(fir->phase < fir->decim){
+            return 0;
+        }
+        n_out += dsps_fird_s16(&fir->dsp, fir->dsp_pending, out, 1);
+        fir->phase = 0;
+    }
+    int blocks = n_in / fir->decim;
+    if(blocks > 0){
+        n_out += dsps_fird_s16(&fir->dsp, in, out + n_out, blocks);
+    }
+    int rest = n_in - blocks * fir->decim;
+    memcpy(fir->dsp_pending, in + blocks * fir->decim, rest * sizeof(int16_t));
+    fir->phase = rest;
+    return n_out;
+}
+#endif
+
+int dsp_fir_decim(DspFirDecim * fir, const int16_t * in, int n_in, int16_t * out){
+#if defined(CONFIG_LEMCA_ESP_DSP)
+    if(s_use_esp_dsp){
+        return dsp_fir_decim_esp(fir, in, n_in, out);
+    }
+#endif
+    return dsp_fir_decim_scalar(fir, in, n_in, out);
+}
+
+void dsp_biquad_lowpass(DspBiquad * bq, float cutoff, float q){
+    float w0 = 2 * (float)M_PI * cutoff;
+    float alpha = sinf(w0) / (2 * q);
+    float c = cosf(w0);
+    float a0 = 1 + alpha;
+    float one = 1 << DSP_BIQUAD_SHIFT;
+    bq->b0 = lrintf((1 - c) / 2 / a0 * one);
+    bq->b2 = bq->b0;
+    bq->a1 = lrintf(-2 * c / a0 * one);
+    bq->a2 = lrintf((1 - alpha) / a0 * one);
+    // DC gain exactly 1 with the rounded coefficients: b0 + b1 + b2 = 1 + a1 + a2
+    bq->b1 = (1 << DSP_BIQUAD_SHIFT) + bq->a1 + bq->a2 - 2 * bq->b0;
+    dsp_biquad_reset(bq, 0);
+}
+
+void dsp_biquad_reset(DspBiquad * bq, int32_t x){
+    bq->x1 = x;
+    bq->x2 = x;
+    bq->y1 = x;
+    bq->y2 = x;
+    bq->err = 0;
+}
+
+int32_t dsp_biquad(DspBiquad * bq, int32_t x){
+    // at low cutoffs the poles are close to 1 and amplify the rounding of y,
+    // the fed back error keeps it out of the low frequencies
+    int64_t acc = (int64_t)bq->b0 * x + (int64_t)bq->b1 * bq->x1 + (int64_t)bq->b2 * bq->x2
+        - (int64_t)bq->a1 * bq->y1 - (int64_t)bq->a2 * bq->y2 + bq->err;
+    int32_t y = (int32_t)((acc + (1 << (DSP_BIQUAD_SHIFT - 1))) >> DSP_BIQUAD_SHIFT);
+    bq->err = (int32_t)(acc - ((int64_t)y << DSP_BIQUAD_SHIFT));
+    bq->x2 = bq->x1;
+    bq->x1 = x;
+    bq->y2 = bq->y1;
+    bq->y1 = y;
+    return y;
+}
+
+void dsp_moving_average_init(DspMovingAverage * ma, int n){
+    if(n < 1){
+        n = 1;
+    }
+    if(n > DSP_MA_MAX){
+        n = DSP_MA_MAX;
+    }
+    ma->n = n;
+    ma->pos = 0;
+    ma->filled = 0;
+    ma->sum = 0;
+}
+
+int32_t dsp_moving_average(DspMovingAverage * ma, int32_t x){
+    if(ma->filled < ma->n){
+        // start: mean of the samples received so far
+        ma->buf[ma->filled++] = x;
+        ma->sum += x;
+        return ma->sum / ma->filled;
+    }
+    ma->sum += x - ma->buf[ma->pos];
+    ma->buf[ma->pos] = x;
+    ma->pos = (ma->pos + 1 == ma->n) ? 0 : ma->pos + 1;
+    return ma->sum / ma->n;
+}
+
+int dsp_filter_selftest(void){
+#if defined(CONFIG_LEMCA_ESP_DSP)
+    static int16_t in[DSP_SELFTEST_LEN];
+    static int16_t out_ref[DSP_SELFTEST_LEN];
+    static int16_t out_dsp[DSP_SELFTEST_LEN];
+    static DspFirDecim fir;
+
+    // 12 bits sensor-like signal with spikes
+    uint32_t seed = 12345;
+    for(int i = 0; i < DSP_SELFTEST_LEN; ++i){
+        seed = seed * 1664525 + 1013904223;
+        in[i] = 2048 + (int16_t)((seed >> 20) & 0xFF) - 128 + ((i % 37) == 0 ? 1500 : 0);
+    }
+
+    dsp_fir_decim_init(&fir, DSP_FIR_MAX_TAPS, 8, 0.5f / 8);
+    uint32_t start = cpu_hal_get_cycle_count();
+    int n_ref = dsp_fir_decim_scalar(&fir, in, DSP_SELFTEST_LEN, out_ref);
+    uint32_t cycles_scalar = cpu_hal_get_cycle_count() - start;
+
+    dsp_fir_decim_init(&fir, DSP_FIR_MAX_TAPS, 8, 0.5f / 8);
+    start = cpu_hal_get_cycle_count();
+    int n_dsp = dsp_fir_decim_esp(&fir, in, DSP_SELFTEST_LEN, out_dsp);
+    uint32_t cycles_dsp = cpu_hal_get_cycle_count() - start;
+    int mismatch = (n_dsp != n_ref);
+    for(int i = 0; i < n_ref && !mismatch; ++i){
+        mismatch = (out_dsp[i] != out_ref[i]);
+    }
+    s_use_esp_dsp = !mismatch;
+    hw_DebugPrint("*** dsp fir scalar %u esp-dsp %u cycles/input, %s\n", cycles_scalar / DSP_SELFTEST_LEN,
+        cycles_dsp / DSP_SELFTEST_LEN, mismatch ? "MISMATCH, scalar used" : "bit exact");
+    return s_use_esp_dsp;
+#else
+    return 0;
+#endif
+}
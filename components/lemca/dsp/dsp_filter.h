@@ -0,0 +1,83 @@
+#ifndef LEMCA_DSP_FILTER_H_
+#define LEMCA_DSP_FILTER_H_
+
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#if defined(CONFIG_LEMCA_ESP_DSP)
+#include "dsps_fir.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Integer filter kernels of the sensor pipeline. The scalar versions are the
+// reference; with CONFIG_LEMCA_ESP_DSP the FIR runs on the esp-dsp s16
+// decimator (PIE SIMD on the esp32s3), checked against the scalar one at boot.
+
+#define DSP_FIR_MAX_TAPS 32     // multiple of 8 for the esp-dsp version
+#define DSP_FIR_MAX_DECIM 16
+#define DSP_MA_MAX 32
+
+// FIR low pass + decimation, Q15 taps, int16 in and out:
+//   out = sat16((sum taps[k] * in[n - k] + 2^14) >> 15), one output every decim inputs
+typedef struct {
+    int16_t taps[DSP_FIR_MAX_TAPS];
+    int16_t delay[DSP_FIR_MAX_TAPS];
+    int16_t n_taps;
+    int16_t decim;
+    int16_t pos;        // next write in delay
+    int16_t phase;      // inputs since the last output
+#if defined(CONFIG_LEMCA_ESP_DSP)
+    fir_s16_t dsp;
+    int16_t dsp_taps[DSP_FIR_MAX_TAPS] __attribute__((aligned(16)));
+    int16_t dsp_delay[DSP_FIR_MAX_TAPS + 8] __attribute__((aligned(16)));
+    int16_t dsp_pending[DSP_FIR_MAX_DECIM];     // start of a decimation block
+#endif
+} DspFirDecim;
+
+// direct form I, Q14 coefficients (a0 = 1), int32 samples, with the rounding
+// error of the output fed back into the next step (first order noise shaping)
+typedef struct {
+    int32_t b0, b1, b2, a1, a2;
+    int32_t x1, x2, y1, y2;
+    int32_t err;
+} DspBiquad;
+
+// running sum, one add and one subtract per sample
+typedef struct {
+    int32_t buf[DSP_MA_MAX];
+    int32_t sum;
+    uint8_t n;
+    uint8_t pos;
+    uint8_t filled;
+} DspMovingAverage;
+
+// windowed sinc (Hamming), cutoff as a fraction of the input rate, DC gain 1
+void dsp_fir_decim_init(DspFirDecim * fir, int n_taps, int decim, float cutoff);
+// returns the number of outputs, n_in / decim rounded by the phase
+int dsp_fir_decim(DspFirDecim * fir, const int16_t * in, int n_in, int16_t * out);
+int dsp_fir_decim_scalar(DspFirDecim * fir, const int16_t * in, int n_in, int16_t * out);
+
+// RBJ low pass, cutoff as a fraction of the sample rate, Q = 0.707 for Butterworth
+void dsp_biquad_lowpass(DspBiquad * bq, float cutoff, float q);
+// first output = x, without the start transient
+void dsp_biquad_reset(DspBiquad * bq, int32_t x);
+int32_t dsp_biquad(DspBiquad * bq, int32_t x);
+
+void dsp_moving_average_init(DspMovingAverage * ma, int n);
+int32_t dsp_moving_average(DspMovingAverage * ma, int32_t x);
+
+// with CONFIG_LEMCA_ESP_DSP: compares the esp-dsp FIR with the scalar one on the
+// target (the esp-dsp path is disabled when they differ) and prints the cycles
+// per input of both. Returns 1 when dsp_fir_decim runs on esp-dsp. The kernels
+// are checked and timed on the host by host/bench/bench_dsp.c.
+int dsp_filter_selftest(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,13 +8,12 @@
 #include "AppIso/config.h"
 #include "AppCommon/AppHW.h"
 
-#include "driver/adc.h"
+#include "adc/adc_sampler.h"
+#include "adc/adc_calib.h"
+#include "valve/valve_output.h"
+#include "Settings/settings.h"
 
-#define CAPTEUR_ANGLE_PIN ADC2_CHANNEL_0
-#define CAPTEUR_H_PIN ADC2_CHANNEL_1
-
-#define CAPTEUR_MACHINE_L ADC2_CHANNEL_3
-#define CAPTEUR_MACHINE_R ADC2_CHANNEL_2
+// sensors on ADC2 channels 0, 1, 3, 2, see adc/adc_sampler.c
 
 #define MOTOR_L_PWM GPIO_NUM_15 //pwm
 #define MOTOR_R_PWM GPIO_NUM_16 //pwm
@@ -22,18 +21,15 @@
 #define MOTOR_D_PWM GPIO_NUM_18 //pwm
 
 void initADC(){
-    adc2_config_channel_atten( CAPTEUR_ANGLE_PIN, ADC_ATTEN_11db );
-    adc2_config_channel_atten( CAPTEUR_H_PIN, ADC_ATTEN_11db );
-    adc1_config_width(ADC_WIDTH_BIT_12);
-    adc2_config_channel_atten( CAPTEUR_MACHINE_L, ADC_ATTEN_11db );
-    adc2_config_channel_atten( CAPTEUR_MACHINE_R, ADC_ATTEN_11db );
+    adc_calib_init();
+    adc_sampler_start();
 }
 
 ledc_timer_config_t ledc_timer = {
     .speed_mode = LEDC_LOW_SPEED_MODE,
     .timer_num  = LEDC_TIMER_0,
     .duty_resolution = LEDC_TIMER_13_BIT,
-    .freq_hz = 1000,
+    .freq_hz = VALVE_PWM_FREQ_HZ,
     .clk_cfg = LEDC_AUTO_CLK
 };
 ledc_channel_config_t ledc_channel[4];
@@ -62,6 +58,7 @@ static void initPwm(void)
         
         ESP_ERROR_CHECK(ledc_channel_config(&ledc_channel[i]));
     }
+    valve_output_init(getS32("LEMCA", "VALVE_RAMP_MS", 0) * 1000);
 
     /*gpio_set_direction_out(MOTOR_L_PWM);
     gpio_set_direction_out(MOTOR_R_PWM);
@@ -79,24 +76,23 @@ void setup_gpio(){
 void update_gpio(int millis){
 }
 
-void readAll2(int * capteur_angle, int * capteur_h, int * machine_l, int * machine_r){
-    adc2_get_raw(CAPTEUR_ANGLE_PIN, ADC_WIDTH_BIT_DEFAULT, capteur_angle);
-    adc2_get_raw(CAPTEUR_H_PIN, ADC_WIDTH_BIT_DEFAULT, capteur_h);
-    adc2_get_raw(CAPTEUR_MACHINE_L, ADC_WIDTH_BIT_DEFAULT, machine_l);
-    adc2_get_raw(CAPTEUR_MACHINE_R, ADC_WIDTH_BIT_DEFAULT, machine_r);
+// filtered values of the sampler task, no conversion here
+int64_t readAll2(int * capteur_angle, int * capteur_h, int * machine_l, int * machine_r){
+    AdcSamples samples;
+    adc_sampler_read(&samples);
+    *capteur_angle = samples.raw[AdcSensor_angle];
+    *capteur_h = samples.raw[AdcSensor_h];
+    *machine_l = samples.raw[AdcSensor_machine_l];
+    *machine_r = samples.raw[AdcSensor_machine_r];
+    return samples.timestamp_us;
 }
 
+// the four channels are written together, see valve/valve_output.c
 void setElectrovanne(int left, int right, int up, int down){
-    ESP_ERROR_CHECK(ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, left));
-    ESP_ERROR_CHECK(ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0));
-
-    ESP_ERROR_CHECK(ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_1, right));
-    ESP_ERROR_CHECK(ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_1));
-
-    ESP_ERROR_CHECK(ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_2, up));
-    ESP_ERROR_CHECK(ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_2));
-
-    ESP_ERROR_CHECK(ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_3, down));
-    ESP_ERROR_CHECK(ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_3));
-        
-}
\ No newline at end of file
+    uint32_t duty[Valve_count];
+    duty[Valve_left] = left > 0 ? left : 0;
+    duty[Valve_right] = right > 0 ? right : 0;
+    duty[Valve_up] = up > 0 ? up : 0;
+    duty[Valve_down] = down > 0 ? down : 0;
+    valve_output_write(duty);
+}
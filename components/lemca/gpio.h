@@ -9,7 +9,8 @@ extern "C" {
 
 extern void setup_gpio();
 
-void readAll2(int * capteur_angle, int * capteur_h, int * machine_l, int * machine_r);
+// returns the time of the samples (esp_timer), 0 before the first one
+int64_t readAll2(int * capteur_angle, int * capteur_h, int * machine_l, int * machine_r);
 void setElectrovanne(int left, int right, int up, int down);
 
 #ifdef __cplusplus
@@ -0,0 +1,134 @@
+#include "imu.h"
+
+#include <string.h>
+
+// 11 bytes frames: 0x55, type, 4 little endian int16, sum of the first 10 bytes
+#define IMU_FRAME_HEADER 0x55
+#define IMU_FRAME_SIZE 11
+
+#define IMU_FRAME_ACC 0x51
+#define IMU_FRAME_GYRO 0x52
+#define IMU_FRAME_ANGLE 0x53
+
+#define IMU_HISTORY_MASK (IMU_HISTORY_SIZE - 1)
+
+static uint8_t s_frame[IMU_FRAME_SIZE];
+static uint32_t s_frame_len = 0;
+
+// last gyro frame, merged in the sample of the next angle frame
+static int32_t s_roll_rate_cdeg_s = 0;
+static int32_t s_pitch_rate_cdeg_s = 0;
+static int32_t s_yaw_rate_cdeg_s = 0;
+
+// written only by imu_parse(), s_history_count is the publication point
+static ImuSample s_history[IMU_HISTORY_SIZE];
+static uint32_t s_history_count = 0;
+
+static ImuStats s_stats;
+
+static int16_t imu_s16(const uint8_t * p){
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+// +-32768 -> +-180 deg
+static int16_t imu_angle_cdeg(const uint8_t * p){
+    return (int16_t)(((int32_t)imu_s16(p) * 18000) >> 15);
+}
+
+// +-32768 -> +-2000 deg/s, 200000/32768 = 6250/1024
+static int32_t imu_rate_cdeg_s(const uint8_t * p){
+    return ((int32_t)imu_s16(p) * 6250) >> 10;
+}
+
+static void imu_push(const ImuSample * sample){
+    uint32_t count = s_history_count;
+    s_history[count & IMU_HISTORY_MASK] = *sample;
+    __atomic_store_n(&s_history_count, count + 1, __ATOMIC_RELEASE);
+    s_stats.samples++;
+}
+
+static void imu_frame(const uint8_t * f, int64_t now_us){
+    s_stats.frames++;
+    if(f[1] == IMU_FRAME_GYRO){
+        s_roll_rate_cdeg_s = imu_rate_cdeg_s(f + 2);
+        s_pitch_rate_cdeg_s = imu_rate_cdeg_s(f + 4);
+        s_yaw_rate_cdeg_s = imu_rate_cdeg_s(f + 6);
+    } else if(f[1] == IMU_FRAME_ANGLE){
+        ImuSample sample;
+        sample.timestamp_us = now_us;
+        sample.roll_cdeg = imu_angle_cdeg(f + 2);
+        sample.pitch_cdeg = imu_angle_cdeg(f + 4);
+        sample.yaw_cdeg = imu_angle_cdeg(f + 6);
+        sample.reserved = 0;
+        sample.roll_rate_cdeg_s = s_roll_rate_cdeg_s;
+        sample.pitch_rate_cdeg_s = s_pitch_rate_cdeg_s;
+        sample.yaw_rate_cdeg_s = s_yaw_rate_cdeg_s;
+        imu_push(&sample);
+    }
+}
+
+static void imu_read_char(uint8_t c, int64_t now_us){
+    if(s_frame_len == 0 && c != IMU_FRAME_HEADER){
+        s_stats.skipped_bytes++;
+        return;
+    }
+    s_frame[s_frame_len++] = c;
+    if(s_frame_len < IMU_FRAME_SIZE){
+        return;
+    }
+
+    uint8_t sum = 0;
+    for(int i = 0; i < IMU_FRAME_SIZE - 1; ++i){
+        sum += s_frame[i];
+    }
+    if(sum == s_frame[IMU_FRAME_SIZE - 1]){
+        imu_frame(s_frame, now_us);
+        s_frame_len = 0;
+        return;
+    }
+
+    // corrupted: restart on the next header already received
+    s_stats.checksum_errors++;
+    uint32_t i = 1;
+    while(i < IMU_FRAME_SIZE && s_frame[i] != IMU_FRAME_HEADER){
+        ++i;
+    }
+    s_stats.skipped_bytes += i;
+    s_frame_len = IMU_FRAME_SIZE - i;
+    memmove(s_frame, s_frame + i, s_frame_len);
+}
+
+void imu_parse(const uint8_t * data, uint32_t len, int64_t now_us){
+    for(uint32_t i = 0; i < len; ++i){
+        imu_read_char(data[i], now_us);
+    }
+}
+
+int imu_get_latest(ImuSample * sample){
+    return imu_get_history(sample, 1) == 1;
+}
+
+uint32_t imu_get_history(ImuSample * samples, uint32_t n){
+    if(n > IMU_HISTORY_SIZE - 1){
+        n = IMU_HISTORY_SIZE - 1;
+    }
+    uint32_t count;
+    uint32_t after;
+    do {
+        count = __atomic_load_n(&s_history_count, __ATOMIC_ACQUIRE);
+        if(n > count){
+            n = count;
+        }
+        for(uint32_t i = 0; i < n; ++i){
+            samples[i] = s_history[(count - 1 - i) & IMU_HISTORY_MASK];
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&s_history_count, __ATOMIC_RELAXED);
+        // the oldest slot copied is overwritten once the writer wraps on it
+    } while(after - count + n >= IMU_HISTORY_SIZE);
+    return n;
+}
+
+void imu_get_stats(ImuStats * stats){
+    *stats = s_stats;
+}
@@ -0,0 +1,45 @@
+#ifndef LEMCA_IMU_H_
+#define LEMCA_IMU_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMU_HISTORY_SIZE 16 // power of 2
+
+typedef struct {
+    int64_t timestamp_us;    // esp_timer_get_time() of the angle frame
+    int16_t roll_cdeg;       // 0.01 deg
+    int16_t pitch_cdeg;
+    int16_t yaw_cdeg;
+    int16_t reserved;
+    int32_t roll_rate_cdeg_s; // 0.01 deg/s
+    int32_t pitch_rate_cdeg_s;
+    int32_t yaw_rate_cdeg_s;
+} ImuSample;
+
+typedef struct {
+    uint32_t frames;           // frames with a valid checksum
+    uint32_t samples;          // samples pushed in the history
+    uint32_t checksum_errors;
+    uint32_t skipped_bytes;    // bytes dropped while looking for a frame header
+} ImuStats;
+
+// incremental decoder, data can be any slice of the stream
+void imu_parse(const uint8_t * data, uint32_t len, int64_t now_us);
+
+// lock-free readers, callable from the control task on core 1
+// return 0 while no sample was received
+int imu_get_latest(ImuSample * sample);
+// copies up to n samples, newest first, returns the number copied
+uint32_t imu_get_history(ImuSample * samples, uint32_t n);
+
+void imu_get_stats(ImuStats * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
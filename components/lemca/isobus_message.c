@@ -7,6 +7,9 @@
 #include "lemca.h"
 
 #include "uart/my_uart.h"
+#include "pgn_dispatch.h"
+#include "speed/speed.h"
+
 void debugIsobusMessage(uint8_t canNode_u8, twai_message_t* twai_msg_ps, uint8_t isRX){
     /*uint32_t u32PGN;
     u32PGN = (twai_msg_ps->identifier & 0x03FFFF00uL) >> 8u;
@@ -21,7 +24,7 @@ void debugIsobusMessage(uint8_t canNode_u8, twai_message_t* twai_msg_ps, uint8_t
          twai_msg_ps->data[4], twai_msg_ps->data[5], twai_msg_ps->data[6], twai_msg_ps->data[7], u32PGN);*/
 }
 
-void OnLightingCommand(twai_message_t* twai_msg_ps){ //FE41 65089
+void OnLightingCommand(uint32_t pgn, uint8_t sa, const uint8_t * data, uint8_t dlc, int64_t rx_us){ //FE41 65089
     /*int daytime_running_lights = (twai_msg_ps->data[0] & 0x03);   //1.1
     int alternate_headlights = (twai_msg_ps->data[0] & 0x0C) >> 2;  //1.3
     int low_beam_headlights  = (twai_msg_ps->data[0] & 0x30) >> 4;  //1.5
@@ -56,9 +59,10 @@ void OnLightingCommand(twai_message_t* twai_msg_ps){ //FE41 65089
     }*/
 }
 
-void OnWheelBasesSpeed(twai_message_t* twai_msg_ps){ //FE48 65096
-    int speed = twai_msg_ps->data[0] | (twai_msg_ps->data[1] << 8);
-    double speed_km_h = 0.0036*speed;
+// same layout for the wheel based and the ground based speed, 0.001 m/s
+static void OnSpeed(SpeedSource source, const uint8_t * data, int64_t rx_us){
+    int speed = data[0] | (data[1] << 8);
+    int reverse = (data[7] & 0x03) == 0; //8.1 direction, 00 reverse, 01 forward
     /*int distance = (twai_msg_ps->data[5] << 24) | twai_msg_ps->data[4] << 16 | (twai_msg_ps->data[3] << 8) | twai_msg_ps->data[2];
     double distance_m = 0.001*distance;
     int power = twai_msg_ps->data[6];
@@ -76,10 +80,18 @@ void OnWheelBasesSpeed(twai_message_t* twai_msg_ps){ //FE48 65096
     hw_DebugPrint("$CAN_DEBUG,WHEEL_SPEED_3 , %f km/h,%f m,%f min\n",
          speed_km_h, distance_m, power);*/
 
-    setSpeedKmH(speed_km_h);
+    speed_set_can(source, speed, reverse, rx_us);
+}
+
+void OnWheelBasesSpeed(uint32_t pgn, uint8_t sa, const uint8_t * data, uint8_t dlc, int64_t rx_us){ //FE48 65096
+    OnSpeed(SpeedSource_wheel, data, rx_us);
 }
 
-void OnRearHitch(twai_message_t* twai_msg_ps){ //FE45 65093
+void OnGroundBasedSpeed(uint32_t pgn, uint8_t sa, const uint8_t * data, uint8_t dlc, int64_t rx_us){ //FE49 65097
+    OnSpeed(SpeedSource_ground, data, rx_us);
+}
+
+void OnRearHitch(uint32_t pgn, uint8_t sa, const uint8_t * data, uint8_t dlc, int64_t rx_us){ //FE45 65093
     //int position = (twai_msg_ps->data[0]);
     //double position_perc = 0.4*position;
     //int inwork = (twai_msg_ps->data[1] & 0xC0) >> 6;
@@ -94,30 +106,19 @@ void OnRearHitch(twai_message_t* twai_msg_ps){ //FE45 65093
     //setRearWork(inwork);
 }
 
-void onIsobusMessage(uint8_t canNode_u8, twai_message_t* twai_msg_ps, uint8_t isRX){
-    debugIsobusMessage(canNode_u8, twai_msg_ps, isRX);
-    uint32_t u32PGN;
-    u32PGN = (twai_msg_ps->identifier & 0x03FFFF00uL) >> 8u;
-    if ((u32PGN & 0x00FF00uL) < PGN_PDU2_240_X)
-    {  /* PDU 1 -> remove DA */
-        u32PGN &= 0x03FF00uL;
-    }
-    switch(u32PGN){
-        case PGN_LIGHTING_COMMAND: //FE41 65089
-            OnLightingCommand(twai_msg_ps);
-            break;
-        case PGN_REAR_HITCH: //FE45 65093
-            OnRearHitch(twai_msg_ps);
-            break;
-        case PGN_GROUND_BASED_SPEED: //Test PGN 65097 radar speed
-            OnWheelBasesSpeed(twai_msg_ps);
-            break;
-        
-    }
+// tractor broadcasts, ISO 11783-7 timeouts = 3 times the repetition rate
+void isobus_message_init(){
+    pgn_dispatch_register(PGN_LIGHTING_COMMAND, OnLightingCommand, 8, 3000); //FE41 65089
+    pgn_dispatch_register(PGN_REAR_HITCH, OnRearHitch, 8, 300); //FE45 65093
+    pgn_dispatch_register(PGN_WHEEL_BASED_SPEED, OnWheelBasesSpeed, 8, 300); //FE48 65096
+    pgn_dispatch_register(PGN_GROUND_BASED_SPEED, OnGroundBasedSpeed, 8, 300); //FE49 65097 radar speed
+}
 
+void onIsobusMessage(uint8_t canNode_u8, twai_message_t* twai_msg_ps, uint8_t isRX, int64_t rx_us){
+    debugIsobusMessage(canNode_u8, twai_msg_ps, isRX);
+    pgn_dispatch_frame(twai_msg_ps->identifier, twai_msg_ps->data, twai_msg_ps->data_length_code, rx_us);
 }
 
 
 
 //PGN_REAR_HITCH
-
@@ -8,7 +8,9 @@
 extern "C" {
 #endif
 
-extern void onIsobusMessage(uint8_t canNode_u8, twai_message_t* twai_msg_ps, uint8_t isRX);
+// registers the tractor PGN handlers in pgn_dispatch
+extern void isobus_message_init();
+extern void onIsobusMessage(uint8_t canNode_u8, twai_message_t* twai_msg_ps, uint8_t isRX, int64_t rx_us);
 
 #ifdef __cplusplus
 }
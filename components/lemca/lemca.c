@@ -1,6 +1,5 @@
 #include "lemca.h"
 
-#include "esp_timer.h"
 
 #include "common/util.h"
 #include "lib_cci/IsoVtcApi.h"
@@ -10,7 +9,19 @@
 
 #include "uart/my_uart.h"
 #include "gpio.h"
-#include "gpio.h"
+#include "control_task.h"
+#include "imu/imu.h"
+#include "speed/speed.h"
+#include "control/pid.h"
+#include "control/feedforward.h"
+#include "control/autotune.h"
+#include "control/kalman.h"
+#include "adc/adc_sampler.h"
+#include "adc/adc_calib.h"
+#include "valve/valve_output.h"
+#include "valve/valve_map.h"
+#include "vt/vt_queue.h"
+#include "pgn_dispatch.h"
 
 
 #include "Settings/settings.h"
@@ -25,7 +36,6 @@ typedef enum  {
 } TimeAction;
 
 
-const double max_value = 3200.0;
 
 int m_agress_hydr = 0;
 
@@ -36,14 +46,18 @@ int m_last_millis_alive = 0;
 
 //time fonction
 enum State m_state = 0; //0 off, 1 time, 2 up, 3 time
+// state asked by the VT and lemca_loop (core 0), applied by the control task
+// at the start of its next step: the loops are never reset in the middle of one
+#define STATE_REQUEST_NONE (-1)
+int m_state_request = STATE_REQUEST_NONE;
 int64_t m_last_millis_time = 0;
 TimeAction m_time_action = TimeAction_Off;
 
-double m_vitesse_max_ang = 100.0;
-double m_vitesse_max_h = 100.0;
+int m_vitesse_max_ang = 100;
+int m_vitesse_max_h = 100;
 
-double m_last_corr_angl_100 = 0;
-double m_last_corr_h_100 = 0;
+q16_t m_last_corr_angl_100 = 0;
+q16_t m_last_corr_h_100 = 0;
 
 int m_last_machine_a = 0;
 int m_last_machine_h = 0;
@@ -51,21 +65,64 @@ int m_last_machine_l = 0;
 int m_last_machine_r = 0;
 
 
-double m_last_machine_a_100 = 0;
-double m_last_machine_h_100 = 0;
-double m_last_machine_l_100 = 0;
-double m_last_machine_r_100 = 0;
+q16_t m_last_machine_a_100 = 0;
+q16_t m_last_machine_h_100 = 0;
+q16_t m_last_machine_l_100 = 0;
+q16_t m_last_machine_r_100 = 0;
+
+ImuSample m_last_imu;
+int m_imu_ok = 0;
+SpeedData m_speed;
+int m_speed_ok = 0;
 
 int m_work_h = 0;
 int m_last_millis_up = 0;
 
 
 double m_vitesse_simu = 0;
-double m_km_h = -1;
 
-const double sum_erreur_max = 10;
-double sum_error_ang = 0;
-double sum_error_h = 0;
+const int sum_erreur_max = 10;
+Pid m_pid_ang;
+Pid m_pid_h;
+// gain factor on the speed, empty = 1.0 at any speed
+// GAIN_N points of GAIN_Vi mm/s (increasing) and GAIN_Ki % of the gains
+PidSchedule m_gain_schedule = { 0 };
+Feedforward m_ff_ang;
+Feedforward m_ff_h;
+// feedforward: correction in % at 10 km/h, and in 1/100 % per %/s of error
+int m_ff_speed_ang = 0;
+int m_ff_speed_h = 0;
+int m_ff_rate_ang = 0;
+int m_ff_rate_h = 0;
+
+// gains found by the autotune, x1000, 0 = from m_agress_hydr
+int m_kp_ang_1000 = 0;
+int m_ki_ang_1000 = 0;
+int m_kp_h_1000 = 0;
+int m_ki_h_1000 = 0;
+// relay amplitude in %, hysteresis in 1/10 %
+int m_tune_relay = 30;
+int m_tune_hyst = 10;
+#define AUTOTUNE_CYCLES 4
+#define AUTOTUNE_TIMEOUT_US 60000000LL
+Autotune m_autotune;
+int m_autotune_axis = 0;
+volatile int m_autotune_save = 0;    // set by the control task, saved by lemca_loop
+
+// fusion of the sensors, the loops act on the estimate (see control/kalman.h)
+int m_kf_on = 1;
+int m_kf_r_row = 10;        // std of a row sensor, 1/10 %
+int m_kf_q_row = 50;        // offset and height drift, %/sqrt(s)
+int m_kf_q_head = 10;       // heading drift, 1/10 deg/sqrt(s)
+int m_kf_pct_m = 0;         // % of left - right per m of offset, 0 = not coupled
+int m_kf_ang_deg = 0;       // heading at 100 % of the angle sensor (50 % = 0 deg), 0 = not used
+int m_kf_lat_ms = 0;        // sensors delay before the ADC
+#define KF_IMU_TIMEOUT_US 100000
+#define KF_Q_BIAS 0.0001f   // (deg/s)^2/s
+Kalman m_kf;
+int64_t m_kf_last_us = 0;   // time of the measurements of the filter state
+q16_t m_est_offset_100 = 0;
+q16_t m_est_h_100 = 0;
 
 void verify_config(){
     if(m_work_h > 100){
@@ -76,11 +133,51 @@ void verify_config(){
     }
 }
 
+void load_gain_schedule(){
+    static const char * const keys_v[PID_SCHEDULE_POINTS] = { "GAIN_V0", "GAIN_V1", "GAIN_V2", "GAIN_V3" };
+    static const char * const keys_k[PID_SCHEDULE_POINTS] = { "GAIN_K0", "GAIN_K1", "GAIN_K2", "GAIN_K3" };
+    int n = getS32("LEMCA", "GAIN_N", 0);
+    if(n < 0){
+        n = 0;
+    }
+    if(n > PID_SCHEDULE_POINTS){
+        n = PID_SCHEDULE_POINTS;
+    }
+    m_gain_schedule.n = 0;
+    for(int i = 0; i < n; ++i){
+        int32_t speed_mm_s = getS32("LEMCA", keys_v[i], 0);
+        int32_t scale_100 = getS32("LEMCA", keys_k[i], 100);
+        // the interpolation needs increasing speeds, the points after a bad one are ignored
+        if(speed_mm_s < 0 || (i > 0 && speed_mm_s <= m_gain_schedule.speed_mm_s[i - 1])){
+            hw_DebugPrint("*** gain schedule: %s %d not increasing, %d points kept\n", keys_v[i], speed_mm_s, i);
+            break;
+        }
+        if(scale_100 < 0){
+            scale_100 = 0;
+        }
+        if(scale_100 > 1000){
+            scale_100 = 1000;
+        }
+        m_gain_schedule.speed_mm_s[i] = speed_mm_s;
+        m_gain_schedule.scale[i] = Q16_FROM_INT(scale_100) / 100;
+        m_gain_schedule.n = (uint8_t)(i + 1);
+    }
+}
+
 void print_config(){
     hw_DebugPrint("***- AGRESS_HYD %d\n",m_agress_hydr);
     hw_DebugPrint("***- WORK_H %d\n",m_work_h);
     hw_DebugPrint("***- V_MAX_H %d\n",m_vitesse_max_h);
     hw_DebugPrint("***- V_MAX_ANG %d\n",m_vitesse_max_ang);
+    hw_DebugPrint("***- FF_V_ANG %d FF_V_H %d\n",m_ff_speed_ang,m_ff_speed_h);
+    hw_DebugPrint("***- FF_R_ANG %d FF_R_H %d\n",m_ff_rate_ang,m_ff_rate_h);
+    hw_DebugPrint("***- KP_ANG %d KI_ANG %d\n",m_kp_ang_1000,m_ki_ang_1000);
+    hw_DebugPrint("***- KP_H %d KI_H %d\n",m_kp_h_1000,m_ki_h_1000);
+    for(int i = 0; i < m_gain_schedule.n; ++i){
+        hw_DebugPrint("***- GAIN %d mm/s x%d/1000\n",m_gain_schedule.speed_mm_s[i],(int)(((int64_t)m_gain_schedule.scale[i] * 1000) >> 16));
+    }
+    hw_DebugPrint("***- KF_ON %d KF_R_ROW %d KF_Q_ROW %d KF_Q_HEAD %d\n",m_kf_on,m_kf_r_row,m_kf_q_row,m_kf_q_head);
+    hw_DebugPrint("***- KF_PCT_M %d KF_ANG_DEG %d KF_LAT_MS %d\n",m_kf_pct_m,m_kf_ang_deg,m_kf_lat_ms);
 }
 
 void lemca_init(){
@@ -91,6 +188,24 @@ void lemca_init(){
     m_work_h = getS32("LEMCA", "WORK_H", 50);
     m_vitesse_max_h = getS32("LEMCA", "V_MAX_H", 100);
     m_vitesse_max_ang = getS32("LEMCA", "V_MAX_ANG", 100);
+    m_ff_speed_ang = getS32("LEMCA", "FF_V_ANG", 0);
+    m_ff_speed_h = getS32("LEMCA", "FF_V_H", 0);
+    m_ff_rate_ang = getS32("LEMCA", "FF_R_ANG", 0);
+    m_ff_rate_h = getS32("LEMCA", "FF_R_H", 0);
+    m_kp_ang_1000 = getS32("LEMCA", "KP_ANG", 0);
+    m_ki_ang_1000 = getS32("LEMCA", "KI_ANG", 0);
+    m_kp_h_1000 = getS32("LEMCA", "KP_H", 0);
+    m_ki_h_1000 = getS32("LEMCA", "KI_H", 0);
+    m_tune_relay = getS32("LEMCA", "TUNE_RELAY", 30);
+    m_tune_hyst = getS32("LEMCA", "TUNE_HYST", 10);
+    m_kf_on = getS32("LEMCA", "KF_ON", 1);
+    m_kf_r_row = getS32("LEMCA", "KF_R_ROW", 10);
+    m_kf_q_row = getS32("LEMCA", "KF_Q_ROW", 50);
+    m_kf_q_head = getS32("LEMCA", "KF_Q_HEAD", 10);
+    m_kf_pct_m = getS32("LEMCA", "KF_PCT_M", 0);
+    m_kf_ang_deg = getS32("LEMCA", "KF_ANG_DEG", 0);
+    m_kf_lat_ms = getS32("LEMCA", "KF_LAT_MS", 0);
+    load_gain_schedule();
     verify_config();
 }
 
@@ -103,15 +218,29 @@ void save_config(){
     setS32("LEMCA", "WORK_H", m_work_h);
     setS32("LEMCA", "V_MAX_H", m_vitesse_max_h);
     setS32("LEMCA", "V_MAX_ANG", m_vitesse_max_ang);
+    setS32("LEMCA", "KP_ANG", m_kp_ang_1000);
+    setS32("LEMCA", "KI_ANG", m_ki_ang_1000);
+    setS32("LEMCA", "KP_H", m_kp_h_1000);
+    setS32("LEMCA", "KI_H", m_ki_h_1000);
 }
 
+// the requested state as soon as it is asked, for the VT feedback
 enum State getState(){
+    int request = __atomic_load_n(&m_state_request, __ATOMIC_ACQUIRE);
+    if(request != STATE_REQUEST_NONE){
+        return (enum State)request;
+    }
     return m_state;
 }
 
 
 void setAgressHyd(int agress_hydr){
     m_agress_hydr = agress_hydr;
+    // manual tuning again
+    m_kp_ang_1000 = 0;
+    m_ki_ang_1000 = 0;
+    m_kp_h_1000 = 0;
+    m_ki_h_1000 = 0;
     save_config();
 }
 
@@ -120,11 +249,11 @@ int getAgressHyd(){
 }
 
 int getLastRight(){
-    return m_last_machine_r_100;
+    return Q16_TO_INT(m_last_machine_r_100);
 }
 
 int getLastLeft(){
-    return m_last_machine_l_100;
+    return Q16_TO_INT(m_last_machine_l_100);
 }
 
 void setAlive(){
@@ -142,27 +271,42 @@ int isAlive(){
 
 
 
-void setSpeedKmH(double km_h){
-    m_km_h = km_h;
-}
+// -1 while no speed source is valid
 double getSpeedKmH(){
-    return m_km_h;
+    SpeedData speed;
+    if(!speed_get(&speed, hw_GetTimeUs())){
+        return -1;
+    }
+    return speed.speed_mm_s*0.0036;
+}
+
+int getSpeedKmH10(){
+    SpeedData speed;
+    if(!speed_get(&speed, hw_GetTimeUs())){
+        return -1;
+    }
+    return (speed.speed_mm_s*36 + 500)/1000;
 }
 
 double getCorrAng(){
-    return m_last_corr_angl_100;
+    return m_last_corr_angl_100/(double)Q16_ONE;
 }
 
 
 double getCorrH(){
+    return m_last_corr_h_100/(double)Q16_ONE;
+}
+
+q16_t getCorrAngQ16(){
+    return m_last_corr_angl_100;
+}
+
+q16_t getCorrHQ16(){
     return m_last_corr_h_100;
 }
 
 void setState(enum State state){
-    m_state = state;
-    m_last_millis_up = m_last_millis;
-    sum_error_ang = 0;
-    sum_error_h = 0;
+    __atomic_store_n(&m_state_request, (int)state, __ATOMIC_RELEASE);
 }
 
 void setWorkStateWork(){
@@ -174,7 +318,7 @@ void setWorkStateUp(){
 }
 
 void changeWorkState(){
-    if(m_state == State_work){
+    if(getState() == State_work){
         setState(State_up);
     } else {
         setState(State_work);
@@ -182,39 +326,33 @@ void changeWorkState(){
 }
 
 int getWorkState(){
-    return m_state == State_work;
+    return getState() == State_work;
 }
 
-void setTranslateur(double corr_ang, double corr_h){
+// corrections in percent, Q16
+void setTranslateur(q16_t corr_ang, q16_t corr_h){
+    q16_t max_ang = Q16_FROM_INT(m_vitesse_max_ang);
+    q16_t max_h = Q16_FROM_INT(m_vitesse_max_h);
     m_last_corr_angl_100 = corr_ang;
     m_last_corr_h_100 = corr_h;
-    if(m_last_corr_angl_100 > m_vitesse_max_ang){
-        m_last_corr_angl_100 = m_vitesse_max_ang;
-    }
-    if(m_last_corr_angl_100 < -m_vitesse_max_ang){
-        m_last_corr_angl_100 = -m_vitesse_max_ang;
+    if(m_last_corr_angl_100 > max_ang){
+        m_last_corr_angl_100 = max_ang;
     }
-    if(m_last_corr_h_100 > m_vitesse_max_h){
-        m_last_corr_h_100 = m_vitesse_max_h;
+    if(m_last_corr_angl_100 < -max_ang){
+        m_last_corr_angl_100 = -max_ang;
     }
-    if(m_last_corr_h_100 < -m_vitesse_max_h){
-        m_last_corr_h_100 = -m_vitesse_max_h;
+    if(m_last_corr_h_100 > max_h){
+        m_last_corr_h_100 = max_h;
     }
-    int left = 0;
-    int right = 0;
-    int up = 0;
-    int down = 0;
-    if(m_last_corr_angl_100 > 0){
-        left = m_last_corr_angl_100;
-    } else {
-        right = -m_last_corr_angl_100;
-    }
-    if(m_last_corr_h_100 > 0){
-        up = m_last_corr_h_100;
-    } else {
-        down = -m_last_corr_h_100;
+    if(m_last_corr_h_100 < -max_h){
+        m_last_corr_h_100 = -max_h;
     }
-    setElectrovanne(left*81.91, right*81.91, up*81.91, down*81.91);
+    // dead band, flow curve and dither of each valve, see valve/valve_map.h
+    int left = valve_map_duty(Valve_left, m_last_corr_angl_100);
+    int right = valve_map_duty(Valve_right, -m_last_corr_angl_100);
+    int up = valve_map_duty(Valve_up, m_last_corr_h_100);
+    int down = valve_map_duty(Valve_down, -m_last_corr_h_100);
+    setElectrovanne(left, right, up, down);
 }
 
 void updateUp(){
@@ -222,42 +360,138 @@ void updateUp(){
         hw_DebugPrint("*** update up %i %i\n", m_last_millis_up, m_last_millis);
        // double a = (double)m_last_machine_a_100 - 50.0;
        // double res = a*m_agress_hydr;
-        setTranslateur(0, 100);
+        setTranslateur(0, Q16_FROM_INT(100));
     } else {
         m_state = State_off;
         setElectrovanne(0, 0, 0, 0);
     }
 }
 
+// same tuning as the former double PI: kp = agress/20, ki = 0.2*kp on the
+// integral of the error clamped to +-sum_erreur_max.
+// or the autotune gains when there are some.
+// The output limits leave room for the feedforward, so that the anti-windup
+// sees the real saturation.
+static void updatePidConfig(Pid * pid, q16_t max_out, q16_t ff, int kp_1000, int ki_1000){
+    if(kp_1000 > 0){
+        pid->kp = Q16_FROM_RATIO(kp_1000, 1000);
+        pid->ki = Q16_FROM_RATIO(ki_1000, 1000);
+    } else {
+        pid->kp = Q16_FROM_RATIO(m_agress_hydr, 20);
+        pid->ki = pid->kp/5;
+    }
+    pid->kaw = Q16_FROM_RATIO(1, 5); // 1/Ti
+    pid->i_max = Q16_FROM_INT(sum_erreur_max);
+    pid->out_min = -max_out - ff;
+    pid->out_max = max_out - ff;
+}
+
+// % at 10 km/h -> % per m/s
+static void updateFeedforwardConfig(Feedforward * ff, int speed_10kmh, int rate_100){
+    ff->k_speed = Q16_FROM_RATIO(speed_10kmh * 36, 100);
+    ff->k_rate = Q16_FROM_RATIO(rate_100, 100);
+}
+
+// lateral error of the angle loop and height error, on the estimate
+static q16_t getErrorAng(){
+    return m_est_offset_100;
+}
+
+static q16_t getErrorH(){
+    return Q16_FROM_INT(m_work_h)-m_est_h_100;
+}
+
 void updateWorkstate(){
-    double agress_hyd = m_agress_hydr/20.0;
-    double time = 0.02;
-    
-    
-    double error_ang = (m_last_machine_l_100-m_last_machine_r_100);
+    q16_t scale = pid_schedule_scale(&m_gain_schedule, m_speed.speed_mm_s);
+    int32_t speed_mm_s = m_speed_ok ? m_speed.speed_mm_s : 0;
 
-    sum_error_ang+=error_ang*time;
-    if(sum_error_ang > sum_erreur_max){
-        sum_error_ang = sum_erreur_max;
-    }
-    if(sum_error_ang < -sum_erreur_max){
-        sum_error_ang = -sum_erreur_max;
+    q16_t error_ang = getErrorAng();
+    updateFeedforwardConfig(&m_ff_ang, m_ff_speed_ang, m_ff_rate_ang);
+    q16_t ff_ang = feedforward_step(&m_ff_ang, error_ang, speed_mm_s);
+    updatePidConfig(&m_pid_ang, Q16_FROM_INT(m_vitesse_max_ang), ff_ang, m_kp_ang_1000, m_ki_ang_1000);
+    q16_t corr_ang = pid_step(&m_pid_ang, error_ang, scale) + ff_ang;
+
+    q16_t error_h = getErrorH();
+    updateFeedforwardConfig(&m_ff_h, m_ff_speed_h, m_ff_rate_h);
+    q16_t ff_h = feedforward_step(&m_ff_h, error_h, speed_mm_s);
+    updatePidConfig(&m_pid_h, Q16_FROM_INT(m_vitesse_max_h), ff_h, m_kp_h_1000, m_ki_h_1000);
+    q16_t corr_h = pid_step(&m_pid_h, error_h, scale) + ff_h;
+
+    setTranslateur(corr_ang, corr_h);
+}
+
+static void startAutotuneAxis(int axis, int64_t now_us){
+    m_autotune_axis = axis;
+    autotune_start(&m_autotune, Q16_FROM_INT(m_tune_relay), Q16_FROM_RATIO(m_tune_hyst, 10),
+        AUTOTUNE_CYCLES, AUTOTUNE_TIMEOUT_US, now_us);
+}
+
+// the experiment is started by the control task with the state
+void startAutotune(){
+    hw_DebugPrint("*** startAutotune relay %i %% hyst %i/10 %%\n", m_tune_relay, m_tune_hyst);
+    setAlive();
+    setState(State_autotune);
+}
+
+int getAutotuneAxis(){
+    return m_autotune_axis;
+}
+
+int getAutotuneProgress(){
+    return autotune_progress(&m_autotune);
+}
+
+// control task only, see setState() for the other tasks
+static void applyState(enum State state, int64_t now_us){
+    m_state = state;
+    m_last_millis_up = m_last_millis;
+    pid_reset(&m_pid_ang);
+    pid_reset(&m_pid_h);
+    feedforward_reset(&m_ff_ang);
+    feedforward_reset(&m_ff_h);
+    if(state == State_autotune){
+        startAutotuneAxis(0, now_us);
     }
-   
-    double corr_ang = agress_hyd*error_ang + agress_hyd*0.2*sum_error_ang;
+}
 
+// the other axis is held still during the experiment
+void updateAutotune(int64_t now_us){
+    q16_t out = 0;
+    q16_t error;
+    if(m_autotune_axis == 0){
+        error = getErrorAng();
+    } else {
+        error = getErrorH();
+    }
+    enum AutotuneStatus status = autotune_step(&m_autotune, error, now_us, &out);
+    if(m_autotune_axis == 0){
+        setTranslateur(out, 0);
+    } else {
+        setTranslateur(0, out);
+    }
+    if(status == Autotune_running){
+        return;
+    }
 
-    double error_h = (m_work_h-(m_last_machine_l_100+m_last_machine_r_100)*0.5);
-    sum_error_h+=error_h*time;
-    if(sum_error_h > sum_erreur_max){
-        sum_error_h = sum_erreur_max;
+    q16_t ku, kp, ki;
+    int32_t tu_us;
+    if(status == Autotune_failed || !autotune_result(&m_autotune, &ku, &tu_us, &kp, &ki)){
+        hw_DebugPrint("*** autotune axis %i failed\n", m_autotune_axis);
+        applyState(State_off, now_us);
+        return;
     }
-    if(sum_error_h < -sum_erreur_max){
-        sum_error_h = -sum_erreur_max;
+    hw_DebugPrint("*** autotune axis %i Ku %i/1000 Tu %i ms kp %i/1000 ki %i/1000\n", m_autotune_axis,
+        (int)(((int64_t)ku * 1000) >> 16), tu_us/1000, (int)(((int64_t)kp * 1000) >> 16), (int)(((int64_t)ki * 1000) >> 16));
+    if(m_autotune_axis == 0){
+        m_kp_ang_1000 = ((int64_t)kp * 1000) >> 16;
+        m_ki_ang_1000 = ((int64_t)ki * 1000) >> 16;
+        startAutotuneAxis(1, now_us);
+    } else {
+        m_kp_h_1000 = ((int64_t)kp * 1000) >> 16;
+        m_ki_h_1000 = ((int64_t)ki * 1000) >> 16;
+        m_autotune_save = 1;
+        applyState(State_off, now_us);
     }
-    double corr_h =  agress_hyd*error_h+ agress_hyd*0.2*sum_error_h;
-    
-    setTranslateur(corr_ang, corr_h);
 }
 
 void updateTime(){
@@ -265,16 +499,16 @@ void updateTime(){
         //hw_DebugPrint("*** update time %i %i\n", m_last_millis, m_last_millis_time);
         if(m_time_action == TimeAction_Left){
             //left
-            setTranslateur(-100, 0);
+            setTranslateur(-Q16_FROM_INT(100), 0);
         } else if(m_time_action == TimeAction_Right){
-            setTranslateur(100, 0);
+            setTranslateur(Q16_FROM_INT(100), 0);
             //right
         } else if(m_time_action == TimeAction_Up){
             //up
-            setTranslateur(0, 100);
+            setTranslateur(0, Q16_FROM_INT(100));
         } else if(m_time_action == TimeAction_Down){
             //down
-            setTranslateur(0, -100);
+            setTranslateur(0, -Q16_FROM_INT(100));
         } else {
             setTranslateur(0, 0);
         }
@@ -286,14 +520,66 @@ void updateTime(){
     }
 }
 
+static void kalmanConfig(){
+    float r = m_kf_r_row/10.0f;
+    float q_head = m_kf_q_head/10.0f;
+    m_kf.r_row = r*r;
+    m_kf.r_angle = 1.0f;
+    m_kf.q[Kalman_offset] = (float)m_kf_q_row*m_kf_q_row;
+    m_kf.q[Kalman_height] = (float)m_kf_q_row*m_kf_q_row;
+    m_kf.q[Kalman_heading] = q_head*q_head;
+    m_kf.q[Kalman_bias] = KF_Q_BIAS;
+    m_kf.pct_per_m = m_kf_pct_m;
+}
+
+// runs the filter at the time of the ADC samples, the estimate is brought
+// to now_us through the model (latency compensation)
+static void updateFusion(int64_t now_us, int64_t adc_us){
+    if(!m_kf_on || adc_us == 0){
+        m_est_offset_100 = m_last_machine_l_100-m_last_machine_r_100;
+        m_est_h_100 = (m_last_machine_l_100+m_last_machine_r_100)/2;
+        return;
+    }
+    int yaw_ok = m_imu_ok && (now_us - m_last_imu.timestamp_us) < KF_IMU_TIMEOUT_US;
+    float yaw_rate = m_last_imu.yaw_rate_cdeg_s/100.0f;
+    float speed = m_speed_ok ? m_speed.speed_mm_s/1000.0f : 0;
+    float left = m_last_machine_l_100/(float)Q16_ONE;
+    float right = m_last_machine_r_100/(float)Q16_ONE;
+
+    int64_t meas_us = adc_us - (int64_t)m_kf_lat_ms*1000;
+    int64_t dt_us = meas_us - m_kf_last_us;
+    if(!m_kf.started || dt_us > 500000 || dt_us < 0){
+        kalmanConfig();
+        kalman_reset(&m_kf);
+        kalman_update_rows(&m_kf, left, right);
+        m_kf_last_us = meas_us;
+    } else if(dt_us > 0){
+        kalman_predict(&m_kf, dt_us/1e6f, speed, yaw_rate, yaw_ok);
+        kalman_update_rows(&m_kf, left, right);
+        if(m_kf_ang_deg != 0){
+            float heading = (m_last_machine_a_100/(float)Q16_ONE - 50.0f)*m_kf_ang_deg/50.0f;
+            kalman_update_angle(&m_kf, heading);
+        }
+        m_kf_last_us = meas_us;
+    }
+
+    KalmanEstimate est;
+    kalman_estimate(&m_kf, (now_us - meas_us)/1e6f, speed, yaw_rate, yaw_ok, &est);
+    m_est_offset_100 = (q16_t)(est.offset*Q16_ONE);
+    m_est_h_100 = (q16_t)(est.height*Q16_ONE);
+}
+
 void update50Hz(int millis){
     //int capteur_angle = 0;
     //int capteur_h = 0;
-    readAll2(&m_last_machine_a, &m_last_machine_h, &m_last_machine_l, &m_last_machine_r);
-    m_last_machine_a_100 = (double)m_last_machine_a*100.0/max_value;
-    m_last_machine_h_100 = (double)m_last_machine_h*100.0/max_value;
-    m_last_machine_l_100 = 100.0-(double)m_last_machine_l*100.0/max_value;
-    m_last_machine_r_100 = (double)m_last_machine_r*100.0/max_value;
+    int64_t adc_us = readAll2(&m_last_machine_a, &m_last_machine_h, &m_last_machine_l, &m_last_machine_r);
+    m_last_machine_a_100 = adc_calib_percent(AdcSensor_angle, m_last_machine_a);
+    m_last_machine_h_100 = adc_calib_percent(AdcSensor_h, m_last_machine_h);
+    m_last_machine_l_100 = adc_calib_percent(AdcSensor_machine_l, m_last_machine_l);
+    m_last_machine_r_100 = adc_calib_percent(AdcSensor_machine_r, m_last_machine_r);
+    m_imu_ok = imu_get_latest(&m_last_imu);
+    m_speed_ok = speed_get(&m_speed, (int64_t)millis*1000);
+    updateFusion((int64_t)millis*1000, adc_us);
 
     if(!isAlive()){
         return;
@@ -305,58 +591,118 @@ void update50Hz(int millis){
         updateWorkstate();
     } else if(m_state == State_up){
         updateUp();
+    } else if(m_state == State_autotune){
+        updateAutotune((int64_t)millis*1000);
     } else {
         setElectrovanne(0, 0, 0, 0);
     }
 }
 
-int old_millis_50HZ = 0;
-int old_millis_5HZ = 0;
-void lemca_loop(){
-    int millis = esp_timer_get_time()/1000;
-    m_last_millis = millis;
-    int i_50HZ = millis/20;
-    if(i_50HZ != old_millis_50HZ){
-        update50Hz(m_last_millis);
-        old_millis_50HZ = i_50HZ;
+void lemca_control_init(){
+    pid_init(&m_pid_ang, CONTROL_PERIOD_US);
+    pid_init(&m_pid_h, CONTROL_PERIOD_US);
+    feedforward_init(&m_ff_ang, CONTROL_PERIOD_US);
+    feedforward_init(&m_ff_h, CONTROL_PERIOD_US);
+    kalman_init(&m_kf);
+    valve_map_init(CONTROL_PERIOD_US);
+}
+
+// called by the control task (core 1) every CONTROL_PERIOD_US
+void lemca_control_step(int64_t now_us){
+    m_last_millis = now_us/1000;
+    int request = __atomic_exchange_n(&m_state_request, STATE_REQUEST_NONE, __ATOMIC_ACQUIRE);
+    if(request != STATE_REQUEST_NONE){
+        applyState((enum State)request, now_us);
     }
+    update50Hz(m_last_millis);
+}
+
+int old_millis_10HZ = 0;
+int old_millis_stats = 0;
+void lemca_loop(){
+    int64_t now_us = hw_GetTimeUs();
+    int millis = now_us/1000;
+
+    speed_update(now_us);
 
-    int i_5HZ = millis/500;
-    if(i_5HZ != old_millis_5HZ){
+    // only the changed values are sent, see vt_shadow.h
+    int i_10HZ = millis/100;
+    if(i_10HZ != old_millis_10HZ){
         //hw_DebugPrint("*** update time %i\n", m_last_millis);
         updateVTC();
-        old_millis_5HZ = i_5HZ;
+        pgn_dispatch_check_timeouts(now_us);
+        old_millis_10HZ = i_10HZ;
+    }
+    // every loop: feedback goes out at the next tick
+    vt_queue_flush(millis);
+
+    if(m_autotune_save){
+        // flash write out of the control task
+        m_autotune_save = 0;
+        save_config();
+    }
+
+    int i_stats = millis/10000;
+    if(i_stats != old_millis_stats){
+        control_task_print_stats();
+        control_task_reset_max();
+        uart_print_stats();
+        hw_CanPrintRxStats();
+        SpeedData speed;
+        speed_get(&speed, now_us);
+        hw_DebugPrint("*** speed %s %i mm/s age %u us distance %u mm\n",
+            speed_source_name(speed.source), speed.speed_mm_s, speed.age_us, speed.distance_mm);
+        PgnDispatchStats pgn;
+        pgn_dispatch_get_stats(&pgn);
+        hw_DebugPrint("*** pgn frames %u dlc errors %u timeouts %u, hitch %s speed %s\n",
+            pgn.frames, pgn.dlc_errors, pgn.timeouts, pgn_dispatch_is_fresh(PGN_REAR_HITCH, now_us) ? "ok" : "lost",
+            (pgn_dispatch_is_fresh(PGN_WHEEL_BASED_SPEED, now_us) || pgn_dispatch_is_fresh(PGN_GROUND_BASED_SPEED, now_us)) ? "ok" : "lost");
+        AdcSamplerStats adc;
+        adc_sampler_get_stats(&adc);
+        hw_DebugPrint("*** adc samples %u blocks %u overflows %u invalid %u filter %u cycles\n",
+            adc.samples, adc.blocks, adc.overflows, adc.invalid, adc.filter_cycles);
+        ValveOutputStats valve;
+        valve_output_get_stats(&valve);
+        hw_DebugPrint("*** valve writes %u channels %u cycles %u max %u\n",
+            valve.writes, valve.channel_updates, valve.last_cycles, valve.max_cycles);
+        valve_output_reset_max();
+        VtQueueStats vt;
+        vt_queue_get_stats(&vt);
+        hw_DebugPrint("*** vt queue sent %u frames %u coalesced %u waits %u overflows %u max wait %u/%u/%u ms\n",
+            vt.sent, vt.frames, vt.coalesced, vt.budget_waits, vt.overflows,
+            vt.max_wait_ms[VtPriority_feedback], vt.max_wait_ms[VtPriority_cyclic], vt.max_wait_ms[VtPriority_cosmetic]);
+        vt_queue_reset_max();
+        old_millis_stats = i_stats;
     }
-    
 }
 
 
 void onButtonUp(){
-    m_state = State_time;
     m_time_action = TimeAction_Up;
     setAlive();
     m_last_millis_time = m_last_millis;
+    setState(State_time);
     hw_DebugPrint("*** onButtonUp\n");
 };
 void onButtonDown(){
-    m_state = State_time;
     m_time_action = TimeAction_Down;
     setAlive();
     m_last_millis_time = m_last_millis;
+    setState(State_time);
     hw_DebugPrint("*** onButtonDown\n");
 };
 void onButtonUpLeft(){
-    m_state = State_time;
     m_time_action = TimeAction_Left;
     setAlive();
     m_last_millis_time = m_last_millis;
+    setState(State_time);
     hw_DebugPrint("*** onButtonLeft\n");
 };
 void onButtonUpRight(){
-    m_state = State_time;
     m_time_action = TimeAction_Right;
     setAlive();
     m_last_millis_time = m_last_millis;
+    setState(State_time);
     hw_DebugPrint("*** onButtonRight\n");
 };
 
@@ -1,6 +1,10 @@
 #ifndef LEMCA_H_
 #define LEMCA_H_
 
+#include <stdint.h>
+
+#include "common/q16.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -9,7 +13,8 @@ enum State{
     State_off = 0,
     State_time = 1,
     State_up = 2,
-    State_work = 3
+    State_work = 3,
+    State_autotune = 4
 };
 
 extern void lemca_init();
@@ -19,18 +24,31 @@ enum State getState();
 void setAgressHyd(int agress_hydr);
 int getAgressHyd();
 
+// relay experiment on the angle then on the height, the P/I gains found
+// replace AGRESS_HYD until it is entered again
+void startAutotune();
+// 0 angle, 1 height
+int getAutotuneAxis();
+// 0..100 on the current axis
+int getAutotuneProgress();
+
 
 extern void setWorkStateWork();
 extern void setWorkStateUp();
 extern void changeWorkState();
 extern int getWorkState();
-extern void setSpeedKmH(double kmh);
 extern double getSpeedKmH();
+// 0.1 km/h, -1 without speed
+extern int getSpeedKmH10();
 
 extern double getCorrAng();
 extern double getCorrH();
+extern q16_t getCorrAngQ16();
+extern q16_t getCorrHQ16();
 
 extern void lemca_loop();
+extern void lemca_control_init();
+extern void lemca_control_step(int64_t now_us);
 
 extern void onButtonUp();
 extern void onButtonDown();
@@ -0,0 +1,365 @@
+#include "nmea.h"
+
+#include <string.h>
+
+#include "../common/seqlock.h"
+
+// NMEA 0183 sentences are at most 82 chars, '$' and "\r\n" included
+#define NMEA_MAX_LENGTH 82
+#define NMEA_MAX_DIGITS 18
+
+typedef enum {
+    NmeaState_Idle = 0,
+    NmeaState_Body,
+    NmeaState_Checksum1,
+    NmeaState_Checksum2
+} NmeaState;
+
+typedef enum {
+    NmeaType_Unknown = 0,
+    NmeaType_GGA,
+    NmeaType_RMC,
+    NmeaType_VTG,
+    NmeaType_HDT
+} NmeaType;
+
+// fields found in the current sentence
+#define NMEA_HAS_TIME    0x0001
+#define NMEA_HAS_LAT     0x0002
+#define NMEA_HAS_LON     0x0004
+#define NMEA_HAS_QUALITY 0x0008
+#define NMEA_HAS_SATS    0x0010
+#define NMEA_HAS_HDOP    0x0020
+#define NMEA_HAS_ALT     0x0040
+#define NMEA_HAS_SPEED   0x0080
+#define NMEA_HAS_COURSE  0x0100
+#define NMEA_HAS_HEADING 0x0200
+#define NMEA_INVALID     0x8000 // RMC status V, VTG mode N
+
+typedef struct {
+    NmeaState state;
+    NmeaType type;
+    uint8_t length;
+    uint8_t checksum;
+    uint8_t received_checksum;
+    uint8_t field;
+    char address[6];
+    uint8_t address_len;
+
+    // current field, decoded on the fly: no line buffer
+    int64_t num;
+    uint8_t digits;
+    uint8_t decimals;
+    uint8_t in_decimals;
+    uint8_t negative;
+    char letter;
+
+    // current sentence
+    int64_t start_us;
+    uint16_t has;
+    uint32_t utc_ms;
+    int32_t lat_e7;
+    int32_t lon_e7;
+    int32_t alt_mm;
+    int32_t speed_mm_s;
+    int32_t course_cdeg;
+    int32_t heading_cdeg;
+    uint16_t hdop_x100;
+    uint8_t fix_quality;
+    uint8_t num_sats;
+} NmeaParser;
+
+static NmeaParser s_parser;
+static NmeaData s_data;         // owned by the parser
+static NmeaData s_published;    // read through the seqlock
+static SeqLock s_lock;
+static NmeaStats s_stats;
+
+static const int64_t s_pow10[] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL, 1000000000LL
+};
+
+// value of the current field with "decimals" digits after the point,
+// extra digits truncated toward zero
+static int64_t nmea_fixed(const NmeaParser * p, uint8_t decimals){
+    int64_t v;
+    if(p->decimals == decimals){
+        v = p->num;
+    } else if(p->decimals < decimals){
+        v = p->num * s_pow10[decimals - p->decimals];
+    } else {
+        uint8_t shift = p->decimals - decimals;
+        if(shift > 9){
+            return 0;
+        }
+        v = p->num / s_pow10[shift];
+    }
+    return p->negative ? -v : v;
+}
+
+// ddmm.mmmmm -> degrees * 1e7
+static int32_t nmea_angle_e7(const NmeaParser * p){
+    int64_t v = nmea_fixed(p, 5);
+    int64_t deg = v / 10000000LL;
+    int64_t min_e5 = v - deg * 10000000LL;
+    return (int32_t)(deg * 10000000LL + (min_e5 * 100) / 60);
+}
+
+// hhmmss.sss -> ms of the day
+static uint32_t nmea_time_ms(const NmeaParser * p){
+    int64_t v = nmea_fixed(p, 3);
+    int64_t hh = v / 10000000LL;
+    int64_t mm = (v / 100000LL) % 100;
+    int64_t ss_ms = v % 100000LL;
+    return (uint32_t)(hh * 3600000LL + mm * 60000LL + ss_ms);
+}
+
+static void nmea_identify(NmeaParser * p){
+    p->type = NmeaType_Unknown;
+    if(p->address_len < 5){
+        return;
+    }
+    const char * s = p->address + p->address_len - 3;
+    if(memcmp(s, "GGA", 3) == 0){
+        p->type = NmeaType_GGA;
+    } else if(memcmp(s, "RMC", 3) == 0){
+        p->type = NmeaType_RMC;
+    } else if(memcmp(s, "VTG", 3) == 0){
+        p->type = NmeaType_VTG;
+    } else if(memcmp(s, "HDT", 3) == 0){
+        p->type = NmeaType_HDT;
+    }
+}
+
+static void nmea_field_gga(NmeaParser * p){
+    switch(p->field){
+        case 1: p->utc_ms = nmea_time_ms(p); p->has |= NMEA_HAS_TIME; break;
+        case 2: p->lat_e7 = nmea_angle_e7(p); p->has |= NMEA_HAS_LAT; break;
+        case 3: if(p->letter == 'S'){ p->lat_e7 = -p->lat_e7; } break;
+        case 4: p->lon_e7 = nmea_angle_e7(p); p->has |= NMEA_HAS_LON; break;
+        case 5: if(p->letter == 'W'){ p->lon_e7 = -p->lon_e7; } break;
+        case 6: p->fix_quality = (uint8_t)p->num; p->has |= NMEA_HAS_QUALITY; break;
+        case 7: p->num_sats = (uint8_t)p->num; p->has |= NMEA_HAS_SATS; break;
+        case 8: p->hdop_x100 = (uint16_t)nmea_fixed(p, 2); p->has |= NMEA_HAS_HDOP; break;
+        case 9: p->alt_mm = (int32_t)nmea_fixed(p, 3); p->has |= NMEA_HAS_ALT; break;
+        default: break;
+    }
+}
+
+static void nmea_field_rmc(NmeaParser * p){
+    switch(p->field){
+        case 1: p->utc_ms = nmea_time_ms(p); p->has |= NMEA_HAS_TIME; break;
+        case 2: if(p->letter != 'A'){ p->has |= NMEA_INVALID; } break;
+        case 3: p->lat_e7 = nmea_angle_e7(p); p->has |= NMEA_HAS_LAT; break;
+        case 4: if(p->letter == 'S'){ p->lat_e7 = -p->lat_e7; } break;
+        case 5: p->lon_e7 = nmea_angle_e7(p); p->has |= NMEA_HAS_LON; break;
+        case 6: if(p->letter == 'W'){ p->lon_e7 = -p->lon_e7; } break;
+        // knots -> mm/s
+        case 7: p->speed_mm_s = (int32_t)(nmea_fixed(p, 3) * 514444 / 1000000); p->has |= NMEA_HAS_SPEED; break;
+        case 8: p->course_cdeg = (int32_t)nmea_fixed(p, 2); p->has |= NMEA_HAS_COURSE; break;
+        default: break;
+    }
+}
+
+static void nmea_field_vtg(NmeaParser * p){
+    switch(p->field){
+        case 1: p->course_cdeg = (int32_t)nmea_fixed(p, 2); p->has |= NMEA_HAS_COURSE; break;
+        // km/h -> mm/s
+        case 7: p->speed_mm_s = (int32_t)(nmea_fixed(p, 3) * 10 / 36); p->has |= NMEA_HAS_SPEED; break;
+        case 9: if(p->letter == 'N'){ p->has |= NMEA_INVALID; } break;
+        default: break;
+    }
+}
+
+static void nmea_field_hdt(NmeaParser * p){
+    if(p->field == 1){
+        p->heading_cdeg = (int32_t)nmea_fixed(p, 2);
+        p->has |= NMEA_HAS_HEADING;
+    }
+}
+
+static void nmea_field_end(NmeaParser * p){
+    int empty = (p->digits == 0) && (p->letter == 0);
+    if(p->field == 0){
+        nmea_identify(p);
+    } else if(!empty){
+        switch(p->type){
+            case NmeaType_GGA: nmea_field_gga(p); break;
+            case NmeaType_RMC: nmea_field_rmc(p); break;
+            case NmeaType_VTG: nmea_field_vtg(p); break;
+            case NmeaType_HDT: nmea_field_hdt(p); break;
+            default: break;
+        }
+    }
+    p->field++;
+    p->num = 0;
+    p->digits = 0;
+    p->decimals = 0;
+    p->in_decimals = 0;
+    p->negative = 0;
+    p->letter = 0;
+}
+
+static void nmea_commit(NmeaParser * p){
+    NmeaData * d = &s_data;
+    uint16_t has = p->has;
+    if(p->type == NmeaType_Unknown){
+        s_stats.ignored++;
+        return;
+    }
+    s_stats.sentences++;
+
+    if(p->type == NmeaType_GGA){
+        if(has & NMEA_HAS_QUALITY){
+            d->fix_quality = p->fix_quality;
+        }
+        if(has & NMEA_HAS_SATS){
+            d->num_sats = p->num_sats;
+        }
+        if(has & NMEA_HAS_HDOP){
+            d->hdop_x100 = p->hdop_x100;
+        }
+        if(p->fix_quality == 0){
+            has &= ~(NMEA_HAS_LAT | NMEA_HAS_LON | NMEA_HAS_ALT);
+        }
+        if(has & NMEA_HAS_ALT){
+            d->alt_mm = p->alt_mm;
+        }
+    }
+    if(has & NMEA_INVALID){
+        has &= ~(NMEA_HAS_LAT | NMEA_HAS_LON | NMEA_HAS_SPEED | NMEA_HAS_COURSE);
+    }
+    if((has & NMEA_HAS_LAT) && (has & NMEA_HAS_LON)){
+        d->lat_e7 = p->lat_e7;
+        d->lon_e7 = p->lon_e7;
+        if(has & NMEA_HAS_TIME){
+            d->utc_ms = p->utc_ms;
+        }
+        d->pos_us = p->start_us;
+    }
+    if(has & NMEA_HAS_SPEED){
+        d->speed_mm_s = p->speed_mm_s;
+        if(has & NMEA_HAS_COURSE){
+            d->course_cdeg = p->course_cdeg;
+        }
+        d->vel_us = p->start_us;
+    }
+    if(has & NMEA_HAS_HEADING){
+        d->heading_cdeg = p->heading_cdeg;
+        d->heading_us = p->start_us;
+    }
+
+    seqlock_write(&s_lock, &s_published, d, sizeof(NmeaData));
+}
+
+static int nmea_hex(char c){
+    if(c >= '0' && c <= '9'){
+        return c - '0';
+    } else if(c >= 'A' && c <= 'F'){
+        return c - 'A' + 10;
+    } else if(c >= 'a' && c <= 'f'){
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+static void nmea_start(NmeaParser * p, int64_t now_us){
+    p->state = NmeaState_Body;
+    p->type = NmeaType_Unknown;
+    p->length = 1;
+    p->checksum = 0;
+    p->field = 0;
+    p->address_len = 0;
+    p->num = 0;
+    p->digits = 0;
+    p->decimals = 0;
+    p->in_decimals = 0;
+    p->negative = 0;
+    p->letter = 0;
+    p->has = 0;
+    p->fix_quality = 0;
+    p->start_us = now_us;
+}
+
+static void nmea_read_char(NmeaParser * p, char c, int64_t now_us){
+    if(c == '$'){
+        if(p->state != NmeaState_Idle){
+            s_stats.framing_errors++;
+        }
+        nmea_start(p, now_us);
+        return;
+    }
+
+    switch(p->state){
+        case NmeaState_Idle:
+            break;
+        case NmeaState_Body:
+            if(++p->length > NMEA_MAX_LENGTH || c == '\r' || c == '\n'){
+                s_stats.framing_errors++;
+                p->state = NmeaState_Idle;
+            } else if(c == '*'){
+                nmea_field_end(p);
+                p->state = NmeaState_Checksum1;
+            } else {
+                p->checksum ^= (uint8_t)c;
+                if(c == ','){
+                    nmea_field_end(p);
+                } else if(p->field == 0){
+                    if(p->address_len < sizeof(p->address)){
+                        p->address[p->address_len++] = c;
+                    }
+                } else if(c >= '0' && c <= '9'){
+                    if(p->digits < NMEA_MAX_DIGITS){
+                        p->num = p->num * 10 + (c - '0');
+                        p->digits++;
+                        p->decimals += p->in_decimals;
+                    }
+                } else if(c == '.'){
+                    p->in_decimals = 1;
+                } else if(c == '-' && p->digits == 0){
+                    // altitude and geoid separation below the sea level
+                    p->negative = 1;
+                } else {
+                    p->letter = c;
+                }
+            }
+            break;
+        case NmeaState_Checksum1: {
+            int h = nmea_hex(c);
+            if(h < 0){
+                s_stats.framing_errors++;
+                p->state = NmeaState_Idle;
+            } else {
+                p->received_checksum = (uint8_t)(h << 4);
+                p->state = NmeaState_Checksum2;
+            }
+            break;
+        }
+        case NmeaState_Checksum2: {
+            int h = nmea_hex(c);
+            p->state = NmeaState_Idle;
+            if(h < 0){
+                s_stats.framing_errors++;
+            } else if((p->received_checksum | h) != p->checksum){
+                s_stats.checksum_errors++;
+            } else {
+                nmea_commit(p);
+            }
+            break;
+        }
+    }
+}
+
+void nmea_parse(const char * data, uint32_t len, int64_t now_us){
+    for(uint32_t i = 0; i < len; ++i){
+        nmea_read_char(&s_parser, data[i], now_us);
+    }
+}
+
+void nmea_get_data(NmeaData * data){
+    seqlock_read(&s_lock, data, &s_published, sizeof(NmeaData));
+}
+
+void nmea_get_stats(NmeaStats * stats){
+    *stats = s_stats;
+}
@@ -0,0 +1,46 @@
+#ifndef LEMCA_NMEA_H_
+#define LEMCA_NMEA_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// last position / velocity decoded from GGA, RMC, VTG and HDT.
+// *_us are esp_timer_get_time() stamps of the sentence, 0 = never received.
+typedef struct {
+    int64_t pos_us;
+    int64_t vel_us;
+    int64_t heading_us;
+    int32_t lat_e7;        // degrees * 1e7, north positive
+    int32_t lon_e7;        // degrees * 1e7, east positive
+    int32_t alt_mm;        // altitude above mean sea level
+    uint32_t utc_ms;       // time of day of the last position
+    int32_t speed_mm_s;    // speed over ground
+    int32_t course_cdeg;   // course over ground, 0.01 deg
+    int32_t heading_cdeg;  // true heading, 0.01 deg
+    uint16_t hdop_x100;
+    uint8_t fix_quality;   // GGA quality, 0 = no fix
+    uint8_t num_sats;
+} NmeaData;
+
+typedef struct {
+    uint32_t sentences;        // valid sentences decoded
+    uint32_t ignored;          // valid checksum, unsupported sentence
+    uint32_t checksum_errors;
+    uint32_t framing_errors;   // too long or no checksum
+} NmeaStats;
+
+// incremental parser, data can be any slice of the stream (e.g. a ring span)
+void nmea_parse(const char * data, uint32_t len, int64_t now_us);
+
+// lock-free snapshot of the last decoded data, callable from any core
+void nmea_get_data(NmeaData * data);
+void nmea_get_stats(NmeaStats * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,138 @@
+#include "pgn_dispatch.h"
+
+#define PGN_DISPATCH_MASK (PGN_DISPATCH_SIZE - 1)
+#define PGN_EMPTY 0xFFFFFFFFu
+
+typedef struct {
+    uint32_t pgn;           // PGN_EMPTY = free slot
+    PgnHandler handler;
+    int64_t last_rx_us;     // 0 = never received
+    int64_t timeout_us;
+    uint8_t dlc;
+    uint8_t fresh;
+} PgnEntry;
+
+// open addressing with linear probing, filled before the first frame
+static PgnEntry s_table[PGN_DISPATCH_SIZE];
+static uint32_t s_count = 0;
+static int s_table_init = 0;
+
+static PgnDispatchStats s_stats;
+
+static uint32_t pgn_hash(uint32_t pgn){
+    // Fibonacci hashing on the 18 bits PGN
+    return (pgn * 2654435761u) >> (32 - PGN_DISPATCH_BITS);
+}
+
+static PgnEntry * pgn_find(uint32_t pgn){
+    if(!s_table_init){
+        // zeroed table: no PGN_EMPTY slot to end the probing on
+        return 0;
+    }
+    uint32_t i = pgn_hash(pgn) & PGN_DISPATCH_MASK;
+    for(;;){
+        PgnEntry * e = &s_table[i];
+        if(e->pgn == pgn){
+            return e;
+        }
+        if(e->pgn == PGN_EMPTY){
+            return 0;
+        }
+        i = (i + 1) & PGN_DISPATCH_MASK;
+    }
+}
+
+static void pgn_table_init(void){
+    for(int i = 0; i < PGN_DISPATCH_SIZE; ++i){
+        s_table[i].pgn = PGN_EMPTY;
+    }
+    s_table_init = 1;
+}
+
+int pgn_dispatch_register(uint32_t pgn, PgnHandler handler, uint8_t dlc, uint32_t timeout_ms){
+    if(!s_table_init){
+        pgn_table_init();
+    }
+    PgnEntry * e = pgn_find(pgn);
+    if(e == 0){
+        // keep free slots so that a lookup always ends on one
+        if(s_count >= PGN_DISPATCH_SIZE / 2){
+            return 0;
+        }
+        uint32_t i = pgn_hash(pgn) & PGN_DISPATCH_MASK;
+        while(s_table[i].pgn != PGN_EMPTY){
+            i = (i + 1) & PGN_DISPATCH_MASK;
+        }
+        e = &s_table[i];
+        s_count++;
+    }
+    e->handler = handler;
+    e->dlc = dlc;
+    e->timeout_us = (int64_t)timeout_ms * 1000;
+    e->last_rx_us = 0;
+    e->fresh = 0;
+    e->pgn = pgn;
+    return 1;
+}
+
+int pgn_dispatch_frame(uint32_t can_id, const uint8_t * data, uint8_t dlc, int64_t rx_us){
+    if(s_count == 0){
+        return 0;
+    }
+    uint32_t pgn = (can_id >> 8) & 0x3FFFF;
+    if(((pgn >> 8) & 0xFF) < 0xF0){
+        // PDU1: remove the destination address
+        pgn &= 0x3FF00;
+    }
+    PgnEntry * e = pgn_find(pgn);
+    if(e == 0){
+        return 0;
+    }
+    if(dlc < e->dlc){
+        s_stats.dlc_errors++;
+        return 0;
+    }
+    e->last_rx_us = rx_us;
+    e->fresh = 1;
+    s_stats.frames++;
+    e->handler(pgn, (uint8_t)can_id, data, dlc, rx_us);
+    return 1;
+}
+
+int pgn_dispatch_is_fresh(uint32_t pgn, int64_t now_us){
+    const PgnEntry * e = pgn_find(pgn);
+    if(e == 0 || e->last_rx_us == 0){
+        return 0;
+    }
+    return now_us - e->last_rx_us <= e->timeout_us;
+}
+
+void pgn_dispatch_check_timeouts(int64_t now_us){
+    if(s_count == 0){
+        return;
+    }
+    for(int i = 0; i < PGN_DISPATCH_SIZE; ++i){
+        PgnEntry * e = &s_table[i];
+        if(e->pgn != PGN_EMPTY && e->fresh && now_us - e->last_rx_us > e->timeout_us){
+            e->fresh = 0;
+            s_stats.timeouts++;
+        }
+    }
+}
+
+uint8_t pgn_dispatch_get_pgns(uint32_t * pgns, uint8_t max){
+    uint8_t n = 0;
+    if(s_count == 0){
+        return 0;
+    }
+    for(int i = 0; i < PGN_DISPATCH_SIZE && n < max; ++i){
+        if(s_table[i].pgn != PGN_EMPTY){
+            pgns[n++] = s_table[i].pgn;
+        }
+    }
+    return n;
+}
+
+void pgn_dispatch_get_stats(PgnDispatchStats * stats){
+    *stats = s_stats;
+}
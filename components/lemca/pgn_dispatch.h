@@ -0,0 +1,42 @@
+#ifndef LEMCA_PGN_DISPATCH_H_
+#define LEMCA_PGN_DISPATCH_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PGN_DISPATCH_BITS 5
+#define PGN_DISPATCH_SIZE (1 << PGN_DISPATCH_BITS) // hash slots, at most half used
+
+// pgn without destination address, sa = source address, rx_us = esp_timer_get_time() of the RX task
+typedef void (*PgnHandler)(uint32_t pgn, uint8_t sa, const uint8_t * data, uint8_t dlc, int64_t rx_us);
+
+typedef struct {
+    uint32_t frames;        // frames given to a handler
+    uint32_t dlc_errors;    // frames shorter than the registered DLC, dropped
+    uint32_t timeouts;      // registered PGNs that stopped being received
+} PgnDispatchStats;
+
+// to call from the ISOBUS loop before the first frame, returns 0 when the table is full
+int pgn_dispatch_register(uint32_t pgn, PgnHandler handler, uint8_t dlc, uint32_t timeout_ms);
+
+// hot path: one hash lookup, returns 1 when a handler was called
+int pgn_dispatch_frame(uint32_t can_id, const uint8_t * data, uint8_t dlc, int64_t rx_us);
+
+// 1 while the PGN was received within its timeout, 0 when not registered
+int pgn_dispatch_is_fresh(uint32_t pgn, int64_t now_us);
+// counts the PGNs going from fresh to timed out, called by lemca_loop at 10 Hz
+void pgn_dispatch_check_timeouts(int64_t now_us);
+
+// copies the registered PGNs (e.g. for the CAN acceptance filter), returns their number
+uint8_t pgn_dispatch_get_pgns(uint32_t * pgns, uint8_t max);
+
+void pgn_dispatch_get_stats(PgnDispatchStats * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,107 @@
+#include "speed.h"
+
+#include "../common/seqlock.h"
+#include "../nmea/nmea.h"
+
+#define SPEED_RAW_MAX 0xFAFF
+
+typedef struct {
+    int64_t rx_us;          // 0 = never received
+    int32_t speed_mm_s;
+    uint8_t reverse;
+} SpeedInput;
+
+// owned by the ISOBUS loop
+static SpeedInput s_inputs[SpeedSource_count];
+static SpeedData s_data;
+static int64_t s_last_update_us = 0;
+static int64_t s_distance_nm = 0;
+
+static SpeedData s_published;   // read through the seqlock
+static SeqLock s_lock;
+
+static int64_t speed_timeout_us(uint8_t source){
+    return (source == SpeedSource_gnss) ? SPEED_TIMEOUT_GNSS_US : SPEED_TIMEOUT_CAN_US;
+}
+
+static int speed_is_fresh(uint8_t source, int64_t rx_us, int64_t now_us){
+    return rx_us != 0 && now_us - rx_us <= speed_timeout_us(source);
+}
+
+void speed_set_can(SpeedSource source, uint16_t raw, uint8_t reverse, int64_t rx_us){
+    if(raw > SPEED_RAW_MAX || source == SpeedSource_none || source >= SpeedSource_count){
+        return;
+    }
+    SpeedInput * in = &s_inputs[source];
+    in->speed_mm_s = raw;
+    in->reverse = reverse;
+    in->rx_us = rx_us;
+}
+
+static void speed_read_gnss(void){
+    NmeaData nmea;
+    nmea_get_data(&nmea);
+    SpeedInput * in = &s_inputs[SpeedSource_gnss];
+    if(nmea.fix_quality == 0 || nmea.vel_us == in->rx_us){
+        return;
+    }
+    in->speed_mm_s = nmea.speed_mm_s;
+    in->reverse = 0;
+    in->rx_us = nmea.vel_us;
+}
+
+void speed_update(int64_t now_us){
+    speed_read_gnss();
+
+    // distance with the speed selected at the previous update, until it went stale
+    if(s_last_update_us != 0 && s_data.source != SpeedSource_none){
+        int64_t end_us = s_data.timestamp_us + speed_timeout_us(s_data.source);
+        if(end_us > now_us){
+            end_us = now_us;
+        }
+        if(end_us > s_last_update_us){
+            s_distance_nm += (int64_t)s_data.speed_mm_s * (end_us - s_last_update_us);
+        }
+    }
+    s_last_update_us = now_us;
+
+    s_data.source = SpeedSource_none;
+    s_data.speed_mm_s = 0;
+    s_data.reverse = 0;
+    for(uint8_t source = SpeedSource_ground; source < SpeedSource_count; ++source){
+        const SpeedInput * in = &s_inputs[source];
+        if(speed_is_fresh(source, in->rx_us, now_us)){
+            s_data.source = source;
+            s_data.speed_mm_s = in->speed_mm_s;
+            s_data.reverse = in->reverse;
+            s_data.timestamp_us = in->rx_us;
+            break;
+        }
+    }
+    s_data.distance_mm = (uint32_t)(s_distance_nm / 1000000);
+
+    seqlock_write(&s_lock, &s_published, &s_data, sizeof(SpeedData));
+}
+
+int speed_get(SpeedData * data, int64_t now_us){
+    seqlock_read(&s_lock, data, &s_published, sizeof(SpeedData));
+    // also stale if speed_update() is not called anymore
+    if(data->source == SpeedSource_none || !speed_is_fresh(data->source, data->timestamp_us, now_us)){
+        data->source = SpeedSource_none;
+        data->speed_mm_s = 0;
+        data->reverse = 0;
+        data->age_us = 0;
+        return 0;
+    }
+    data->age_us = (now_us > data->timestamp_us) ? (uint32_t)(now_us - data->timestamp_us) : 0;
+    return 1;
+}
+
+const char * speed_source_name(uint8_t source){
+    switch(source){
+        case SpeedSource_ground: return "ground";
+        case SpeedSource_gnss: return "gnss";
+        case SpeedSource_wheel: return "wheel";
+        default: return "none";
+    }
+}
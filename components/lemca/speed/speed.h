@@ -0,0 +1,47 @@
+#ifndef LEMCA_SPEED_H_
+#define LEMCA_SPEED_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// by decreasing quality: the radar does not slip, the GNSS speed lags
+typedef enum {
+    SpeedSource_none = 0,
+    SpeedSource_ground = 1,  // PGN 65097 ground based speed (radar)
+    SpeedSource_gnss = 2,    // NMEA VTG / RMC
+    SpeedSource_wheel = 3,   // PGN 65096 wheel based speed
+    SpeedSource_count
+} SpeedSource;
+
+#define SPEED_TIMEOUT_CAN_US  300000  // 100 ms broadcasts, 3 missed
+#define SPEED_TIMEOUT_GNSS_US 600000  // 5 Hz and more
+
+typedef struct {
+    int64_t timestamp_us;   // esp_timer_get_time() of the selected sample
+    uint32_t age_us;        // at the time of speed_get()
+    int32_t speed_mm_s;     // >= 0, 0 when no source is valid
+    uint32_t distance_mm;   // integrated from the selected speed, wraps
+    uint8_t source;         // SpeedSource, SpeedSource_none = safe state
+    uint8_t reverse;
+} SpeedData;
+
+// writers, all called from the ISOBUS loop
+// raw = J1939 speed in mm/s, values above 0xFAFF (error / not available) are ignored
+void speed_set_can(SpeedSource source, uint16_t raw, uint8_t reverse, int64_t rx_us);
+// takes the NMEA speed, arbitrates and publishes, to call once per loop
+void speed_update(int64_t now_us);
+
+// lock-free, callable from any core. Returns 0 and the safe state (speed 0,
+// SpeedSource_none) when the selected source is older than its timeout.
+int speed_get(SpeedData * data, int64_t now_us);
+
+const char * speed_source_name(uint8_t source);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
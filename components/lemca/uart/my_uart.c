@@ -4,74 +4,171 @@
 #include "esp_system.h"
 #include "soc/uart_struct.h"
 #include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
 #include "AppCommon/AppHW.h"
 
 #include <string.h>
 #include "my_uart.h"
 #include "../lemca.h"
+#include "../common/spsc_ring.h"
+#include "../nmea/nmea.h"
+#include "../imu/imu.h"
 
 #define BUF_SIZE (1024)
+#define RX_RING_SIZE (2048)
+#define RX_CHUNK_SIZE (256)
+#define UART_QUEUE_SIZE (20)
+
+#define UART_RX_TASK_CORE 0
+#define UART_RX_TASK_PRIORITY 10
+#define UART_RX_TASK_STACK 3072
 
 const int uart_imu_num = UART_NUM_1;
 const int uart_mnea_num = UART_NUM_2;
-    
-char* data_mnea;
-char* data_imu;
 
-void uart_init(void){ 
+// one RX task per port: it waits on the driver event queue and moves the
+// bytes into a lock-free ring, uart_loop() only reads the rings.
+typedef struct {
+    const char * name;
+    int uart_num;
+    QueueHandle_t queue;
+    SpscRing ring;
+    uint8_t ring_buf[RX_RING_SIZE];
+    uint8_t chunk[RX_CHUNK_SIZE];
+    uint32_t rx_bytes;
+    uint32_t overflows;
+} UartRxPort;
+
+static UartRxPort s_mnea_port = { .name = "mnea" };
+static UartRxPort s_imu_port = { .name = "imu" };
+
+static void uart_rx_drain(UartRxPort * port){
+    size_t len = 0;
+    uart_get_buffered_data_len(port->uart_num, &len);
+    while(len > 0){
+        int n = uart_read_bytes(port->uart_num, port->chunk, (len > RX_CHUNK_SIZE) ? RX_CHUNK_SIZE : len, 0);
+        if(n <= 0){
+            break;
+        }
+        port->rx_bytes += n;
+        spsc_ring_push(&port->ring, port->chunk, n);
+        len -= n;
+    }
+}
+
+static void uart_rx_task(void * arg){
+    UartRxPort * port = (UartRxPort *)arg;
+    uart_event_t event;
+    for(;;){
+        if(xQueueReceive(port->queue, &event, portMAX_DELAY) != pdTRUE){
+            continue;
+        }
+        switch(event.type){
+            case UART_DATA:
+                uart_rx_drain(port);
+                break;
+            case UART_PATTERN_DET:
+                uart_rx_drain(port);
+                // the bytes are already read, forget the line positions
+                while(uart_pattern_pop_pos(port->uart_num) != -1){
+                }
+                break;
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                port->overflows++;
+                uart_flush_input(port->uart_num);
+                xQueueReset(port->queue);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void uart_rx_start(UartRxPort * port, int uart_num){
+    port->uart_num = uart_num;
+    spsc_ring_init(&port->ring, port->ring_buf, 1, RX_RING_SIZE);
+    xTaskCreatePinnedToCore(uart_rx_task, port->name, UART_RX_TASK_STACK, port,
+        UART_RX_TASK_PRIORITY, NULL, UART_RX_TASK_CORE);
+}
+
+void uart_init(void){
     uart_config_t uart_mnea_config = {
         .baud_rate = 115200,
         .data_bits = UART_DATA_8_BITS,
         .parity = UART_PARITY_DISABLE,
         .stop_bits = UART_STOP_BITS_1,
-        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,    
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
         .rx_flow_ctrl_thresh = 122,
     };
     uart_param_config(uart_mnea_num, &uart_mnea_config);
     uart_set_pin(uart_mnea_num, 15, 16, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-    
-    uart_driver_install(uart_mnea_num, BUF_SIZE*2, 0, 0, NULL, 0);
-    
+
+    uart_driver_install(uart_mnea_num, BUF_SIZE*2, 0, UART_QUEUE_SIZE, &s_mnea_port.queue, 0);
+    // wake the RX task at each end of NMEA sentence
+    uart_enable_pattern_det_baud_intr(uart_mnea_num, '\n', 1, 9, 0, 0);
+    uart_pattern_queue_reset(uart_mnea_num, UART_QUEUE_SIZE);
+
     //hw_DebugPrint("Setup imu !\n");
     uart_config_t uart_imu_config = {
         .baud_rate = 9600,
         .data_bits = UART_DATA_8_BITS,
         .parity = UART_PARITY_DISABLE,
         .stop_bits = UART_STOP_BITS_1,
-        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,    
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
         .rx_flow_ctrl_thresh = 122,
     };
     uart_param_config(uart_imu_num, &uart_imu_config);
     uart_set_pin(uart_imu_num, 17, 18, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-    
-    uart_driver_install(uart_imu_num, BUF_SIZE * 2, 0, 0, NULL, 0);
-    
-    data_mnea = (char*) malloc(BUF_SIZE);
-    data_imu = (char*) malloc(BUF_SIZE);
+
+    uart_driver_install(uart_imu_num, BUF_SIZE * 2, 0, UART_QUEUE_SIZE, &s_imu_port.queue, 0);
+
+    uart_rx_start(&s_mnea_port, uart_mnea_num);
+    uart_rx_start(&s_imu_port, uart_imu_num);
 }
 
 void uart_loop(void){
-    int millis = esp_timer_get_time()/1000;
+    int64_t now_us = hw_GetTimeUs();
+    int millis = now_us/1000;
     uart_send_loop_message(millis);
 
-    int len_mnea = uart_read_bytes(uart_mnea_num, data_mnea, BUF_SIZE, 10 / portTICK_RATE_MS);
-    if(len_mnea > 0){
-        for(int i = 0; i < len_mnea; ++i){
-            //mneaReadChar(data_mnea[i]);
-        }
-        //hw_DebugPrint(" mnea (%i) => %.*s\n", millis, len_mnea, data_mnea);
+    const void * data;
+    uint32_t len_mnea;
+    while((len_mnea = spsc_ring_peek(&s_mnea_port.ring, &data)) > 0){
+        // parsed in place, the ring span is released afterwards
+        nmea_parse((const char *)data, len_mnea, now_us);
+        //hw_DebugPrint(" mnea (%i) => %.*s\n", millis, len_mnea, data);
+        spsc_ring_consume(&s_mnea_port.ring, len_mnea);
     }
-    
-    
-    int len_imu = uart_read_bytes(uart_imu_num, data_imu, BUF_SIZE, 10 / portTICK_RATE_MS);
-    if(len_imu > 0){
-        for(int i = 0; i < len_imu; ++i){
-            //imuReadChar(data_imu[i]);
-        }
-        //hw_DebugPrint(" imu (%i) => %.*s\n", millis, len_imu, data_imu);
+
+    uint32_t len_imu;
+    while((len_imu = spsc_ring_peek(&s_imu_port.ring, &data)) > 0){
+        imu_parse((const uint8_t *)data, len_imu, now_us);
+        //hw_DebugPrint(" imu (%i) => %.*s\n", millis, len_imu, data);
+        spsc_ring_consume(&s_imu_port.ring, len_imu);
     }
+}
+
+static void uart_print_port_stats(const UartRxPort * port){
+    hw_DebugPrint("*** uart %s rx %u dropped %u overflows %u high water %u\n",
+        port->name, port->rx_bytes, port->ring.dropped, port->overflows, port->ring.high_water);
+}
 
-    
+void uart_print_stats(void){
+    uart_print_port_stats(&s_mnea_port);
+    uart_print_port_stats(&s_imu_port);
+
+    NmeaStats nmea;
+    nmea_get_stats(&nmea);
+    hw_DebugPrint("*** nmea sentences %u ignored %u checksum errors %u framing errors %u\n",
+        nmea.sentences, nmea.ignored, nmea.checksum_errors, nmea.framing_errors);
+
+    ImuStats imu;
+    imu_get_stats(&imu);
+    hw_DebugPrint("*** imu frames %u samples %u checksum errors %u skipped %u\n",
+        imu.frames, imu.samples, imu.checksum_errors, imu.skipped_bytes);
 }
 
 int old_time = 0;
@@ -83,4 +180,4 @@ void uart_send_message_aux(int touch){
 
 void uart_send_message(char * c){
     uart_write_bytes(uart_mnea_num, (const char*)c, strlen(c));
-}
\ No newline at end of file
+}
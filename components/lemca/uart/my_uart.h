@@ -9,6 +9,8 @@ void uart_init();
 
 void uart_loop();
 
+void uart_print_stats();
+
 void uart_send_loop_message(int millis);
 
 void uart_send_message_aux(int touch);
@@ -0,0 +1,142 @@
+#include "valve_map.h"
+
+#include <stdio.h>
+
+#include "Settings/settings.h"
+#include "AppCommon/AppHW.h"
+
+typedef struct {
+    int32_t opening;   // % of DB..SAT
+    int32_t flow;      // %
+} ValvePoint;
+
+typedef struct {
+    int32_t dead_band;      // per mille
+    int32_t saturation;     // per mille
+    uint8_t n;
+    ValvePoint points[VALVE_MAP_MAX_POINTS + 2];    // with (0,0) and (100,100)
+    int32_t dither_duty;
+    uint32_t dither_step;   // phase increment per control period, 2^16 = one period
+} ValveMapConfig;
+
+static ValveMapConfig s_config[Valve_count];
+
+// duty at each knot, built once at init
+static uint16_t s_lut[Valve_count][VALVE_MAP_LUT_KNOTS + 1];
+static uint16_t s_dither_phase[Valve_count];
+
+static int32_t valve_get(int valve, const char * field, int i, int32_t def){
+    char key[16];
+    if(i < 0){
+        sprintf(key, "VLV%d%s", valve, field);
+    } else {
+        sprintf(key, "VLV%d%s%d", valve, field, i);
+    }
+    return getS32("VALVE", key, def);
+}
+
+static int32_t clamp(int32_t v, int32_t min, int32_t max){
+    if(v < min){
+        return min;
+    }
+    if(v > max){
+        return max;
+    }
+    return v;
+}
+
+static void valve_load(int valve, uint32_t period_us){
+    ValveMapConfig * c = &s_config[valve];
+    c->dead_band = clamp(valve_get(valve, "DB", -1, 0), 0, 999);
+    c->saturation = clamp(valve_get(valve, "SAT", -1, 1000), c->dead_band + 1, 1000);
+
+    int32_t n = clamp(valve_get(valve, "N", -1, 0), 0, VALVE_MAP_MAX_POINTS);
+    c->points[0].opening = 0;
+    c->points[0].flow = 0;
+    c->n = 1;
+    for(int i = 0; i < n; ++i){
+        ValvePoint p;
+        p.opening = valve_get(valve, "O", i, 0);
+        p.flow = valve_get(valve, "F", i, 0);
+        const ValvePoint * last = &c->points[c->n - 1];
+        if(p.opening <= last->opening || p.flow <= last->flow || p.opening >= 100 || p.flow >= 100){
+            hw_DebugPrint("*** valve %i point %i ignored\n", valve, i);
+            continue;
+        }
+        c->points[c->n++] = p;
+    }
+    c->points[c->n].opening = 100;
+    c->points[c->n].flow = 100;
+    c->n++;
+
+    c->dither_duty = clamp(valve_get(valve, "DA", -1, 0), 0, 200) * VALVE_DUTY_MAX / 1000;
+    uint32_t dither_hz = clamp(valve_get(valve, "DF", -1, 0), 0, 1000000 / period_us / 2);
+    c->dither_step = ((uint64_t)dither_hz * period_us << 16) / 1000000;
+    if(c->dither_step == 0){
+        c->dither_duty = 0;
+    }
+}
+
+// opening in % of DB..SAT for a flow in % (Q16), inverse of the measured curve
+static q16_t valve_opening(const ValveMapConfig * c, q16_t flow){
+    uint8_t i = 1;
+    while(i < c->n - 1 && flow > Q16_FROM_INT(c->points[i].flow)){
+        ++i;
+    }
+    const ValvePoint * a = &c->points[i - 1];
+    const ValvePoint * b = &c->points[i];
+    return Q16_FROM_INT(a->opening)
+        + (q16_t)(((int64_t)(b->opening - a->opening) * (flow - Q16_FROM_INT(a->flow))) / (b->flow - a->flow));
+}
+
+static void valve_build(int valve){
+    const ValveMapConfig * c = &s_config[valve];
+    for(int k = 0; k <= VALVE_MAP_LUT_KNOTS; ++k){
+        q16_t opening = valve_opening(c, Q16_FROM_RATIO(k * 100, VALVE_MAP_LUT_KNOTS));
+        int64_t per_mille = ((int64_t)c->dead_band << 16) + (int64_t)(c->saturation - c->dead_band) * opening / 100;
+        s_lut[valve][k] = (per_mille * VALVE_DUTY_MAX / 1000 + (1 << 15)) >> 16;
+    }
+}
+
+void valve_map_init(uint32_t period_us){
+    for(int valve = 0; valve < Valve_count; ++valve){
+        valve_load(valve, period_us);
+        valve_build(valve);
+        s_dither_phase[valve] = 0;
+    }
+}
+
+uint32_t valve_map_duty(int valve, q16_t command_100){
+    const ValveMapConfig * c = &s_config[valve];
+    s_dither_phase[valve] += c->dither_step;
+    if(command_100 <= 0){
+        return 0;
+    }
+    if(command_100 > Q16_FROM_INT(100)){
+        command_100 = Q16_FROM_INT(100);
+    }
+    // position on the knots, 16 fractional bits
+    uint32_t pos = ((int64_t)command_100 * VALVE_MAP_LUT_KNOTS) / 100;
+    uint32_t i = pos >> 16;
+    uint32_t f = pos & 0xFFFF;
+    const uint16_t * lut = s_lut[valve];
+    int32_t duty = lut[i];
+    if(i < VALVE_MAP_LUT_KNOTS){
+        duty += ((int32_t)(lut[i + 1] - lut[i]) * (int32_t)f) >> 16;
+    }
+    if(c->dither_duty){
+        duty += (s_dither_phase[valve] & 0x8000) ? -c->dither_duty : c->dither_duty;
+    }
+    return clamp(duty, 0, VALVE_DUTY_MAX);
+}
+
+void valve_map_print(void){
+    for(int valve = 0; valve < Valve_count; ++valve){
+        const ValveMapConfig * c = &s_config[valve];
+        hw_DebugPrint("*** valve %i dead band %i sat %i dither %i duty, %i points\n",
+            valve, c->dead_band, c->saturation, c->dither_duty, c->n);
+        for(int i = 0; i < c->n; ++i){
+            hw_DebugPrint("***-  %i %% open = %i %% flow\n", c->points[i].opening, c->points[i].flow);
+        }
+    }
+}
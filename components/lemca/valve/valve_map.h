@@ -0,0 +1,37 @@
+#ifndef LEMCA_VALVE_MAP_H_
+#define LEMCA_VALVE_MAP_H_
+
+#include <stdint.h>
+
+#include "../common/q16.h"
+#include "valve_output.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VALVE_MAP_MAX_POINTS 5
+#define VALVE_MAP_LUT_KNOTS 64      // intervals on 0..100 % of command
+
+// Characterisation of a proportional valve, settings "VLV<valve>..." in per mille
+// of the PWM duty. Without settings: no dead band, linear, no dither (former mapping).
+//  VLV<v>DB   duty where the valve starts to open
+//  VLV<v>SAT  duty of the full flow
+//  VLV<v>N, VLV<v>O<i>, VLV<v>F<i>  measured flow (F, %) at opening (O, % of DB..SAT),
+//             both increasing, (0,0) and (100,100) are implicit
+//  VLV<v>DA   dither amplitude, VLV<v>DF dither frequency in Hz (square wave
+//             generated at the control rate: at most CONTROL_RATE_HZ/2)
+void valve_map_init(uint32_t period_us);
+
+// hot path: command in percent of the flow (0..100, Q16) -> PWM duty, the
+// dither phase of the valve advances by one control period.
+// 0 gives 0, the valve is closed without dither.
+uint32_t valve_map_duty(int valve, q16_t command_100);
+
+void valve_map_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
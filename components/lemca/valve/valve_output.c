@@ -0,0 +1,111 @@
+#include "valve_output.h"
+
+#include "driver/ledc.h"
+#include "hal/ledc_ll.h"
+#include "hal/cpu_hal.h"
+#include "soc/ledc_struct.h"
+
+// 1 = former path through ledc_set_duty()/ledc_update_duty(), to compare the cost
+#define VALVE_OUTPUT_USE_DRIVER 0
+
+#define VALVE_SPEED_MODE LEDC_LOW_SPEED_MODE
+#define VALVE_FADE_MAX 1023     // duty_num / duty_cycle / duty_scale register width
+
+static const ledc_channel_t s_channels[Valve_count] = {
+    LEDC_CHANNEL_0, LEDC_CHANNEL_1, LEDC_CHANNEL_2, LEDC_CHANNEL_3
+};
+
+static uint32_t s_duty[Valve_count];
+static uint32_t s_ramp_periods = 0;    // PWM periods of a ramp
+static ValveOutputStats s_stats;
+
+void valve_output_init(uint32_t ramp_us){
+    s_ramp_periods = (uint64_t)ramp_us * VALVE_PWM_FREQ_HZ / 1000000;
+    if(s_ramp_periods > VALVE_FADE_MAX){
+        s_ramp_periods = VALVE_FADE_MAX;
+    }
+    for(int i = 0; i < Valve_count; ++i){
+        s_duty[i] = 0;
+    }
+}
+
+#if !VALVE_OUTPUT_USE_DRIVER
+// same register sequence as ledc_set_duty() + ledc_update_duty(), without the
+// driver lock: only the control task writes the valve channels
+static void valve_set_registers(ledc_channel_t channel, uint32_t from, uint32_t to){
+    uint32_t diff = (to > from) ? to - from : from - to;
+    uint32_t start = to;
+    uint32_t num = 1;
+    uint32_t cycle = 1;
+    uint32_t scale = 0;
+    if(s_ramp_periods > 1 && diff > 1){
+        if(diff <= s_ramp_periods){
+            // +-1 every cycle periods
+            num = diff;
+            cycle = s_ramp_periods / diff;
+            scale = 1;
+        } else {
+            // +-scale every period, the remainder is applied at once
+            num = s_ramp_periods;
+            scale = diff / s_ramp_periods;
+            if(scale > VALVE_FADE_MAX){
+                scale = VALVE_FADE_MAX;
+            }
+        }
+        start = (to > from) ? to - num * scale : to + num * scale;
+    }
+    ledc_ll_set_duty_int_part(&LEDC, VALVE_SPEED_MODE, channel, start);
+    ledc_ll_set_duty_direction(&LEDC, VALVE_SPEED_MODE, channel, (to >= from) ? LEDC_DUTY_DIR_INCREASE : LEDC_DUTY_DIR_DECREASE);
+    ledc_ll_set_duty_num(&LEDC, VALVE_SPEED_MODE, channel, num);
+    ledc_ll_set_duty_cycle(&LEDC, VALVE_SPEED_MODE, channel, cycle);
+    ledc_ll_set_duty_scale(&LEDC, VALVE_SPEED_MODE, channel, scale);
+    ledc_ll_set_duty_start(&LEDC, VALVE_SPEED_MODE, channel, true);
+}
+#endif
+
+void valve_output_write(const uint32_t duty[Valve_count]){
+    uint32_t start = cpu_hal_get_cycle_count();
+    uint32_t changed = 0;
+
+    for(int i = 0; i < Valve_count; ++i){
+        uint32_t d = (duty[i] > VALVE_DUTY_MAX) ? VALVE_DUTY_MAX : duty[i];
+        if(d == s_duty[i]){
+            continue;
+        }
+#if VALVE_OUTPUT_USE_DRIVER
+        ledc_set_duty(VALVE_SPEED_MODE, s_channels[i], d);
+        ledc_update_duty(VALVE_SPEED_MODE, s_channels[i]);
+#else
+        valve_set_registers(s_channels[i], s_duty[i], d);
+#endif
+        s_duty[i] = d;
+        changed |= 1 << i;
+    }
+
+#if !VALVE_OUTPUT_USE_DRIVER
+    // the channels share the timer: latched together at the next period
+    for(int i = 0; i < Valve_count; ++i){
+        if(changed & (1 << i)){
+            ledc_ll_ls_channel_update(&LEDC, VALVE_SPEED_MODE, s_channels[i]);
+            s_stats.channel_updates++;
+        }
+    }
+#else
+    s_stats.channel_updates += __builtin_popcount(changed);
+#endif
+
+    uint32_t cycles = cpu_hal_get_cycle_count() - start;
+    s_stats.writes++;
+    s_stats.last_cycles = cycles;
+    if(cycles > s_stats.max_cycles){
+        s_stats.max_cycles = cycles;
+    }
+}
+
+void valve_output_get_stats(ValveOutputStats * stats){
+    *stats = s_stats;
+}
+
+void valve_output_reset_max(void){
+    s_stats.max_cycles = 0;
+}
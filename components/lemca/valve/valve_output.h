@@ -0,0 +1,44 @@
+#ifndef LEMCA_VALVE_OUTPUT_H_
+#define LEMCA_VALVE_OUTPUT_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// order of setElectrovanne()
+enum Valve {
+    Valve_left = 0,
+    Valve_right = 1,
+    Valve_up = 2,
+    Valve_down = 3,
+    Valve_count
+};
+
+#define VALVE_DUTY_MAX 8191     // 13 bits LEDC timer
+#define VALVE_PWM_FREQ_HZ 1000
+
+typedef struct {
+    uint32_t writes;            // calls of valve_output_write()
+    uint32_t channel_updates;   // channels actually reprogrammed
+    uint32_t last_cycles;       // CPU cycles of the last write
+    uint32_t max_cycles;
+} ValveOutputStats;
+
+// the LEDC timer and channels are configured by initPwm()
+// ramp_us: hardware fade from the previous duty, 0 = step
+void valve_output_init(uint32_t ramp_us);
+
+// writes the four duties at once, unchanged channels are skipped.
+// Only called from the control task.
+void valve_output_write(const uint32_t duty[Valve_count]);
+
+void valve_output_get_stats(ValveOutputStats * stats);
+void valve_output_reset_max(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
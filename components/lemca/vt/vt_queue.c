@@ -0,0 +1,149 @@
+#include "vt_queue.h"
+
+#include <string.h>
+
+#include "IsoDef.h"
+#include "lib_cci/IsoVtcApi.h"
+#include "AppCommon/AppHW.h"
+
+#define VT_STRING_HEADER 5          // command, object ID, length
+
+typedef struct {
+    uint16_t object_id;
+    uint8_t priority;
+    uint8_t is_string;
+    uint32_t order;
+    uint32_t queued_ms;
+    uint32_t value;
+    char string[VT_QUEUE_STRING_MAX];
+} VtCommand;
+
+static VtCommand s_commands[VT_QUEUE_MAX];
+static int s_n_commands = 0;
+static uint32_t s_order = 0;
+static uint8_t s_instance = 0;
+static uint8_t s_frames_per_flush = 2;
+static uint8_t s_tx_reserve = 0;
+static VtQueueStats s_stats;
+
+void vt_queue_init(uint8_t instance, uint8_t frames_per_flush, uint8_t tx_reserve){
+    s_instance = instance;
+    s_frames_per_flush = frames_per_flush;
+    s_tx_reserve = tx_reserve;
+    s_n_commands = 0;
+}
+
+static VtCommand * vt_queue_slot(uint16_t object_id, uint8_t priority, uint32_t now_ms){
+    for(int i = 0; i < s_n_commands; ++i){
+        VtCommand * c = &s_commands[i];
+        if(c->object_id == object_id){
+            if(priority < c->priority){
+                c->priority = priority;
+            }
+            s_stats.coalesced++;
+            return c;
+        }
+    }
+    if(s_n_commands == VT_QUEUE_MAX){
+        s_stats.full++;
+        return NULL;
+    }
+    VtCommand * c = &s_commands[s_n_commands++];
+    c->object_id = object_id;
+    c->priority = priority;
+    c->order = s_order++;
+    c->queued_ms = now_ms;
+    s_stats.queued++;
+    if((uint32_t)s_n_commands > s_stats.high_water){
+        s_stats.high_water = s_n_commands;
+    }
+    return c;
+}
+
+int vt_queue_numeric(uint16_t object_id, uint32_t value, uint8_t priority, uint32_t now_ms){
+    VtCommand * c = vt_queue_slot(object_id, priority, now_ms);
+    if(c == NULL){
+        return 0;
+    }
+    c->is_string = 0;
+    c->value = value;
+    return 1;
+}
+
+int vt_queue_string(uint16_t object_id, const char * value, uint8_t priority, uint32_t now_ms){
+    VtCommand * c = vt_queue_slot(object_id, priority, now_ms);
+    if(c == NULL){
+        return 0;
+    }
+    c->is_string = 1;
+    strncpy(c->string, value, VT_QUEUE_STRING_MAX - 1);
+    c->string[VT_QUEUE_STRING_MAX - 1] = 0;
+    return 1;
+}
+
+// single frame, or TP.CM + TP.DT frames of 7 bytes
+static int vt_command_frames(const VtCommand * c){
+    if(!c->is_string){
+        return 1;
+    }
+    int bytes = VT_STRING_HEADER + (int)strlen(c->string);
+    return bytes <= 8 ? 1 : 1 + (bytes + 6) / 7;
+}
+
+static int vt_queue_next(void){
+    int next = -1;
+    for(int i = 0; i < s_n_commands; ++i){
+        const VtCommand * c = &s_commands[i];
+        if(next < 0 || c->priority < s_commands[next].priority
+            || (c->priority == s_commands[next].priority && c->order < s_commands[next].order)){
+            next = i;
+        }
+    }
+    return next;
+}
+
+void vt_queue_flush(uint32_t now_ms){
+    if(s_instance == 0){
+        return;
+    }
+    int budget = s_frames_per_flush;
+    while(s_n_commands > 0){
+        int i = vt_queue_next();
+        VtCommand * c = &s_commands[i];
+        int frames = vt_command_frames(c);
+        if(c->priority != VtPriority_feedback){
+            int free_buffers = hw_CanGetFreeSendMsgBufferSize(ISO_CAN_VT);
+            // a command bigger than the budget goes alone
+            int over_budget = frames > budget && budget < s_frames_per_flush;
+            if(over_budget || budget <= 0 || free_buffers < s_tx_reserve + frames){
+                s_stats.budget_waits++;
+                return;
+            }
+        }
+        iso_s16 ret = c->is_string
+            ? IsoVtcCmd_String(s_instance, c->object_id, (const iso_u8 *)c->string)
+            : IsoVtcCmd_NumericValue(s_instance, c->object_id, c->value);
+        if(ret != E_NO_ERR){
+            // command FIFO of lib_cci full
+            s_stats.overflows++;
+            return;
+        }
+        budget -= frames;
+        s_stats.sent++;
+        s_stats.frames += frames;
+        uint32_t wait_ms = now_ms - c->queued_ms;
+        if(wait_ms > s_stats.max_wait_ms[c->priority]){
+            s_stats.max_wait_ms[c->priority] = wait_ms;
+        }
+        s_commands[i] = s_commands[--s_n_commands];
+    }
+}
+
+void vt_queue_get_stats(VtQueueStats * stats){
+    *stats = s_stats;
+}
+
+void vt_queue_reset_max(void){
+    memset(s_stats.max_wait_ms, 0, sizeof(s_stats.max_wait_ms));
+    s_stats.high_water = s_n_commands;
+}
@@ -0,0 +1,56 @@
+#ifndef LEMCA_VT_QUEUE_H_
+#define LEMCA_VT_QUEUE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// VT commands of the application, in front of the command FIFO of lib_cci.
+// A command on an object already queued replaces it (the newest value, the
+// highest priority and the oldest queue time are kept). vt_queue_flush(),
+// every loop, hands the commands to lib_cci by priority then age within a
+// budget of CAN frames per call and while the CAN driver keeps tx_reserve
+// free buffers for the rest of the stack (TC, pool upload). Feedback commands
+// ignore the budget and the reserve, so they never wait behind cyclic values.
+
+#define VT_QUEUE_MAX 16
+#define VT_QUEUE_STRING_MAX 32      // with the '\0'
+
+enum VtPriority {
+    VtPriority_feedback = 0,    // alarms, answer to a button
+    VtPriority_cyclic = 1,      // values
+    VtPriority_cosmetic = 2,    // strings
+    VtPriority_count
+};
+
+typedef struct {
+    uint32_t queued;
+    uint32_t coalesced;         // replaced a queued command
+    uint32_t full;
+    uint32_t sent;
+    uint32_t frames;            // estimated
+    uint32_t budget_waits;      // flushes stopped by the budget or the reserve
+    uint32_t overflows;         // refused by lib_cci, tried again
+    uint32_t max_wait_ms[VtPriority_count];
+    uint32_t high_water;
+} VtQueueStats;
+
+// new VT client instance, the queue is emptied
+void vt_queue_init(uint8_t instance, uint8_t frames_per_flush, uint8_t tx_reserve);
+
+// 0 when the queue is full
+int vt_queue_numeric(uint16_t object_id, uint32_t value, uint8_t priority, uint32_t now_ms);
+int vt_queue_string(uint16_t object_id, const char * value, uint8_t priority, uint32_t now_ms);
+
+void vt_queue_flush(uint32_t now_ms);
+
+void vt_queue_get_stats(VtQueueStats * stats);
+void vt_queue_reset_max(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
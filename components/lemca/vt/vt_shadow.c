@@ -0,0 +1,186 @@
+#include "vt_shadow.h"
+
+#include <string.h>
+
+#include "vt_queue.h"
+
+typedef struct {
+    uint16_t object_id;
+    uint8_t acked;          // the acked value is shown by the VT
+    uint8_t waiting;        // the sent value has no response yet
+    uint8_t sent_once;
+    uint32_t min_ms;
+    uint32_t max_ms;
+    uint32_t last_ms;       // last command
+    uint32_t value_sent;
+    uint32_t value_acked;
+    char string_sent[VT_SHADOW_STRING_MAX];
+    char string_acked[VT_SHADOW_STRING_MAX];
+} VtShadowEntry;
+
+static VtShadowEntry s_entries[VT_SHADOW_MAX_OBJECTS];
+static int s_n_entries = 0;
+static VtShadowStats s_stats;
+
+static VtShadowEntry * vt_shadow_find(uint16_t object_id){
+    for(int i = 0; i < s_n_entries; ++i){
+        if(s_entries[i].object_id == object_id){
+            return &s_entries[i];
+        }
+    }
+    return NULL;
+}
+
+void vt_shadow_init(void){
+    s_n_entries = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+int vt_shadow_add(uint16_t object_id, uint32_t min_ms, uint32_t max_ms){
+    VtShadowEntry * e = vt_shadow_find(object_id);
+    if(e == NULL){
+        if(s_n_entries == VT_SHADOW_MAX_OBJECTS){
+            return 0;
+        }
+        e = &s_entries[s_n_entries++];
+    }
+    memset(e, 0, sizeof(*e));
+    e->object_id = object_id;
+    e->min_ms = min_ms;
+    e->max_ms = max_ms;
+    return 1;
+}
+
+void vt_shadow_invalidate(void){
+    for(int i = 0; i < s_n_entries; ++i){
+        s_entries[i].acked = 0;
+        s_entries[i].waiting = 0;
+        s_entries[i].sent_once = 0;
+    }
+}
+
+int vt_shadow_due(uint16_t object_id, uint32_t now_ms){
+    const VtShadowEntry * e = vt_shadow_find(object_id);
+    if(e == NULL || !e->sent_once){
+        return 1;
+    }
+    uint32_t age_ms = now_ms - e->last_ms;
+    return age_ms >= (e->waiting ? VT_SHADOW_RESPONSE_MS : e->min_ms);
+}
+
+// 1: to be sent, stats of the skipped updates
+static int vt_shadow_check(VtShadowEntry * e, int same_sent, int same_acked, uint8_t priority, uint32_t now_ms){
+    uint32_t age_ms = now_ms - e->last_ms;
+    if(e->waiting){
+        // one command at a time: the response does not say which value it
+        // answers, a new value waits for it or for the timeout
+        if(age_ms < VT_SHADOW_RESPONSE_MS){
+            if(same_sent){
+                s_stats.unchanged++;
+            } else {
+                s_stats.held++;
+            }
+            return 0;
+        }
+        s_stats.timeouts++;
+        return 1;
+    }
+    if(!e->waiting && e->acked && same_acked){
+        if(e->max_ms == 0 || age_ms < e->max_ms){
+            s_stats.unchanged++;
+            return 0;
+        }
+        s_stats.refreshes++;
+        return 1;
+    }
+    if(e->sent_once && age_ms < e->min_ms && priority != VtPriority_feedback){
+        s_stats.rate_limited++;
+        return 0;
+    }
+    return 1;
+}
+
+static int vt_shadow_result(VtShadowEntry * e, int queued, uint32_t now_ms){
+    if(!queued){
+        s_stats.rejected++;
+        return 0;
+    }
+    e->waiting = 1;
+    e->sent_once = 1;
+    e->last_ms = now_ms;
+    s_stats.sent++;
+    return 1;
+}
+
+int vt_shadow_numeric(uint16_t object_id, uint32_t value, uint8_t priority, uint32_t now_ms){
+    VtShadowEntry * e = vt_shadow_find(object_id);
+    if(e == NULL){
+        // not tracked: always sent
+        return vt_queue_numeric(object_id, value, priority, now_ms);
+    }
+    if(!vt_shadow_check(e, e->value_sent == value, e->value_acked == value, priority, now_ms)){
+        return 0;
+    }
+    int queued = vt_queue_numeric(object_id, value, priority, now_ms);
+    if(queued){
+        e->value_sent = value;
+    }
+    return vt_shadow_result(e, queued, now_ms);
+}
+
+int vt_shadow_string(uint16_t object_id, const char * value, uint8_t priority, uint32_t now_ms){
+    VtShadowEntry * e = vt_shadow_find(object_id);
+    if(e == NULL){
+        return vt_queue_string(object_id, value, priority, now_ms);
+    }
+    if(!vt_shadow_check(e, strncmp(e->string_sent, value, VT_SHADOW_STRING_MAX - 1) == 0,
+        strncmp(e->string_acked, value, VT_SHADOW_STRING_MAX - 1) == 0, priority, now_ms)){
+        return 0;
+    }
+    int queued = vt_queue_string(object_id, value, priority, now_ms);
+    if(queued){
+        strncpy(e->string_sent, value, VT_SHADOW_STRING_MAX - 1);
+        e->string_sent[VT_SHADOW_STRING_MAX - 1] = 0;
+    }
+    return vt_shadow_result(e, queued, now_ms);
+}
+
+void vt_shadow_set_known(uint16_t object_id, uint32_t value){
+    VtShadowEntry * e = vt_shadow_find(object_id);
+    if(e != NULL){
+        e->value_sent = value;
+        e->value_acked = value;
+        e->acked = 1;
+        e->waiting = 0;
+    }
+}
+
+void vt_shadow_response(uint16_t object_id, int16_t error){
+    VtShadowEntry * e = vt_shadow_find(object_id);
+    if(e == NULL || !e->waiting){
+        return;
+    }
+    e->waiting = 0;
+    if(error != 0){
+        // the VT may show anything: sent again at the next update
+        e->acked = 0;
+        s_stats.errors++;
+        return;
+    }
+    e->value_acked = e->value_sent;
+    memcpy(e->string_acked, e->string_sent, VT_SHADOW_STRING_MAX);
+    e->acked = 1;
+    s_stats.acked++;
+}
+
+void vt_shadow_get_stats(VtShadowStats * stats){
+    *stats = s_stats;
+}
+
+int vt_shadow_waiting(void){
+    int n = 0;
+    for(int i = 0; i < s_n_entries; ++i){
+        n += s_entries[i].waiting;
+    }
+    return n;
+}
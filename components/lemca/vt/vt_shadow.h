@@ -0,0 +1,63 @@
+#ifndef LEMCA_VT_SHADOW_H_
+#define LEMCA_VT_SHADOW_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Values of the objects updated by updateVTC(): the last one sent and the
+// last one acknowledged by the VT. The response of the VT to a change numeric
+// or change string value command (vt_shadow_response, from CbVtMessages)
+// acknowledges the sent value when it has no error and forgets the shown one
+// otherwise. A command is queued (vt_queue.h) only when the new value differs
+// from the acknowledged one and the previous command of the object is at least
+// min_ms old; max_ms forces a refresh of an unchanged value (0 = never).
+// Feedback ignores min_ms. While a command of the object waits for its
+// response, no other is queued for it before VT_SHADOW_RESPONSE_MS: a new
+// value is held and sent at the first update after the response, so each
+// response acknowledges the value it answers.
+
+#define VT_SHADOW_MAX_OBJECTS 16
+#define VT_SHADOW_STRING_MAX 32     // with the '\0'
+#define VT_SHADOW_RESPONSE_MS 1500  // response timeout of the VT, from the queueing
+
+typedef struct {
+    uint32_t sent;
+    uint32_t unchanged;     // same value as the VT, not sent
+    uint32_t rate_limited;  // changed but within min_ms, sent later
+    uint32_t held;          // changed while waiting for a response, sent later
+    uint32_t refreshes;     // unchanged, sent after max_ms
+    uint32_t rejected;      // queue full
+    uint32_t acked;         // responses without error
+    uint32_t errors;        // responses with an error, sent again
+    uint32_t timeouts;      // no response after VT_SHADOW_RESPONSE_MS, sent again
+} VtShadowStats;
+
+void vt_shadow_init(void);
+// 0 when the table is full
+int vt_shadow_add(uint16_t object_id, uint32_t min_ms, uint32_t max_ms);
+// new VT or pool (re)loaded: the VT shows the values of the pool, all resent
+void vt_shadow_invalidate(void);
+
+// 1 when a command for the object could go now (min_ms elapsed, no response
+// waiting): the caller can skip the formatting of a string otherwise
+int vt_shadow_due(uint16_t object_id, uint32_t now_ms);
+// priority of vt_queue.h, 1 when a command was queued
+int vt_shadow_numeric(uint16_t object_id, uint32_t value, uint8_t priority, uint32_t now_ms);
+int vt_shadow_string(uint16_t object_id, const char * value, uint8_t priority, uint32_t now_ms);
+// value entered by the operator on the VT, already displayed
+void vt_shadow_set_known(uint16_t object_id, uint32_t value);
+// response of the VT to the last value command of the object, error 0 = shown
+void vt_shadow_response(uint16_t object_id, int16_t error);
+
+void vt_shadow_get_stats(VtShadowStats * stats);
+// objects with a command waiting for its response
+int vt_shadow_waiting(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
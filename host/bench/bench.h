@@ -0,0 +1,50 @@
+#ifndef HOST_BENCH_H_
+#define HOST_BENCH_H_
+
+// Helpers of the host checks and benchmarks of host/bench: a monotonic clock,
+// a seeded pseudo random generator and a check that prints the failed
+// condition. Each program returns
+// bench_result(): 0 when all the checks passed, so it can run under ctest.
+// The timings are of the workstation, only the ratios say something about
+// the esp32s3.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static int s_bench_checks = 0;
+static int s_bench_failures = 0;
+static uint32_t s_bench_seed = 12345;
+
+static inline int64_t bench_now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// LCG of Numerical Recipes: the same data on every run and every workstation
+static inline void bench_seed(uint32_t seed){
+    s_bench_seed = seed;
+}
+
+static inline uint32_t bench_rand(void){
+    s_bench_seed = s_bench_seed * 1664525u + 1013904223u;
+    return s_bench_seed >> 8;
+}
+
+#define BENCH_CHECK(cond, ...) do { \
+    s_bench_checks++; \
+    if(!(cond)){ \
+        s_bench_failures++; \
+        printf("FAIL %s:%d %s: ", __FILE__, __LINE__, #cond); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while(0)
+
+static inline int bench_result(void){
+    printf("%d checks, %d failed\n", s_bench_checks, s_bench_failures);
+    return s_bench_failures == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,207 @@
+// Checks and benchmark of dsp/dsp_filter, built with CONFIG_LEMCA_ESP_DSP on
+// the plain C esp-dsp decimator of esp_host.c:
+// - FIR decimator, scalar and esp-dsp paths: bit exact against a direct
+//   convolution, the input cut in random blocks like the DMA frames
+// - biquad: within DSP_BIQUAD_TOLERANCE of a double filter with the same
+//   quantized coefficients, DC gain 1
+// - moving average: bit exact against the mean of the last n samples
+// and the ns/sample of each kernel.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+#include "dsp/dsp_filter.h"
+
+#define DSP_LEN 4096
+#define DSP_BIQUAD_TOLERANCE 4      // Q4 LSB, 1/4 ADC count
+#define BENCH_MIN_NS 200000000LL
+
+static int16_t s_in[DSP_LEN];
+static int16_t s_out[DSP_LEN];
+static int16_t s_ref[DSP_LEN];
+
+// 12 bits sensor-like signal with spikes, like dsp_filter_selftest
+static void make_input(void){
+    for(int i = 0; i < DSP_LEN; ++i){
+        s_in[i] = 2048 + (int16_t)(bench_rand() & 0xFF) - 128 + ((i % 37) == 0 ? 1500 : 0);
+    }
+}
+
+static int16_t sat16(int64_t x){
+    return (int16_t)(x > INT16_MAX ? INT16_MAX : (x < INT16_MIN ? INT16_MIN : x));
+}
+
+// one output after every decim inputs, taps[0] on the newest input
+static int fir_reference(const DspFirDecim * fir, const int16_t * in, int n_in, int16_t * out){
+    int n_out = 0;
+    for(int i = fir->decim - 1; i < n_in; i += fir->decim){
+        int64_t acc = 1 << 14;
+        for(int k = 0; k < fir->n_taps && k <= i; ++k){
+            acc += (int32_t)fir->taps[k] * in[i - k];
+        }
+        out[n_out++] = sat16(acc >> 15);
+    }
+    return n_out;
+}
+
+typedef int (*FirFn)(DspFirDecim * fir, const int16_t * in, int n_in, int16_t * out);
+
+static int fir_blocks(FirFn fn, DspFirDecim * fir, const int16_t * in, int n_in, int16_t * out){
+    int n_out = 0;
+    int i = 0;
+    while(i < n_in){
+        int n = 1 + bench_rand() % 97;
+        if(n > n_in - i){
+            n = n_in - i;
+        }
+        n_out += fn(fir, in + i, n, out + n_out);
+        i += n;
+    }
+    return n_out;
+}
+
+static void check_fir(const char * name, FirFn fn, int n_taps, int decim){
+    static DspFirDecim fir;
+    dsp_fir_decim_init(&fir, n_taps, decim, 0.5f / decim);
+    int n_ref = fir_reference(&fir, s_in, DSP_LEN, s_ref);
+    int n_out = fir_blocks(fn, &fir, s_in, DSP_LEN, s_out);
+    int diff = -1;
+    for(int i = 0; i < n_ref && diff < 0; ++i){
+        diff = (s_out[i] != s_ref[i]) ? i : -1;
+    }
+    BENCH_CHECK(n_out == n_ref && diff < 0, "fir %s %d taps decim %d: %d of %d outputs, first difference %d",
+        name, n_taps, decim, n_out, n_ref, diff);
+
+    // DC gain 1
+    static int16_t dc[DSP_LEN];
+    for(int i = 0; i < DSP_LEN; ++i){
+        dc[i] = 2048;
+    }
+    dsp_fir_decim_init(&fir, n_taps, decim, 0.5f / decim);
+    n_out = fn(&fir, dc, DSP_LEN, s_out);
+    BENCH_CHECK(s_out[n_out - 1] == 2048, "fir %s %d taps decim %d: DC %d", name, n_taps, decim, s_out[n_out - 1]);
+}
+
+static void check_biquad(float cutoff){
+    DspBiquad bq;
+    dsp_biquad_lowpass(&bq, cutoff, 0.707f);
+    double b0 = bq.b0 / 16384.0, b1 = bq.b1 / 16384.0, b2 = bq.b2 / 16384.0;
+    double a1 = bq.a1 / 16384.0, a2 = bq.a2 / 16384.0;
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    double max_dev = 0;
+    int32_t y = 0;
+    for(int i = 0; i < DSP_LEN; ++i){
+        int32_t x = s_in[i] << 4;
+        y = dsp_biquad(&bq, x);
+        double y_ref = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y_ref;
+        if(fabs(y - y_ref) > max_dev){
+            max_dev = fabs(y - y_ref);
+        }
+    }
+    printf("biquad fc %.3f: max deviation %.2f Q4 LSB\n", cutoff, max_dev);
+    BENCH_CHECK(max_dev <= DSP_BIQUAD_TOLERANCE, "biquad fc %.3f: %.2f", cutoff, max_dev);
+
+    dsp_biquad_reset(&bq, 2048 << 4);
+    for(int i = 0; i < 1000; ++i){
+        y = dsp_biquad(&bq, 2048 << 4);
+    }
+    BENCH_CHECK(abs(y - (2048 << 4)) <= 1, "biquad fc %.3f: DC %d", cutoff, y);
+}
+
+static void check_moving_average(int n){
+    DspMovingAverage ma;
+    dsp_moving_average_init(&ma, n);
+    int diff = -1;
+    for(int i = 0; i < DSP_LEN && diff < 0; ++i){
+        int32_t y = dsp_moving_average(&ma, s_in[i] << 4);
+        int first = i + 1 < n ? 0 : i + 1 - n;
+        int32_t sum = 0;
+        for(int k = first; k <= i; ++k){
+            sum += s_in[k] << 4;
+        }
+        diff = (y != sum / (i + 1 - first)) ? i : -1;
+    }
+    BENCH_CHECK(diff < 0, "moving average %d: first difference %d", n, diff);
+}
+
+static double time_fir(const char * name, FirFn fn){
+    static DspFirDecim fir;
+    dsp_fir_decim_init(&fir, DSP_FIR_MAX_TAPS, 8, 0.5f / 8);
+    int64_t runs = 0;
+    int64_t start = bench_now_ns();
+    int64_t elapsed;
+    do {
+        fn(&fir, s_in, DSP_LEN, s_out);
+        runs++;
+        elapsed = bench_now_ns() - start;
+    } while(elapsed < BENCH_MIN_NS);
+    double ns = (double)elapsed / (runs * DSP_LEN);
+    printf("%-28s %6.2f ns/input\n", name, ns);
+    return ns;
+}
+
+static void time_biquad_average(void){
+    DspBiquad bq;
+    DspMovingAverage ma;
+    dsp_biquad_lowpass(&bq, 20.0f / 625, 0.707f);
+    dsp_moving_average_init(&ma, 8);
+    volatile int32_t sink = 0;
+    int64_t runs = 0;
+    int64_t start = bench_now_ns();
+    int64_t elapsed;
+    do {
+        for(int i = 0; i < DSP_LEN; ++i){
+            sink = dsp_biquad(&bq, s_in[i] << 4);
+        }
+        runs++;
+        elapsed = bench_now_ns() - start;
+    } while(elapsed < BENCH_MIN_NS);
+    printf("%-28s %6.2f ns/sample\n", "biquad", (double)elapsed / (runs * DSP_LEN));
+
+    runs = 0;
+    start = bench_now_ns();
+    do {
+        for(int i = 0; i < DSP_LEN; ++i){
+            sink = dsp_moving_average(&ma, s_in[i] << 4);
+        }
+        runs++;
+        elapsed = bench_now_ns() - start;
+    } while(elapsed < BENCH_MIN_NS);
+    printf("%-28s %6.2f ns/sample\n", "moving average of 8", (double)elapsed / (runs * DSP_LEN));
+    (void)sink;
+}
+
+int main(void){
+    make_input();
+
+    // the boot check of the target, on the plain C esp-dsp
+    BENCH_CHECK(dsp_filter_selftest() == 1, "esp-dsp path disabled by the selftest");
+
+    static const int taps[] = { 8, 16, 24, 32 };
+    static const int decims[] = { 1, 2, 8, 16 };
+    for(unsigned t = 0; t < sizeof(taps) / sizeof(taps[0]); ++t){
+        for(unsigned d = 0; d < sizeof(decims) / sizeof(decims[0]); ++d){
+            check_fir("scalar", dsp_fir_decim_scalar, taps[t], decims[d]);
+            check_fir("esp-dsp", dsp_fir_decim, taps[t], decims[d]);
+        }
+    }
+    // ADC_FC_HZ 5 to 50 at the decimated rate of the sampler
+    check_biquad(5.0f / 625);
+    check_biquad(20.0f / 625);
+    check_biquad(50.0f / 625);
+    check_moving_average(1);
+    check_moving_average(8);
+    check_moving_average(DSP_MA_MAX);
+
+    time_fir("fir 32 taps / 8, scalar", dsp_fir_decim_scalar);
+    time_fir("fir 32 taps / 8, esp-dsp C", dsp_fir_decim);
+    time_biquad_average();
+
+    return bench_result();
+}
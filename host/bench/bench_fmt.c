@@ -0,0 +1,111 @@
+// Checks and benchmark of common/fmt against snprintf:
+// - fmt_q16 over +-200 in q16 steps with 1 decimal (the VT strings), every
+//   7th step with 0, 2, 3 and 4 decimals, all the exact ties included
+// - width, '+' and '0' padding
+// - fmt_int on tenths
+// and the ns/call of fmt_q16 and snprintf("%.1f").
+//
+// The only difference allowed is the sign of zero: fmt prints "0.0" where
+// printf prints "-0.0".
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "common/fmt.h"
+
+#define FMT_RANGE (200 * Q16_ONE)
+#define FMT_STRIDE 61           // q16 steps of the other formats, odd: every fraction is reached
+#define BENCH_MIN_NS 200000000LL
+
+static void reference(char * out, size_t size, q16_t value, FmtSpec spec){
+    char format[16];
+    snprintf(format, sizeof(format), "%%%s%s*.*f", (spec.flags & FMT_PLUS) ? "+" : "", (spec.flags & FMT_ZERO) ? "0" : "");
+    snprintf(out, size, format, spec.width, spec.decimals, value / 65536.0);
+    if(value < 0 && strpbrk(out, "123456789") == NULL){
+        // "-0.0" of printf
+        snprintf(out, size, format, spec.width, spec.decimals, 0.0);
+    }
+}
+
+static void check_q16(FmtSpec spec, int step){
+    char out[32];
+    char ref[32];
+    int checked = 0;
+    int different = 0;
+    for(int64_t v = -FMT_RANGE; v <= FMT_RANGE; v += step){
+        FmtBuf f;
+        fmt_init(&f, out, sizeof(out));
+        fmt_q16(&f, (q16_t)v, spec);
+        reference(ref, sizeof(ref), (q16_t)v, spec);
+        if(strcmp(out, ref) != 0 && different++ == 0){
+            printf("fmt_q16 %.6f: \"%s\" instead of \"%s\"\n", v / 65536.0, out, ref);
+        }
+        checked++;
+    }
+    BENCH_CHECK(different == 0, "fmt_q16 decimals %u width %u flags %u: %d of %d values different",
+        spec.decimals, spec.width, spec.flags, different, checked);
+}
+
+static void check_int(void){
+    char out[32];
+    char ref[32];
+    int different = 0;
+    for(int32_t v = -20000; v <= 20000; ++v){
+        FmtBuf f;
+        fmt_init(&f, out, sizeof(out));
+        fmt_int(&f, v, FMT_DEC1);
+        snprintf(ref, sizeof(ref), "%s%d.%d", v < 0 ? "-" : "", abs(v) / 10, abs(v) % 10);
+        different += strcmp(out, ref) != 0;
+    }
+    BENCH_CHECK(different == 0, "fmt_int tenths: %d values different", different);
+}
+
+static void time_q16(void){
+    char out[32];
+    volatile char sink = 0;
+    int64_t runs = 0;
+    int64_t start = bench_now_ns();
+    int64_t elapsed;
+    do {
+        for(q16_t v = -FMT_RANGE; v < FMT_RANGE; v += 4099){
+            FmtBuf f;
+            fmt_init(&f, out, sizeof(out));
+            fmt_q16(&f, v, FMT_DEC1);
+            sink = out[0];
+            runs++;
+        }
+        elapsed = bench_now_ns() - start;
+    } while(elapsed < BENCH_MIN_NS);
+    printf("%-22s %6.1f ns/call\n", "fmt_q16 1 decimal", (double)elapsed / runs);
+
+    runs = 0;
+    start = bench_now_ns();
+    do {
+        for(q16_t v = -FMT_RANGE; v < FMT_RANGE; v += 4099){
+            snprintf(out, sizeof(out), "%.1f", v / 65536.0);
+            sink = out[0];
+            runs++;
+        }
+        elapsed = bench_now_ns() - start;
+    } while(elapsed < BENCH_MIN_NS);
+    printf("%-22s %6.1f ns/call\n", "snprintf %.1f", (double)elapsed / runs);
+    (void)sink;
+}
+
+int main(void){
+    check_q16(FMT_DEC1, 1);
+    check_q16(FMT_SIGNED_DEC1, FMT_STRIDE);
+    for(uint8_t d = 0; d <= FMT_MAX_DECIMALS; ++d){
+        if(d != 1){
+            check_q16(FMT_SPEC(d, 0, 0), FMT_STRIDE);
+        }
+    }
+    check_q16(FMT_SPEC(1, 7, 0), FMT_STRIDE);
+    check_q16(FMT_SPEC(2, 8, FMT_ZERO), FMT_STRIDE);
+    check_q16(FMT_SPEC(1, 7, FMT_PLUS | FMT_ZERO), FMT_STRIDE);
+    check_int();
+
+    time_q16();
+    return bench_result();
+}
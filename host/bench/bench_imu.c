@@ -0,0 +1,173 @@
+// Binary IMU decoder (lemca/imu): decoding checks, throughput and resync on
+// a corrupted stream.
+//
+//   bench_imu [capture.bin]
+//
+// Without a file the stream is generated: acceleration, gyro and angle frames
+// (0x55 0x51/0x52/0x53) of a slow roll and yaw. The corrupted copy has one
+// byte changed in 2 % of the frames and 1 to 8 bytes of noise after 1 % of
+// them. A capture of UART1 can be given instead, it is then only timed.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "imu/imu.h"
+#include "bench.h"
+
+#define BENCH_SAMPLES 20000
+#define BENCH_FRAME_SIZE 11
+#define BENCH_SLICE 64
+#define BENCH_MIN_NS 500000000LL
+
+static void put_frame(uint8_t * f, uint8_t type, int16_t a, int16_t b, int16_t c){
+    f[0] = 0x55;
+    f[1] = type;
+    f[2] = (uint8_t)a; f[3] = (uint8_t)((uint16_t)a >> 8);
+    f[4] = (uint8_t)b; f[5] = (uint8_t)((uint16_t)b >> 8);
+    f[6] = (uint8_t)c; f[7] = (uint8_t)((uint16_t)c >> 8);
+    f[8] = 0; f[9] = 0;
+    uint8_t sum = 0;
+    for(int i = 0; i < BENCH_FRAME_SIZE - 1; ++i){
+        sum += f[i];
+    }
+    f[10] = sum;
+}
+
+// sample i: the three angles and the three rates follow i, a sample with
+// different values on its three axes was not made by the generator
+static int generate(uint8_t * out, int corrupt, uint32_t * intact_angles){
+    int n = 0;
+    *intact_angles = 0;
+    for(int i = 0; i < BENCH_SAMPLES; ++i){
+        int16_t v = (int16_t)((i % 2000) - 1000);
+        uint8_t * frames = out + n;
+        put_frame(frames, 0x51, 0, 0, 2048);
+        put_frame(frames + 11, 0x52, v, v, v);
+        put_frame(frames + 22, 0x53, v, v, v);
+        n += 3 * BENCH_FRAME_SIZE;
+        int angle_ok = 1;
+        if(corrupt){
+            for(int k = 0; k < 3; ++k){
+                if(bench_rand() % 50 == 0){
+                    frames[k * 11 + bench_rand() % 11] ^= (uint8_t)(1 + bench_rand() % 255);
+                    angle_ok &= (k != 2);
+                }
+            }
+            if(bench_rand() % 100 == 0){
+                int noise = 1 + bench_rand() % 8;
+                for(int k = 0; k < noise; ++k){
+                    out[n++] = (uint8_t)bench_rand();
+                }
+            }
+        }
+        *intact_angles += angle_ok;
+    }
+    return n;
+}
+
+static void feed(const uint8_t * data, int len, int64_t now_us){
+    for(int i = 0; i < len; i += BENCH_SLICE){
+        int n = (len - i < BENCH_SLICE) ? len - i : BENCH_SLICE;
+        imu_parse(data + i, (uint32_t)n, now_us);
+    }
+}
+
+static void check_decoding(void){
+    uint8_t f[3 * BENCH_FRAME_SIZE];
+    ImuSample s;
+    put_frame(f, 0x52, 1024, -1024, 32767);
+    put_frame(f + 11, 0x53, 16384, -16384, 8192);
+    put_frame(f + 22, 0x51, 1, 2, 3);
+    imu_parse(f, sizeof(f), 1234);
+    BENCH_CHECK(imu_get_latest(&s), "no sample");
+    BENCH_CHECK(s.timestamp_us == 1234, "timestamp %lld", (long long)s.timestamp_us);
+    BENCH_CHECK(s.roll_cdeg == 9000 && s.pitch_cdeg == -9000 && s.yaw_cdeg == 4500,
+        "angles %d %d %d", s.roll_cdeg, s.pitch_cdeg, s.yaw_cdeg);
+    BENCH_CHECK(s.roll_rate_cdeg_s == 6250 && s.pitch_rate_cdeg_s == -6250 && s.yaw_rate_cdeg_s == 199993,
+        "rates %d %d %d", s.roll_rate_cdeg_s, s.pitch_rate_cdeg_s, s.yaw_rate_cdeg_s);
+}
+
+// returns the samples of the generator decoded, counts the others in *foreign
+static uint32_t run(const char * name, const uint8_t * data, int len, uint32_t * foreign){
+    ImuStats before, after;
+    ImuSample hist[IMU_HISTORY_SIZE - 1];
+    uint32_t consistent = 0;
+    *foreign = 0;
+    imu_get_stats(&before);
+    after = before;
+    // one slice holds less than IMU_HISTORY_SIZE - 1 samples
+    for(int i = 0; i < len; i += BENCH_SLICE){
+        int n = (len - i < BENCH_SLICE) ? len - i : BENCH_SLICE;
+        uint32_t samples = after.samples;
+        imu_parse(data + i, (uint32_t)n, 0);
+        imu_get_stats(&after);
+        uint32_t got = imu_get_history(hist, after.samples - samples);
+        for(uint32_t k = 0; k < got; ++k){
+            const ImuSample * h = &hist[k];
+            int ok = (h->pitch_cdeg == h->roll_cdeg) && (h->yaw_cdeg == h->roll_cdeg);
+            consistent += ok;
+            *foreign += !ok;
+        }
+    }
+    uint32_t frames = after.frames - before.frames;
+    uint32_t samples = after.samples - before.samples;
+
+    int runs = 0;
+    int64_t start = bench_now_ns();
+    int64_t elapsed;
+    do {
+        feed(data, len, 0);
+        runs++;
+        elapsed = bench_now_ns() - start;
+    } while(elapsed < BENCH_MIN_NS);
+
+    printf("%-9s %7d bytes: %u frames %u samples, resync: %u checksum errors %u skipped bytes\n", name, len,
+        frames, samples, after.checksum_errors - before.checksum_errors, after.skipped_bytes - before.skipped_bytes);
+    printf("%-9s %.2f M frames/s, %.1f MB/s, %.1f ns/frame\n", name, (double)frames * runs * 1e3 / elapsed,
+        (double)len * runs * 1e3 / elapsed, (double)elapsed / ((double)frames * runs));
+    return consistent;
+}
+
+int main(int argc, char ** argv){
+    check_decoding();
+
+    if(argc > 1){
+        FILE * f = fopen(argv[1], "rb");
+        if(f == NULL){
+            fprintf(stderr, "bench_imu: cannot read %s\n", argv[1]);
+            return 2;
+        }
+        fseek(f, 0, SEEK_END);
+        long len = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        uint8_t * data = malloc(len);
+        len = (long)fread(data, 1, len, f);
+        fclose(f);
+        uint32_t foreign;
+        run("capture", data, (int)len, &foreign);
+        free(data);
+        return bench_result();
+    }
+
+    uint8_t * data = malloc(BENCH_SAMPLES * (3 * BENCH_FRAME_SIZE + 8));
+    uint32_t intact;
+    ImuStats before, after;
+
+    int len = generate(data, 0, &intact);
+    imu_get_stats(&before);
+    uint32_t foreign;
+    uint32_t consistent = run("clean", data, len, &foreign);
+    imu_get_stats(&after);
+    BENCH_CHECK(consistent == BENCH_SAMPLES, "%u of %u samples", consistent, BENCH_SAMPLES);
+    BENCH_CHECK(after.checksum_errors == before.checksum_errors, "checksum errors on a clean stream");
+    BENCH_CHECK(after.skipped_bytes == before.skipped_bytes, "bytes skipped on a clean stream");
+
+    len = generate(data, 1, &intact);
+    consistent = run("corrupted", data, len, &foreign);
+    printf("corrupted %u of %u intact angle frames decoded, %u samples from noise\n", consistent, intact, foreign);
+    // a frame is only lost with its own corruption, or when noise forms a valid frame
+    BENCH_CHECK(consistent >= intact - intact / 1000, "%u of %u intact samples", consistent, intact);
+
+    free(data);
+    return bench_result();
+}
@@ -0,0 +1,165 @@
+// NMEA parser (lemca/nmea): decoding checks and throughput.
+//
+//   bench_nmea [log.nmea]
+//
+// Without a file the log is generated: 10 Hz GGA/RMC/VTG/HDT of a field run,
+// the altitude going below the sea level. A recorded log of the GNSS port can
+// be given instead, it is then only timed. The stream is fed in 64 byte
+// slices, like the spans of the UART ring.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmea/nmea.h"
+#include "bench.h"
+
+#define BENCH_EPOCHS 3000
+#define BENCH_SLICE 64
+#define BENCH_MIN_NS 500000000LL
+
+static int append_sentence(char * out, const char * body){
+    uint8_t cs = 0;
+    for(const char * c = body; *c; ++c){
+        cs ^= (uint8_t)*c;
+    }
+    return sprintf(out, "$%s*%02X\r\n", body, cs);
+}
+
+// epoch i at 10 Hz, 10 km/h heading north
+static int append_epoch(char * out, int i){
+    char body[96];
+    int n = 0;
+    int t_cs = 4500000 + i * 10;                 // 12:30:00.00 + i/10 s
+    int hh = t_cs / 360000, mm = (t_cs / 6000) % 60, ss = t_cs % 6000;
+    int lat_min_e5 = 4000000 + i * 150;          // 48 deg 40.00000 min + 0.28 m/epoch
+    int alt_cm = 1250 - i;                       // 12.50 m down to -17.49 m
+
+    sprintf(body, "GPGGA,%02d%02d%02d.%02d,48%02d.%05d,N,00221.12345,E,4,12,0.8,%s%d.%02d,M,46.9,M,1.0,0000",
+        hh, mm, ss / 100, ss % 100, lat_min_e5 / 100000, lat_min_e5 % 100000,
+        alt_cm < 0 ? "-" : "", abs(alt_cm) / 100, abs(alt_cm) % 100);
+    n += append_sentence(out + n, body);
+    sprintf(body, "GPRMC,%02d%02d%02d.%02d,A,48%02d.%05d,N,00221.12345,E,5.400,0.15,170626,,,R",
+        hh, mm, ss / 100, ss % 100, lat_min_e5 / 100000, lat_min_e5 % 100000);
+    n += append_sentence(out + n, body);
+    n += append_sentence(out + n, "GPVTG,0.15,T,,M,5.400,N,10.001,K,R");
+    n += append_sentence(out + n, "GPHDT,359.87,T");
+    return n;
+}
+
+static char * read_log(const char * path, long * len){
+    FILE * f = fopen(path, "rb");
+    if(f == NULL){
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char * log = malloc(*len);
+    if(fread(log, 1, *len, f) != (size_t)*len){
+        *len = 0;
+    }
+    fclose(f);
+    return log;
+}
+
+static void feed(const char * log, long len, int64_t now_us){
+    for(long i = 0; i < len; i += BENCH_SLICE){
+        long n = (len - i < BENCH_SLICE) ? len - i : BENCH_SLICE;
+        nmea_parse(log + i, (uint32_t)n, now_us);
+    }
+}
+
+static void check_decoding(void){
+    char buf[256];
+    NmeaData d;
+    NmeaStats before, after;
+
+    // southern / western hemisphere, below the sea level
+    nmea_get_stats(&before);
+    int n = append_sentence(buf, "GPGGA,123519.00,4807.03800,S,01131.00000,W,1,08,0.9,-12.345,M,-46.9,M,,");
+    nmea_parse(buf, n, 1000);
+    nmea_get_stats(&after);
+    nmea_get_data(&d);
+    BENCH_CHECK(after.sentences == before.sentences + 1, "%u sentences", after.sentences - before.sentences);
+    BENCH_CHECK(d.lat_e7 == -481173000, "lat %d", d.lat_e7);
+    BENCH_CHECK(d.lon_e7 == -115166666, "lon %d", d.lon_e7);
+    BENCH_CHECK(d.alt_mm == -12345, "alt %d mm", d.alt_mm);
+    BENCH_CHECK(d.utc_ms == 45319000, "utc %u ms", d.utc_ms);
+    BENCH_CHECK(d.hdop_x100 == 90, "hdop %u", d.hdop_x100);
+
+    n = append_sentence(buf, "GPGGA,123520.00,4807.03800,N,01131.00000,E,1,08,0.9,-0.5,M,-46.9,M,,");
+    nmea_parse(buf, n, 2000);
+    nmea_get_data(&d);
+    BENCH_CHECK(d.alt_mm == -500, "alt %d mm", d.alt_mm);
+    BENCH_CHECK(d.lat_e7 == 481173000, "lat %d", d.lat_e7);
+
+    n = append_sentence(buf, "GPVTG,0.15,T,,M,5.400,N,10.001,K,R");
+    nmea_parse(buf, n, 3000);
+    nmea_get_data(&d);
+    BENCH_CHECK(d.speed_mm_s == 2778, "speed %d mm/s", d.speed_mm_s);
+    BENCH_CHECK(d.course_cdeg == 15, "course %d", d.course_cdeg);
+
+    // corrupted checksum: the data does not change
+    n = append_sentence(buf, "GPHDT,123.45,T");
+    buf[3] = 'Q';
+    nmea_parse(buf, n, 4000);
+    nmea_get_stats(&after);
+    nmea_get_data(&d);
+    BENCH_CHECK(after.checksum_errors == before.checksum_errors + 1, "%u checksum errors",
+        after.checksum_errors - before.checksum_errors);
+    BENCH_CHECK(d.heading_us == 0, "heading at %lld us", (long long)d.heading_us);
+}
+
+int main(int argc, char ** argv){
+    check_decoding();
+
+    long len = 0;
+    char * log;
+    uint32_t expected = 0;
+    if(argc > 1){
+        log = read_log(argv[1], &len);
+        if(log == NULL || len == 0){
+            fprintf(stderr, "bench_nmea: cannot read %s\n", argv[1]);
+            return 2;
+        }
+    } else {
+        log = malloc(BENCH_EPOCHS * 4 * 96);
+        for(int i = 0; i < BENCH_EPOCHS; ++i){
+            len += append_epoch(log + len, i);
+        }
+        expected = BENCH_EPOCHS * 4;
+    }
+
+    NmeaStats before, after;
+    nmea_get_stats(&before);
+    feed(log, len, 5000);
+    nmea_get_stats(&after);
+    uint32_t sentences = after.sentences - before.sentences;
+    printf("log %ld bytes: %u sentences, %u ignored, %u checksum errors, %u framing errors\n", len, sentences,
+        after.ignored - before.ignored, after.checksum_errors - before.checksum_errors,
+        after.framing_errors - before.framing_errors);
+    if(expected > 0){
+        NmeaData d;
+        nmea_get_data(&d);
+        BENCH_CHECK(sentences == expected, "%u sentences, %u expected", sentences, expected);
+        BENCH_CHECK(after.checksum_errors == before.checksum_errors, "checksum errors");
+        BENCH_CHECK(after.framing_errors == before.framing_errors, "framing errors");
+        BENCH_CHECK(d.alt_mm == -17490, "alt %d mm", d.alt_mm);
+    }
+
+    int runs = 0;
+    int64_t start = bench_now_ns();
+    int64_t elapsed;
+    do {
+        feed(log, len, 6000);
+        runs++;
+        elapsed = bench_now_ns() - start;
+    } while(elapsed < BENCH_MIN_NS);
+    nmea_get_stats(&after);
+    double total = (double)(after.sentences + after.ignored) - (before.sentences + before.ignored) - sentences;
+    printf("%.0f sentences/s, %.1f MB/s, %.0f ns/sentence (%d runs)\n", total * 1e9 / elapsed,
+        (double)len * runs * 1e3 / elapsed, elapsed / total, runs);
+
+    free(log);
+    return bench_result();
+}
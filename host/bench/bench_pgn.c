@@ -0,0 +1,145 @@
+// PGN dispatch (lemca/pgn_dispatch): checks and ns/frame against the switch
+// that onIsobusMessage() used before the table.
+//
+// The frames are a tractor bus mix: the registered broadcasts are about one
+// frame in three, the rest is VT, TP/ETP, process data and other broadcasts
+// that the dispatch has to reject. The table is timed with the 4 PGNs of
+// isobus_message_init() and with 16, the switch only knows the first 4.
+
+#include <string.h>
+
+#include "pgn_dispatch.h"
+#include "bench.h"
+
+#define BENCH_FRAMES 4096
+#define BENCH_MIN_NS 300000000LL
+
+#define BENCH_LIGHTING 0xFE41u
+#define BENCH_REAR_HITCH 0xFE45u
+#define BENCH_WHEEL_SPEED 0xFE48u
+#define BENCH_GROUND_SPEED 0xFE49u
+
+static uint32_t s_ids[BENCH_FRAMES];
+static uint32_t s_handled = 0;
+static void on_frame(uint32_t pgn, uint8_t sa, const uint8_t * data, uint8_t dlc, int64_t rx_us){
+    (void)pgn; (void)sa; (void)data; (void)dlc; (void)rx_us;
+    s_handled++;
+}
+
+// the dispatch of onIsobusMessage() before pgn_dispatch
+__attribute__((noinline))
+static int switch_frame(uint32_t can_id, const uint8_t * data, uint8_t dlc, int64_t rx_us){
+    uint32_t pgn = (can_id & 0x03FFFF00uL) >> 8u;
+    if((pgn & 0x00FF00uL) < 0xF000uL){
+        pgn &= 0x03FF00uL;
+    }
+    switch(pgn){
+        case BENCH_LIGHTING:
+        case BENCH_REAR_HITCH:
+        case BENCH_WHEEL_SPEED:
+        case BENCH_GROUND_SPEED:
+            on_frame(pgn, (uint8_t)can_id, data, dlc, rx_us);
+            return 1;
+    }
+    return 0;
+}
+
+static uint32_t can_id(uint32_t pgn, uint8_t sa){
+    return (3u << 26) | (pgn << 8) | sa;
+}
+
+static void make_frames(void){
+    static const uint32_t tractor[] = { BENCH_LIGHTING, BENCH_REAR_HITCH, BENCH_WHEEL_SPEED, BENCH_GROUND_SPEED };
+    static const uint32_t others[] = {
+        0xE626u,    // VT to ECU, DA 0x26
+        0xE726u,    // ECU to VT
+        0xEB26u,    // TP.DT
+        0xEC26u,    // TP.CM
+        0xC726u,    // ETP.DT
+        0xCB26u,    // process data
+        0xEE00u | 0xFF, // address claimed, global
+        0xFEF1u,    // cruise control / vehicle speed
+        0xF004u,    // engine speed
+        0xFE43u,    // front hitch
+    };
+    bench_seed(2024);
+    for(int i = 0; i < BENCH_FRAMES; ++i){
+        if(bench_rand() % 3 == 0){
+            s_ids[i] = can_id(tractor[bench_rand() % 4], 0x80);
+        } else {
+            s_ids[i] = can_id(others[bench_rand() % 10], 0x26);
+        }
+    }
+}
+
+typedef int (*DispatchFn)(uint32_t can_id, const uint8_t * data, uint8_t dlc, int64_t rx_us);
+
+static double time_ns(const char * name, DispatchFn fn, uint32_t * handled){
+    static const uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 1 };
+    int64_t runs = 0;
+    int64_t start = bench_now_ns();
+    int64_t elapsed;
+    s_handled = 0;
+    do {
+        for(int i = 0; i < BENCH_FRAMES; ++i){
+            fn(s_ids[i], data, 8, 1000);
+        }
+        runs++;
+        elapsed = bench_now_ns() - start;
+    } while(elapsed < BENCH_MIN_NS);
+    double ns = (double)elapsed / (runs * BENCH_FRAMES);
+    *handled = (uint32_t)(s_handled / runs);
+    printf("%-22s %5.2f ns/frame, %u of %d frames handled\n", name, ns, *handled, BENCH_FRAMES);
+    return ns;
+}
+
+int main(void){
+    static const uint8_t data[8] = { 0 };
+    PgnDispatchStats stats;
+
+    // before the first register: the table is not initialized yet
+    BENCH_CHECK(pgn_dispatch_is_fresh(BENCH_REAR_HITCH, 0) == 0, "fresh before register");
+    BENCH_CHECK(pgn_dispatch_frame(can_id(BENCH_REAR_HITCH, 0x80), data, 8, 0) == 0, "frame before register");
+
+    pgn_dispatch_register(BENCH_LIGHTING, on_frame, 8, 3000);
+    pgn_dispatch_register(BENCH_REAR_HITCH, on_frame, 8, 300);
+    pgn_dispatch_register(BENCH_WHEEL_SPEED, on_frame, 8, 300);
+    pgn_dispatch_register(BENCH_GROUND_SPEED, on_frame, 8, 300);
+
+    // freshness and timeouts
+    BENCH_CHECK(pgn_dispatch_frame(can_id(BENCH_REAR_HITCH, 0x80), data, 8, 1000000) == 1, "hitch frame");
+    BENCH_CHECK(pgn_dispatch_frame(can_id(BENCH_WHEEL_SPEED, 0x80), data, 5, 1000000) == 0, "short frame");
+    BENCH_CHECK(pgn_dispatch_is_fresh(BENCH_REAR_HITCH, 1300000) == 1, "hitch fresh at 300 ms");
+    BENCH_CHECK(pgn_dispatch_is_fresh(BENCH_REAR_HITCH, 1300001) == 0, "hitch stale after 300 ms");
+    BENCH_CHECK(pgn_dispatch_is_fresh(BENCH_WHEEL_SPEED, 1000000) == 0, "short frame made the PGN fresh");
+    pgn_dispatch_check_timeouts(1200000);
+    pgn_dispatch_get_stats(&stats);
+    BENCH_CHECK(stats.timeouts == 0, "%u timeouts at 200 ms", stats.timeouts);
+    pgn_dispatch_check_timeouts(1400000);
+    pgn_dispatch_check_timeouts(1500000);
+    pgn_dispatch_get_stats(&stats);
+    BENCH_CHECK(stats.timeouts == 1, "%u timeouts at 500 ms", stats.timeouts);
+    BENCH_CHECK(stats.dlc_errors == 1, "%u dlc errors", stats.dlc_errors);
+    // PDU1: the destination address is not part of the PGN
+    pgn_dispatch_register(0xEF00u, on_frame, 0, 1000);
+    BENCH_CHECK(pgn_dispatch_frame(can_id(0xEF26u, 0x80), data, 8, 0) == 1, "PDU1 frame");
+
+    make_frames();
+    uint32_t handled_switch, handled_table;
+    double ns_switch = time_ns("switch, 4 PGNs", switch_frame, &handled_switch);
+    double ns_table = time_ns("table, 5 PGNs", pgn_dispatch_frame, &handled_table);
+    BENCH_CHECK(handled_switch == handled_table, "switch %u table %u frames", handled_switch, handled_table);
+
+    // the PGNs of a larger tractor interface: hitches, PTOs, valves, lighting, time, GNSS
+    static const uint32_t more[] = { 0xFE43u, 0xFE44u, 0xFE46u, 0xFE47u, 0xFE10u, 0xFE11u, 0xFE12u,
+        0xFE13u, 0xFEE6u, 0xFEF3u, 0xFEE8u };
+    for(unsigned i = 0; i < sizeof(more) / sizeof(more[0]); ++i){
+        pgn_dispatch_register(more[i], on_frame, 8, 300);
+    }
+    uint32_t handled_16;
+    double ns_16 = time_ns("table, 16 PGNs", pgn_dispatch_frame, &handled_16);
+    BENCH_CHECK(handled_16 > handled_table, "%u frames with 16 PGNs", handled_16);
+    printf("table / switch %.2f, 16 / 5 PGNs %.2f\n", ns_table / ns_switch, ns_16 / ns_table);
+
+    return bench_result();
+}
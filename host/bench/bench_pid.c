@@ -0,0 +1,197 @@
+// Checks and benchmark of control/pid: pid_step against a double reference of
+// the same controller over error sequences, and the cost of a step.
+//
+//   bench_pid [trace.csv]
+//
+// The sequences are a row step, random errors saturating the output (anti-
+// windup) and a slow sine; with a trace of lemca_host -o the recorded angle and
+// height errors are run too. The Q16 code is not bit exact (products rounded to
+// Q16, dt to 2^-24 s), the outputs must stay within PID_TOLERANCE_PCT of the
+// reference.
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "control/pid.h"
+#include "control_task.h"
+
+#define PID_TOLERANCE_PCT 0.005
+#define PID_SEQUENCE 100000
+#define BENCH_MIN_NS 200000000LL
+
+// the controller of pid.c in double, dt not rounded
+typedef struct {
+    double kp, ki, kd, kaw, d_alpha, i_max, out_min, out_max, dt;
+    double integral, d_filtered, prev_error;
+    int started;
+} RefPid;
+
+static double clamp(double x, double min, double max){
+    return x > max ? max : (x < min ? min : x);
+}
+
+static double q16_to_double(q16_t x){
+    return x / 65536.0;
+}
+
+static double ref_step(RefPid * pid, double error, double scale){
+    double kp = pid->kp * scale;
+    double ki = pid->ki * scale;
+    double kd = pid->kd * scale;
+    pid->integral = clamp(pid->integral + error * pid->dt, -pid->i_max, pid->i_max);
+    if(kd != 0){
+        double d_raw = pid->started ? (error - pid->prev_error) / pid->dt : 0;
+        pid->d_filtered += pid->d_alpha * (d_raw - pid->d_filtered);
+    }
+    pid->prev_error = error;
+    pid->started = 1;
+    double out = kp * error + ki * pid->integral + kd * pid->d_filtered;
+    double out_sat = clamp(out, pid->out_min, pid->out_max);
+    if(out_sat != out && pid->kaw != 0 && ki != 0){
+        double excess = pid->kaw * (out_sat - out) * pid->dt;
+        pid->integral = clamp(pid->integral + excess / ki, -pid->i_max, pid->i_max);
+    }
+    return out_sat;
+}
+
+// the tuning of lemca.c updatePidConfig: kp = agress/20, ki = kp/5
+static void configure(Pid * pid, RefPid * ref, int agress, int max_out){
+    pid_init(pid, CONTROL_PERIOD_US);
+    pid->kp = Q16_FROM_RATIO(agress, 20);
+    pid->ki = pid->kp / 5;
+    pid->kaw = Q16_FROM_RATIO(1, 5);
+    pid->i_max = Q16_FROM_INT(10);
+    pid->out_min = -Q16_FROM_INT(max_out);
+    pid->out_max = Q16_FROM_INT(max_out);
+
+    memset(ref, 0, sizeof(*ref));
+    ref->kp = q16_to_double(pid->kp);
+    ref->ki = q16_to_double(pid->ki);
+    ref->kaw = q16_to_double(pid->kaw);
+    ref->d_alpha = 1;
+    ref->i_max = 10;
+    ref->out_min = -max_out;
+    ref->out_max = max_out;
+    ref->dt = CONTROL_PERIOD_US / 1000000.0;
+}
+
+// max deviation of the outputs in %, over a sequence in Q16
+static double compare(const char * name, const q16_t * errors, int n, int agress, q16_t scale){
+    Pid pid;
+    RefPid ref;
+    configure(&pid, &ref, agress, 100);
+    double max_dev = 0;
+    int saturated = 0;
+    for(int i = 0; i < n; ++i){
+        double out = q16_to_double(pid_step(&pid, errors[i], scale));
+        double out_ref = ref_step(&ref, q16_to_double(errors[i]), q16_to_double(scale));
+        double dev = fabs(out - out_ref);
+        if(dev > max_dev){
+            max_dev = dev;
+        }
+        saturated += fabs(out_ref) >= 100;
+    }
+    printf("%-26s %6d steps, %5.1f %% saturated, max deviation %.5f %%\n", name, n, 100.0 * saturated / n, max_dev);
+    BENCH_CHECK(max_dev <= PID_TOLERANCE_PCT, "%s: %.5f %%", name, max_dev);
+    return max_dev;
+}
+
+static void check_sequences(q16_t * errors){
+    // the row 40 % off, then back in 1.5 s
+    for(int i = 0; i < PID_SEQUENCE; ++i){
+        int t = i % 500;
+        errors[i] = t < 75 ? Q16_FROM_RATIO(40 * (75 - t), 75) : 0;
+    }
+    compare("row steps, agress 100", errors, PID_SEQUENCE, 100, Q16_ONE);
+    compare("row steps, x0.6 at speed", errors, PID_SEQUENCE, 100, Q16_FROM_RATIO(6, 10));
+
+    for(int i = 0; i < PID_SEQUENCE; ++i){
+        errors[i] = (q16_t)(bench_rand() % (200 * 65536)) - 100 * 65536;
+    }
+    compare("random, agress 100", errors, PID_SEQUENCE, 100, Q16_ONE);
+    compare("random, agress 20", errors, PID_SEQUENCE, 20, Q16_ONE);
+
+    for(int i = 0; i < PID_SEQUENCE; ++i){
+        errors[i] = (q16_t)lrint(65536.0 * 8 * sin(i * 0.01));
+    }
+    compare("sine 8 %, agress 100", errors, PID_SEQUENCE, 100, Q16_ONE);
+}
+
+// columns error_ang and error_h of the lemca_host trace
+static int read_trace(const char * path, q16_t * ang, q16_t * h, int max){
+    FILE * f = fopen(path, "r");
+    if(f == NULL){
+        return -1;
+    }
+    char line[128];
+    int n = 0;
+    while(n < max && fgets(line, sizeof(line), f) != NULL){
+        double t_s, error_ang, error_h;
+        if(sscanf(line, "%lf,%lf,%lf", &t_s, &error_ang, &error_h) == 3){
+            ang[n] = (q16_t)lrint(error_ang * 65536);
+            h[n] = (q16_t)lrint(error_h * 65536);
+            n++;
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+static uint64_t cycles(void){
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void time_step(const q16_t * errors){
+    Pid pid;
+    RefPid ref;
+    configure(&pid, &ref, 100, 100);
+    volatile q16_t sink = 0;
+    int64_t runs = 0;
+    int64_t start = bench_now_ns();
+    uint64_t start_cycles = cycles();
+    int64_t elapsed;
+    do {
+        for(int i = 0; i < PID_SEQUENCE; ++i){
+            sink = pid_step(&pid, errors[i], Q16_ONE);
+        }
+        runs++;
+        elapsed = bench_now_ns() - start;
+    } while(elapsed < BENCH_MIN_NS);
+    uint64_t n = (uint64_t)runs * PID_SEQUENCE;
+    (void)sink;
+    printf("pid_step %.2f ns/step", (double)elapsed / n);
+    if(cycles() != 0){
+        printf(", %.1f TSC cycles/step", (double)(cycles() - start_cycles) / n);
+    }
+    printf("\n");
+}
+
+int main(int argc, char ** argv){
+    static q16_t errors[PID_SEQUENCE];
+    static q16_t errors_h[PID_SEQUENCE];
+
+    check_sequences(errors);
+    if(argc > 1){
+        int n = read_trace(argv[1], errors, errors_h, PID_SEQUENCE);
+        if(n <= 0){
+            fprintf(stderr, "bench_pid: cannot read %s\n", argv[1]);
+            return 1;
+        }
+        compare("trace, angle", errors, n, 100, Q16_ONE);
+        compare("trace, height", errors_h, n, 100, Q16_ONE);
+    }
+
+    // the random sequence of check_sequences: both signs, mostly saturated
+    for(int i = 0; i < PID_SEQUENCE; ++i){
+        errors[i] = (q16_t)(bench_rand() % (200 * 65536)) - 100 * 65536;
+    }
+    time_step(errors);
+
+    return bench_result();
+}
@@ -0,0 +1,16 @@
+#ifndef HOST_DRIVER_ADC_H_
+#define HOST_DRIVER_ADC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum { ADC_UNIT_1 = 1, ADC_UNIT_2 = 2 } adc_unit_t;
+typedef enum { ADC_ATTEN_DB_0 = 0, ADC_ATTEN_DB_11 = 3 } adc_atten_t;
+typedef enum { ADC_WIDTH_BIT_12 = 3 } adc_bits_width_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
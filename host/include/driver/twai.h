@@ -0,0 +1,35 @@
+#ifndef HOST_DRIVER_TWAI_H_
+#define HOST_DRIVER_TWAI_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// frame type of onIsobusMessage(), the host CAN driver has no controller
+
+#define TWAI_MSG_FLAG_EXTD 0x01
+
+typedef struct {
+    union {
+        struct {
+            uint32_t extd: 1;
+            uint32_t rtr: 1;
+            uint32_t ss: 1;
+            uint32_t self: 1;
+            uint32_t dlc_non_comp: 1;
+            uint32_t reserved: 27;
+        };
+        uint32_t flags;
+    };
+    uint32_t identifier;
+    uint8_t data_length_code;
+    uint8_t data[8];
+} twai_message_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
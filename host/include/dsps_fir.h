@@ -0,0 +1,36 @@
+#ifndef HOST_DSPS_FIR_H_
+#define HOST_DSPS_FIR_H_
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the s16 decimator of esp-dsp used by dsp/dsp_filter.c with
+// CONFIG_LEMCA_ESP_DSP, see esp_host.c
+typedef struct {
+    int16_t * coeffs;
+    int16_t * delay;
+    int16_t coeffs_len;
+    int16_t pos;
+    int16_t decim;
+    int16_t d_pos;
+    int16_t shift;
+    int32_t * rounding_buff;
+    int32_t rounding_val;
+    int16_t free_status;
+} fir_s16_t;
+
+esp_err_t dsps_fird_init_s16(fir_s16_t * fir, int16_t * coeffs, int16_t * delay, int16_t coeffs_len, int16_t decim,
+    int16_t start_pos, int16_t shift);
+// len outputs from len * decim inputs, returns len
+int32_t dsps_fird_s16(fir_s16_t * fir, const int16_t * input, int16_t * output, int32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
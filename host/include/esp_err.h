@@ -0,0 +1,33 @@
+#ifndef HOST_ESP_ERR_H_
+#define HOST_ESP_ERR_H_
+
+// host stand-in, only what the portable sources use
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+const char * esp_err_to_name(esp_err_t code);
+
+#define ESP_ERROR_CHECK(x) do { \
+        esp_err_t err_rc_ = (x); \
+        if(err_rc_ != ESP_OK){ \
+            fprintf(stderr, "ESP_ERROR_CHECK failed: %s %s:%d\n", esp_err_to_name(err_rc_), __FILE__, __LINE__); \
+            abort(); \
+        } \
+    } while(0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
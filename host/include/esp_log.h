@@ -0,0 +1,23 @@
+#ifndef HOST_ESP_LOG_H_
+#define HOST_ESP_LOG_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// milliseconds since the start of the process, clock of hw_GetTimeMs()
+uint32_t esp_log_timestamp(void);
+
+#define ESP_LOGE(tag, format, ...) printf("E (%u) %s: " format "\n", esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) printf("W (%u) %s: " format "\n", esp_log_timestamp(), tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) do { } while(0)
+#define ESP_LOGD(tag, format, ...) do { } while(0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_HAL_CPU_HAL_H_
+#define HOST_HAL_CPU_HAL_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// nanoseconds of the monotonic clock: only differences are used
+uint32_t cpu_hal_get_cycle_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
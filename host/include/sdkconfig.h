@@ -0,0 +1,8 @@
+#ifndef HOST_SDKCONFIG_H_
+#define HOST_SDKCONFIG_H_
+
+// host build: the defaults of components/lemca/Kconfig.projbuild, no esp-dsp
+// (bench_dsp defines CONFIG_LEMCA_ESP_DSP itself)
+#define CONFIG_LEMCA_CONTROL_RATE_HZ 50
+
+#endif
@@ -0,0 +1,161 @@
+/* ************************************************************************ */
+/*!
+   \file
+   \brief      Host CAN driver: AppHW CAN functions on the virtual bus (vcan.h)
+*/
+/* ************************************************************************ */
+
+#include <string.h>
+
+#include "AppCommon/AppHW.h"
+#include "driver/twai.h"
+#include "lemca/isobus_message.h"
+#include "vcan.h"
+
+/* ************************************************************************ */
+
+#define CAN_HOST_TX_QUEUE_LEN   150     /* same as the ESP driver */
+
+/* TX queue of the controller: the frames go on the virtual bus one after the
+   other at VCAN_BITRATE, stamped with the end of their transmission. The
+   queue is drained by the hw_Can calls of the loops; the frames of the other
+   nodes are not arbitrated. */
+typedef struct
+{
+   uint32_t id_u32;
+   uint8_t  dlc_u8;
+   uint8_t  data_au8[8];
+   int64_t  queued_us;
+} CanHostTxFrame_t;
+
+static CanHostTxFrame_t s_tx_as[CAN_HOST_TX_QUEUE_LEN];
+static uint32_t s_txHead_u32 = 0u;
+static uint32_t s_txCount_u32 = 0u;
+static int64_t  s_busFree_us = 0;
+
+static int      s_node = -1;
+static uint8_t  s_filterSa_u8 = 0xFEu;
+static uint32_t s_filterReloads_u32 = 0u;
+
+/* sends the frames of the TX queue whose transmission ended before now */
+static void CanHost_TxDrain(void)
+{
+   int64_t now_us = hw_GetTimeUs();
+   while (s_txCount_u32 > 0u)
+   {
+      const CanHostTxFrame_t *frame_ps = &s_tx_as[s_txHead_u32];
+      int64_t start_us = (frame_ps->queued_us > s_busFree_us) ? frame_ps->queued_us : s_busFree_us;
+      int64_t end_us = start_us + (int64_t)vcan_frame_bits(frame_ps->dlc_u8) * 1000000 / VCAN_BITRATE;
+      if (end_us > now_us)
+      {
+         break;
+      }
+      (void)vcan_send_at(s_node, frame_ps->id_u32, frame_ps->data_au8, frame_ps->dlc_u8, end_us);
+      s_busFree_us = end_us;
+      s_txHead_u32 = (s_txHead_u32 + 1u) % CAN_HOST_TX_QUEUE_LEN;
+      s_txCount_u32--;
+   }
+}
+
+/* ################### CAN Functions ################ */
+
+void hw_CanInit(uint8_t maxCanNodes_u8)
+{
+   (void)maxCanNodes_u8;
+   if (s_node < 0)
+   {
+      s_node = vcan_open("ecu");
+   }
+}
+
+void hw_CanClose(void)
+{
+}
+
+int16_t hw_CanSendMsg(uint8_t canNode_u8, uint32_t canId_u32, const uint8_t canData_au8[], uint8_t canDataLength_u8)
+{
+   (void)canNode_u8;
+   if (s_node < 0)
+   {
+      return -9;  /* E_COM -> Bus off*/
+   }
+   CanHost_TxDrain();
+   /* same checks as the ESP driver */
+   if ((s_txCount_u32 == CAN_HOST_TX_QUEUE_LEN)
+      || (CAN_IS_BULK_FRAME(canId_u32) && (s_txCount_u32 >= CAN_TX_BULK_MAX)))
+   {
+      return -6; /* E_OVERFLOW */
+   }
+
+   CanHostTxFrame_t *frame_ps = &s_tx_as[(s_txHead_u32 + s_txCount_u32) % CAN_HOST_TX_QUEUE_LEN];
+   frame_ps->id_u32 = canId_u32;
+   frame_ps->dlc_u8 = (canDataLength_u8 > 8u) ? 8u : canDataLength_u8;
+   memset(frame_ps->data_au8, 0xFF, sizeof(frame_ps->data_au8));
+   memcpy(frame_ps->data_au8, canData_au8, frame_ps->dlc_u8);
+   frame_ps->queued_us = hw_GetTimeUs();
+   s_txCount_u32++;
+   return 0;
+}
+
+int16_t hw_CanReadMsg(uint8_t canNode_u8, uint32_t *canId_pu32, uint8_t canData_pau8[], uint8_t *canDataLength_pu8)
+{
+   VcanFrame frame;
+   twai_message_t twai_msg_read;
+
+   CanHost_TxDrain();
+   if (vcan_receive(s_node, &frame) == 0)
+   {
+      return 0;
+   }
+
+   memset(&twai_msg_read, 0, sizeof(twai_msg_read));
+   twai_msg_read.flags = TWAI_MSG_FLAG_EXTD;
+   twai_msg_read.identifier = frame.id;
+   twai_msg_read.data_length_code = frame.dlc;
+   memcpy(twai_msg_read.data, frame.data, sizeof(twai_msg_read.data));
+   onIsobusMessage(canNode_u8, &twai_msg_read, 1u, frame.timestamp_us);
+
+   *canId_pu32 = frame.id;
+   *canDataLength_pu8 = frame.dlc;
+   memcpy(canData_pau8, frame.data, frame.dlc);
+   return 1;
+}
+
+int16_t hw_CanGetFreeSendMsgBufferSize(uint8_t canNode_u8)
+{
+   (void)canNode_u8;
+   CanHost_TxDrain();
+   return (int16_t)(CAN_HOST_TX_QUEUE_LEN - s_txCount_u32);
+}
+
+void hw_CanGetRxStats(CanRxStats_t* stats_ps)
+{
+   VcanStats stats;
+   vcan_get_stats(s_node, &stats);
+
+   memset(stats_ps, 0, sizeof(*stats_ps));
+   stats_ps->received_u32 = stats.received;
+   stats_ps->ringDropped_u32 = stats.dropped;
+   stats_ps->ringHighWater_u32 = stats.high_water;
+   stats_ps->filterReloads_u32 = s_filterReloads_u32;
+}
+
+void hw_CanPrintRxStats(void)
+{
+   CanRxStats_t stats;
+   hw_CanGetRxStats(&stats);
+   hw_DebugPrint("*** can rx %u ring dropped %u high water %u/%u filter SA %02X, %u reloads\n",
+      stats.received_u32, stats.ringDropped_u32, stats.ringHighWater_u32, VCAN_RX_RING_SIZE,
+      s_filterSa_u8, stats.filterReloads_u32);
+}
+
+/* no acceptance filter on the virtual bus, the SA is only recorded,
+   kept at logout like the ESP driver */
+void hw_CanFilterUpdate(uint8_t sa_u8)
+{
+   if ((sa_u8 != s_filterSa_u8) && (sa_u8 != 0xFEu))
+   {
+      s_filterSa_u8 = sa_u8;
+      s_filterReloads_u32++;
+   }
+}
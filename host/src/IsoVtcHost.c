@@ -0,0 +1,254 @@
+#include "IsoVtcHost.h"
+
+#include <string.h>
+
+#include "IsoDef.h"
+#include "IsoVtcApi.h"
+
+#include "AppCommon/AppHW.h"
+#include "lemca/vt/vt_shadow.h"
+
+#define VT_HOST_STRING_MAX 64
+#define VT_HOST_SCALING 10000u      // factor * 10000, no scaling
+
+#define VT_CMD_NUMERIC_VALUE 0xA8u
+#define VT_CMD_STRING_VALUE 0xB3u
+
+typedef struct {
+    uint16_t id;
+    uint8_t has_numeric;
+    uint8_t has_string;
+    uint32_t numeric;
+    char string[VT_HOST_STRING_MAX];
+} VtHostObject;
+
+typedef struct {
+    uint16_t id;
+    int16_t error;
+    uint8_t sent;           // the last frame of the command is in the CAN driver
+    int32_t due_ms;
+} VtHostResponse;
+
+typedef struct {
+    uint32_t can_id;
+    uint8_t data[8];
+    uint8_t last;           // last frame of a command
+} VtHostFrame;
+
+static VtHostObject s_objects[VT_HOST_MAX_OBJECTS];
+static int s_num_objects = 0;
+static VtHostStats s_stats;
+// in command order, the VT answers one after the other
+static VtHostResponse s_responses[VT_HOST_MAX_OBJECTS];
+static int s_num_responses = 0;
+// frames refused by the CAN driver, sent again by vt_host_poll() like the
+// transport protocol of the stack
+static VtHostFrame s_frames[VT_HOST_TX_FRAMES];
+static int s_num_frames = 0;
+
+static VtHostObject * vt_host_object(uint16_t id, int create){
+    for(int i = 0; i < s_num_objects; ++i){
+        if(s_objects[i].id == id){
+            return &s_objects[i];
+        }
+    }
+    if(!create || s_num_objects == VT_HOST_MAX_OBJECTS){
+        return NULL;
+    }
+    VtHostObject * o = &s_objects[s_num_objects++];
+    memset(o, 0, sizeof(*o));
+    o->id = id;
+    return o;
+}
+
+static uint32_t vt_host_can_id(uint32_t pgn, uint8_t da){
+    return (7u << 26) | (pgn << 8) | ((uint32_t)da << 8) | VT_HOST_SA;
+}
+
+static void vt_host_flush(void){
+    int n = 0;
+    while(n < s_num_frames && hw_CanSendMsg(ISO_CAN_VT, s_frames[n].can_id, s_frames[n].data, 8) == 0){
+        if(s_frames[n].last){
+            for(int i = 0; i < s_num_responses; ++i){
+                if(!s_responses[i].sent){
+                    s_responses[i].sent = 1;
+                    s_responses[i].due_ms = hw_GetTimeMs() + VT_HOST_RESPONSE_MS;
+                    break;
+                }
+            }
+        }
+        n++;
+    }
+    memmove(s_frames, &s_frames[n], (s_num_frames - n) * sizeof(s_frames[0]));
+    s_num_frames -= n;
+}
+
+static int vt_host_frames(uint32_t len){
+    return len <= 8 ? 1 : 1 + (int)((len + 6) / 7);
+}
+
+static void vt_host_push(uint32_t pgn, const uint8_t * data, uint32_t n, uint8_t last){
+    VtHostFrame * f = &s_frames[s_num_frames++];
+    f->can_id = vt_host_can_id(pgn, VT_HOST_VT_SA);
+    memset(f->data, 0xFF, sizeof(f->data));
+    memcpy(f->data, data, n);
+    f->last = last;
+    s_stats.frames++;
+}
+
+// ECU to VT message, by TP above 8 bytes (the CTS of the VT is not simulated),
+// the room for its frames was checked by the caller
+static void vt_host_send(const uint8_t * msg, uint32_t len){
+    uint8_t frame[8];
+    if(len <= 8){
+        vt_host_push(PGN_ECUtoVT, msg, len, 1);
+        vt_host_flush();
+        return;
+    }
+    uint8_t packets = (uint8_t)((len + 6) / 7);
+    frame[0] = 16;  // RTS
+    frame[1] = (uint8_t)len;
+    frame[2] = (uint8_t)(len >> 8);
+    frame[3] = packets;
+    frame[4] = 0xFF;
+    frame[5] = (uint8_t)PGN_ECUtoVT;
+    frame[6] = (uint8_t)(PGN_ECUtoVT >> 8);
+    frame[7] = (uint8_t)(PGN_ECUtoVT >> 16);
+    vt_host_push(PGN_TP_CM, frame, 8, 0);
+    for(uint8_t p = 0; p < packets; ++p){
+        uint32_t offset = (uint32_t)p * 7;
+        uint32_t n = (len - offset) > 7 ? 7 : len - offset;
+        frame[0] = p + 1;
+        memcpy(&frame[1], &msg[offset], n);
+        vt_host_push(PGN_TP_DT, frame, 1 + n, p + 1 == packets);
+    }
+    vt_host_flush();
+}
+
+static void vt_host_respond(uint16_t id){
+    if(s_num_responses == VT_HOST_MAX_OBJECTS){
+        return;
+    }
+    VtHostResponse * r = &s_responses[s_num_responses++];
+    r->id = id;
+    r->error = E_NO_ERR;
+    r->sent = 0;
+    r->due_ms = 0;
+}
+
+void vt_host_poll(int32_t now_ms){
+    vt_host_flush();
+    int n = 0;
+    while(n < s_num_responses && s_responses[n].sent && (int32_t)(now_ms - s_responses[n].due_ms) >= 0){
+        vt_shadow_response(s_responses[n].id, s_responses[n].error);
+        n++;
+    }
+    memmove(s_responses, &s_responses[n], (s_num_responses - n) * sizeof(s_responses[0]));
+    s_num_responses -= n;
+}
+
+void vt_host_get_stats(VtHostStats * stats){
+    *stats = s_stats;
+}
+
+void vt_host_reset_stats(void){
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+int vt_host_get_numeric(uint16_t object_id, uint32_t * value){
+    const VtHostObject * o = vt_host_object(object_id, 0);
+    if(o == NULL || !o->has_numeric){
+        return 0;
+    }
+    *value = o->numeric;
+    return 1;
+}
+
+const char * vt_host_get_string(uint16_t object_id){
+    const VtHostObject * o = vt_host_object(object_id, 0);
+    return (o != NULL && o->has_string) ? o->string : NULL;
+}
+
+/* ************************************************************************ */
+/* IsoVtcApi.h */
+
+iso_s16 IsoVtcCmd_NumericValue(iso_u8 u8Instance, iso_u16 u16ObjId, iso_u32 u32NewValue){
+    (void)u8Instance;
+    if(s_num_frames + 1 > VT_HOST_TX_FRAMES || s_num_responses == VT_HOST_MAX_OBJECTS){
+        return E_OVERFLOW;
+    }
+    VtHostObject * o = vt_host_object(u16ObjId, 1);
+    if(o != NULL){
+        if(o->has_numeric && o->numeric == u32NewValue){
+            s_stats.unchanged++;
+        }
+        o->has_numeric = 1;
+        o->numeric = u32NewValue;
+    }
+    uint8_t msg[8] = { VT_CMD_NUMERIC_VALUE, (uint8_t)u16ObjId, (uint8_t)(u16ObjId >> 8), 0xFF,
+        (uint8_t)u32NewValue, (uint8_t)(u32NewValue >> 8), (uint8_t)(u32NewValue >> 16), (uint8_t)(u32NewValue >> 24) };
+    vt_host_respond(u16ObjId);
+    vt_host_send(msg, sizeof(msg));
+    s_stats.commands++;
+    s_stats.numerics++;
+    s_stats.bytes += sizeof(msg);
+    return E_NO_ERR;
+}
+
+iso_s16 IsoVtcCmd_String(iso_u8 u8Instance, iso_u16 u16ObjId, const iso_u8 pau8String[]){
+    (void)u8Instance;
+    uint32_t len = (uint32_t)strlen((const char *)pau8String);
+    if(len > VT_HOST_STRING_MAX){
+        len = VT_HOST_STRING_MAX;
+    }
+    if(s_num_frames + vt_host_frames(5 + len) > VT_HOST_TX_FRAMES || s_num_responses == VT_HOST_MAX_OBJECTS){
+        return E_OVERFLOW;
+    }
+    VtHostObject * o = vt_host_object(u16ObjId, 1);
+    if(o != NULL){
+        if(o->has_string && strncmp(o->string, (const char *)pau8String, VT_HOST_STRING_MAX - 1) == 0){
+            s_stats.unchanged++;
+        }
+        o->has_string = 1;
+        strncpy(o->string, (const char *)pau8String, VT_HOST_STRING_MAX - 1);
+        o->string[VT_HOST_STRING_MAX - 1] = 0;
+    }
+    uint8_t msg[5 + VT_HOST_STRING_MAX];
+    msg[0] = VT_CMD_STRING_VALUE;
+    msg[1] = (uint8_t)u16ObjId;
+    msg[2] = (uint8_t)(u16ObjId >> 8);
+    msg[3] = (uint8_t)len;
+    msg[4] = (uint8_t)(len >> 8);
+    memcpy(&msg[5], pau8String, len);
+    vt_host_respond(u16ObjId);
+    vt_host_send(msg, 5 + len);
+    s_stats.commands++;
+    s_stats.strings++;
+    s_stats.bytes += 5 + len;
+    return E_NO_ERR;
+}
+
+iso_u16 IsoVtcGetStatusInfo(iso_u8 u8Instance, ISOVT_STATUS_e eVTInfo){
+    (void)u8Instance;
+    return (eVTInfo == VT_VERSIONNR) ? VT_V4_SE_UT3 : 0u;
+}
+
+iso_u32 IsoVtcPoolReadInfo(iso_u8 u8Instance, ISOPOOLINFO_e ePoolReading){
+    (void)u8Instance;
+    (void)ePoolReading;
+    return VT_HOST_SCALING;
+}
+
+iso_s16 IsoVtcPoolSetIDRangeMode(iso_u8 u8Instance, iso_u16 wStartId, iso_u16 wEndId, iso_u16 rwManipulValue, ISOPOOLMANIMODE_e eModeMani){
+    (void)u8Instance;
+    (void)wStartId;
+    (void)wEndId;
+    (void)rwManipulValue;
+    (void)eModeMani;
+    return E_NO_ERR;
+}
+
+// the pool is not parsed on the host: any non empty pool counts as one object
+iso_u16 IsoVtcGetNumofPoolObjs(const iso_u8 HUGE_C pbFlashAct[], iso_s32 lSize){
+    return (pbFlashAct != NULL && lSize > 0) ? 1u : 0u;
+}
@@ -0,0 +1,49 @@
+#ifndef HOST_ISO_VTC_HOST_H_
+#define HOST_ISO_VTC_HOST_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// VT client calls of the application, recorded instead of going through the
+// ISOBUS stack (prebuilt for the Xtensa only). Each command is also put on
+// the virtual bus as the frames the stack would send: one ECU to VT frame,
+// or a TP.CM RTS and the TP.DT frames above 8 bytes. The frames refused by
+// the CAN driver wait in the stub, a command without room for its frames
+// returns E_OVERFLOW like a full command FIFO of the stack.
+// The VT answers each value command after VT_HOST_RESPONSE_MS: vt_host_poll()
+// hands the responses to vt_shadow like CbVtMessages of App_VTClient.c, the
+// delay runs from the last frame of the command.
+
+#define VT_HOST_MAX_OBJECTS 64
+#define VT_HOST_SA 0x8Cu        // SA_PREFERRED of App_Base.c
+#define VT_HOST_VT_SA 0x26u
+#define VT_HOST_RESPONSE_MS 20
+#define VT_HOST_TX_FRAMES 64
+
+typedef struct {
+    uint32_t commands;
+    uint32_t strings;
+    uint32_t numerics;
+    uint32_t unchanged;     // commands giving an object the value it already had
+    uint32_t frames;        // CAN frames of the commands
+    uint32_t bytes;         // command payload bytes
+} VtHostStats;
+
+// frames refused by the CAN driver and responses due at now_ms, every loop
+// before lemca_loop()
+void vt_host_poll(int32_t now_ms);
+
+void vt_host_get_stats(VtHostStats * stats);
+void vt_host_reset_stats(void);
+// last value sent to the object, 0 when it never received one
+int vt_host_get_numeric(uint16_t object_id, uint32_t * value);
+const char * vt_host_get_string(uint16_t object_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
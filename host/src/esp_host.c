@@ -0,0 +1,109 @@
+// POSIX implementation of the few ESP-IDF calls of the portable sources
+
+#include <time.h>
+
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_adc_cal.h"
+#include "dsps_fir.h"
+#include "hal/cpu_hal.h"
+#include "driver/ledc.h"
+
+#define HOST_ADC_FULL_SCALE_MV 3100
+
+static int64_t host_monotonic_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// the ESP timers start at boot, these ones at the first call
+static int64_t host_uptime_ns(void){
+    static int64_t s_start_ns = 0;
+    int64_t now = host_monotonic_ns();
+    if(s_start_ns == 0){
+        s_start_ns = now;
+    }
+    return now - s_start_ns;
+}
+
+int64_t esp_timer_get_time(void){
+    return host_uptime_ns() / 1000;
+}
+
+uint32_t esp_log_timestamp(void){
+    return (uint32_t)(host_uptime_ns() / 1000000);
+}
+
+uint32_t cpu_hal_get_cycle_count(void){
+    return (uint32_t)host_monotonic_ns();
+}
+
+const char * esp_err_to_name(esp_err_t code){
+    return code == ESP_OK ? "ESP_OK" : "ESP_FAIL";
+}
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t adc_num, adc_atten_t atten, adc_bits_width_t bit_width,
+    uint32_t default_vref, esp_adc_cal_characteristics_t * chars){
+    chars->adc_num = adc_num;
+    chars->atten = atten;
+    chars->bit_width = bit_width;
+    chars->vref = default_vref;
+    return ESP_ADC_CAL_VAL_EFUSE_TP;
+}
+
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t adc_reading, const esp_adc_cal_characteristics_t * chars){
+    (void)chars;
+    return adc_reading * HOST_ADC_FULL_SCALE_MV / 4095;
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t * timer_conf){
+    (void)timer_conf;
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t * ledc_conf){
+    (void)ledc_conf;
+    return ESP_OK;
+}
+
+// esp-dsp s16 decimator in plain C: circular delay line, coeffs[0] on the
+// oldest sample, acc >> (15 - shift) rounded to nearest. Only the calls of
+// dsp_filter.c are covered; the PIE kernel of the esp32s3 is checked against
+// the scalar FIR at boot (dsp_filter_selftest).
+esp_err_t dsps_fird_init_s16(fir_s16_t * fir, int16_t * coeffs, int16_t * delay, int16_t coeffs_len, int16_t decim,
+    int16_t start_pos, int16_t shift){
+    fir->coeffs = coeffs;
+    fir->delay = delay;
+    fir->coeffs_len = coeffs_len;
+    fir->pos = 0;
+    fir->decim = decim;
+    fir->d_pos = start_pos;
+    fir->shift = shift;
+    fir->rounding_buff = NULL;
+    fir->rounding_val = 1 << (14 - shift);
+    fir->free_status = 0;
+    for(int i = 0; i < coeffs_len; ++i){
+        delay[i] = 0;
+    }
+    return ESP_OK;
+}
+
+int32_t dsps_fird_s16(fir_s16_t * fir, const int16_t * input, int16_t * output, int32_t len){
+    for(int32_t i = 0; i < len; ++i){
+        for(int j = 0; j < fir->decim; ++j){
+            fir->delay[fir->pos] = *input++;
+            fir->pos = (fir->pos + 1 == fir->coeffs_len) ? 0 : fir->pos + 1;
+        }
+        int64_t acc = fir->rounding_val;
+        int p = fir->pos;
+        for(int k = 0; k < fir->coeffs_len; ++k){
+            acc += (int32_t)fir->coeffs[k] * fir->delay[p];
+            p = (p + 1 == fir->coeffs_len) ? 0 : p + 1;
+        }
+        acc >>= 15 - fir->shift;
+        output[i] = (int16_t)(acc > INT16_MAX ? INT16_MAX : (acc < INT16_MIN ? INT16_MIN : acc));
+    }
+    return len;
+}
@@ -0,0 +1,411 @@
+// Host build of the application: the lemca control and the VT client code on
+// POSIX, a simulated tractor on the virtual CAN bus and a hitch model (plant.h)
+// closing the loop between the valves and the sensors. The loops of the target
+// (5 ms ISOBUS loop like App_Main.c, control at CONTROL_RATE_HZ) are events of
+// sim_time.h, in virtual time by default or in real time with -r. Prints the
+// closed loop metrics and the timing of the control step at the end.
+//
+//   lemca_host [-s scenario] [-t seconds] [-o trace.csv] [-r]
+//
+// Without -s the default scenario of scenario.c is run, host/scenarios has
+// examples. -t overrides the end of the scenario.
+//
+// The settings are read from and written to $LEMCA_SETTINGS or
+// ./lemca_settings.ini.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_timer.h"
+#include "hal/cpu_hal.h"
+
+#include "IsoDef.h"
+#include "AppCommon/AppHW.h"
+#include "AppIso/VIEngine.h"
+#include "AppIso/App_VTClientLev2.h"
+#include "MyProject1.iop.h"
+#include "Settings/settings.h"
+
+#include "lemca/lemca.h"
+#include "lemca/gpio.h"
+#include "lemca/control_task.h"
+#include "lemca/isobus_message.h"
+#include "lemca/adc/adc_sampler.h"
+#include "lemca/vt/vt_shadow.h"
+
+#include "sim_io.h"
+#include "vcan.h"
+#include "IsoVtcHost.h"
+#include "plant.h"
+#include "scenario.h"
+#include "metrics.h"
+#include "sim_time.h"
+
+#define HOST_LOOP_MS 5                  // ISO_NM_LOOPTIME
+#define HOST_SPEED_PERIOD_US 100000     // tractor speed broadcasts, 10 Hz
+#define HOST_TRACTOR_SA 0xF0u
+#define HOST_VT_INSTANCE 1
+#define HOST_TC_SA 0xF7u
+#define HOST_ETP_DPO_PACKETS 255        // ETP.DT packets per data packet offset
+#define HOST_VT_FEEDBACK_MAX_MS 50      // button to the answer on the bus
+
+typedef struct {
+    uint32_t n;
+    uint64_t sum_ns;
+    uint32_t min_ns;
+    uint32_t max_ns;
+} HostTiming;
+
+static void host_timing_add(HostTiming * t, uint32_t ns){
+    if(t->n == 0 || ns < t->min_ns){
+        t->min_ns = ns;
+    }
+    if(ns > t->max_ns){
+        t->max_ns = ns;
+    }
+    t->sum_ns += ns;
+    t->n++;
+}
+
+static void host_timing_print(const char * name, const HostTiming * t){
+    hw_DebugPrint("*** %s %u calls, min %u ns mean %u ns max %u ns\n", name, t->n,
+        t->min_ns, t->n ? (uint32_t)(t->sum_ns / t->n) : 0u, t->max_ns);
+}
+
+// wheel based and ground based speed, 0.001 m/s, forward
+static void tractor_send_speed(int node, int speed_mm_s){
+    uint8_t data[8] = { (uint8_t)speed_mm_s, (uint8_t)(speed_mm_s >> 8), 0, 0, 0, 0, 0xFF, 0xFD };
+    vcan_send(node, (3u << 26) | (PGN_WHEEL_BASED_SPEED << 8) | HOST_TRACTOR_SA, data, 8);
+    vcan_send(node, (3u << 26) | (PGN_GROUND_BASED_SPEED << 8) | HOST_TRACTOR_SA, data, 8);
+}
+
+// time from a VT button to the end of the transmission of the state string
+// it changes, measured on the frames of the ECU
+typedef struct {
+    int64_t press_us;       // 0 when no answer is waiting
+    uint8_t tp_packets;     // TP.DT packets of the last RTS to the VT
+    uint8_t tp_state;       // the TP transfer is the state string
+    uint32_t presses;
+    uint32_t n;
+    int64_t sum_us;
+    int64_t max_us;
+} HostFeedback;
+
+static void feedback_done(HostFeedback * fb, int64_t end_us){
+    int64_t latency_us = end_us - fb->press_us;
+    fb->n++;
+    fb->sum_us += latency_us;
+    if(latency_us > fb->max_us){
+        fb->max_us = latency_us;
+    }
+    fb->press_us = 0;
+}
+
+static int is_state_string(const uint8_t * cmd){
+    return cmd[0] == 0xB3u && (cmd[1] | (cmd[2] << 8)) == StringVariable_State;
+}
+
+static void feedback_frame(HostFeedback * fb, const VcanFrame * frame){
+    uint32_t pf = (frame->id >> 16) & 0xFFu;
+    uint32_t da = (frame->id >> 8) & 0xFFu;
+    if(fb->press_us == 0 || da != VT_HOST_VT_SA){
+        return;
+    }
+    if(pf == (PGN_ECUtoVT >> 8) && is_state_string(frame->data)){
+        feedback_done(fb, frame->timestamp_us);
+    } else if(pf == (PGN_TP_CM >> 8) && frame->data[0] == 16){
+        fb->tp_packets = frame->data[3];
+        fb->tp_state = 0;
+    } else if(pf == (PGN_TP_DT >> 8)){
+        if(frame->data[0] == 1){
+            fb->tp_state = is_state_string(&frame->data[1]);
+        }
+        if(fb->tp_state && frame->data[0] == fb->tp_packets){
+            feedback_done(fb, frame->timestamp_us);
+        }
+    }
+}
+
+// the tractor only looks at the VT commands of the ECU
+static void tractor_drain(int node, HostFeedback * fb){
+    VcanFrame frame;
+    while(vcan_receive(node, &frame)){
+        feedback_frame(fb, &frame);
+    }
+}
+
+// DDOP upload of the task controller client: ETP to the TC, the CTS of the TC
+// not simulated, as many frames per loop as the CAN driver takes
+typedef struct {
+    uint32_t bytes;
+    uint32_t packets;
+    uint32_t next;          // next packet
+    uint8_t cm_sent;        // RTS, then DPO of the segment of next
+    int64_t start_us;
+    uint32_t uploads;
+    uint32_t refused;
+} HostDdop;
+
+static uint32_t host_ecu_can_id(uint32_t pgn, uint8_t da){
+    return (7u << 26) | (pgn << 8) | ((uint32_t)da << 8) | VT_HOST_SA;
+}
+
+static void ddop_start(HostDdop * d, uint32_t bytes, int64_t now_us){
+    d->bytes = bytes;
+    d->packets = (bytes + 6) / 7;
+    d->next = 0;
+    d->cm_sent = 0;
+    d->start_us = now_us;
+}
+
+static int ddop_send(HostDdop * d, uint32_t pgn, const uint8_t * frame){
+    if(hw_CanSendMsg(ISO_CAN_VT, host_ecu_can_id(pgn, HOST_TC_SA), frame, 8) != 0){
+        d->refused++;
+        return 0;
+    }
+    return 1;
+}
+
+static void ddop_loop(HostDdop * d, int64_t now_us){
+    uint8_t frame[8];
+    while(d->next < d->packets){
+        uint32_t segment = d->next % HOST_ETP_DPO_PACKETS;
+        if(d->next == 0 && d->cm_sent == 0){
+            uint8_t rts[8] = { 20, (uint8_t)d->bytes, (uint8_t)(d->bytes >> 8), (uint8_t)(d->bytes >> 16),
+                (uint8_t)(d->bytes >> 24), (uint8_t)PGN_PROCESS_DATA, (uint8_t)(PGN_PROCESS_DATA >> 8), 0 };
+            if(!ddop_send(d, PGN_ETP_CM, rts)){
+                return;
+            }
+            d->cm_sent = 1;
+        }
+        if(segment == 0 && d->cm_sent < 2){
+            uint32_t offset = d->next;
+            uint32_t left = d->packets - d->next;
+            uint8_t dpo[8] = { 22, (uint8_t)(left < HOST_ETP_DPO_PACKETS ? left : HOST_ETP_DPO_PACKETS),
+                (uint8_t)offset, (uint8_t)(offset >> 8), (uint8_t)(offset >> 16),
+                (uint8_t)PGN_PROCESS_DATA, (uint8_t)(PGN_PROCESS_DATA >> 8), 0 };
+            if(!ddop_send(d, PGN_ETP_CM, dpo)){
+                return;
+            }
+            d->cm_sent = 2;
+        }
+        memset(frame, (uint8_t)d->next, sizeof(frame));
+        frame[0] = (uint8_t)(segment + 1);
+        if(!ddop_send(d, PGN_ETP_DT, frame)){
+            return;
+        }
+        d->next++;
+        if(d->next % HOST_ETP_DPO_PACKETS == 0){
+            d->cm_sent = 1;
+        }
+    }
+    if(d->packets > 0){
+        d->uploads++;
+        hw_DebugPrint("*** ddop %u bytes queued in %u ms\n", d->bytes, (uint32_t)((now_us - d->start_us) / 1000));
+        d->packets = 0;
+    }
+}
+
+static void vt_press(uint16_t object_id){
+    struct ButtonActivation_S button;
+    memset(&button, 0, sizeof(button));
+    button.objectIdOfButtonObject = object_id;
+    button.keyActivationCode = BUTTON_STATE_RELEASED;
+    button.u8Instance = HOST_VT_INSTANCE;
+    VTC_handleSoftkeysAndButtons(&button);
+}
+
+static void receive_can_messages(void){
+    uint32_t can_id;
+    uint8_t data[8];
+    uint8_t dlc;
+    while(hw_CanReadMsg(ISO_CAN_VT, &can_id, data, &dlc) > 0){
+    }
+}
+
+typedef struct {
+    Scenario scenario;
+    Metrics metrics;
+    Plant plant;
+    int tractor;
+    int stop_at_end;        // 0 with -t
+    HostFeedback feedback;
+    HostDdop ddop;
+    uint32_t tunes;
+    int64_t plant_us;
+    HostTiming control_timing;
+    HostTiming loop_timing;
+} HostSim;
+
+// scenario, hitch and sensors, every HOST_LOOP_MS
+static void host_field(void * ctx, int64_t now_us){
+    HostSim * sim = (HostSim *)ctx;
+    float t_s = now_us * 1e-6f;
+    uint32_t events = scenario_update(&sim->scenario, t_s);
+    if((events & (1u << Scenario_end)) && sim->stop_at_end){
+        sim_time_stop();
+        return;
+    }
+    if(events & ((1u << Scenario_work) | (1u << Scenario_up))){
+        if(sim->feedback.press_us == 0){
+            sim->feedback.press_us = now_us;
+            sim->feedback.presses++;
+        }
+        vt_press((events & (1u << Scenario_work)) ? Button_work : Button_uppp);
+    }
+    if(events & (1u << Scenario_ddop)){
+        ddop_start(&sim->ddop, (uint32_t)sim->scenario.values[Scenario_ddop], now_us);
+    }
+    if(events & (1u << Scenario_tune)){
+        // the 't' key of DoKeyBoard
+        startAutotune();
+        sim->tunes++;
+    }
+    if(events){
+        metrics_segment(&sim->metrics, t_s);
+    }
+    sim->plant.row_mm = scenario_value(&sim->scenario, Scenario_row, t_s);
+    sim->plant.ground_mm = scenario_value(&sim->scenario, Scenario_ground, t_s);
+
+    // the valves opened by the last control step act until now
+    uint32_t duty[Valve_count];
+    sim_io_get_duty(duty);
+    plant_step(&sim->plant, duty, (now_us - sim->plant_us) * 1e-6f);
+    sim->plant_us = now_us;
+    int32_t raw[AdcSensor_count];
+    plant_sensors(&sim->plant, raw);
+    sim_io_set_adc(raw, now_us);
+}
+
+static void host_tractor(void * ctx, int64_t now_us){
+    HostSim * sim = (HostSim *)ctx;
+    float speed_km_h = scenario_value(&sim->scenario, Scenario_speed, now_us * 1e-6f);
+    tractor_send_speed(sim->tractor, (int)(speed_km_h / 3.6f * 1000));
+    tractor_drain(sim->tractor, &sim->feedback);
+}
+
+static void host_control(void * ctx, int64_t now_us){
+    HostSim * sim = (HostSim *)ctx;
+    uint32_t duty[Valve_count];
+    sim_io_get_duty(duty);
+
+    uint32_t start = cpu_hal_get_cycle_count();
+    control_task_host_step(now_us);
+    host_timing_add(&sim->control_timing, cpu_hal_get_cycle_count() - start);
+
+    float error[Metrics_count] = { plant_offset_pct(&sim->plant), getWorkHeight() - plant_height_pct(&sim->plant) };
+    metrics_add(&sim->metrics, now_us * 1e-6f, error, duty, CONTROL_PERIOD_US * 1e-6f);
+}
+
+// App_Main.c superloop
+static void host_isobus_loop(void * ctx, int64_t now_us){
+    HostSim * sim = (HostSim *)ctx;
+    uint32_t start = cpu_hal_get_cycle_count();
+    receive_can_messages();
+    vt_host_poll(hw_GetTimeMs());
+    lemca_loop();
+    ddop_loop(&sim->ddop, now_us);
+    host_timing_add(&sim->loop_timing, cpu_hal_get_cycle_count() - start);
+    if(!hw_PowerSwitchIsOn()){
+        sim_time_stop();
+    }
+}
+
+int main(int argc, char * argv[]){
+    static HostSim sim;
+    PlantConfig plant_cfg;
+    plant_default_config(&plant_cfg);
+    scenario_default(&sim.scenario);
+    float duration_s = 0;
+    int virtual_time = 1;
+    const char * trace_path = NULL;
+    for(int i = 1; i < argc; ++i){
+        if(strcmp(argv[i], "-r") == 0){
+            virtual_time = 0;
+        } else if(i + 1 == argc){
+            break;
+        } else if(strcmp(argv[i], "-t") == 0){
+            duration_s = atof(argv[++i]);
+        } else if(strcmp(argv[i], "-s") == 0){
+            if(!scenario_load(&sim.scenario, argv[++i], &plant_cfg)){
+                return 1;
+            }
+        } else if(strcmp(argv[i], "-o") == 0){
+            trace_path = argv[++i];
+        }
+    }
+    sim.stop_at_end = duration_s <= 0;
+    if(duration_s <= 0){
+        duration_s = sim.scenario.end_s;
+    }
+    plant_init(&sim.plant, &plant_cfg);
+    metrics_init(&sim.metrics, trace_path);
+
+    // before anything reads the clock
+    sim_time_init(virtual_time);
+
+    Settings_init();
+    hw_Init();
+    hw_CanInit(ISO_CAN_NODES);
+    sim.tractor = vcan_open("tractor");
+
+    isobus_message_init();
+    lemca_init();
+    setup_gpio();
+    control_task_start();
+
+    ISOVT_EVENT_DATA_T vt_event;
+    memset(&vt_event, 0, sizeof(vt_event));
+    vt_event.u8Instance = HOST_VT_INSTANCE;
+    VTC_setPoolManipulation(&vt_event);
+    VTC_setPoolReady(&vt_event);
+
+    sim_time_add(0, HOST_LOOP_MS * 1000, host_field, &sim);
+    sim_time_add(0, HOST_SPEED_PERIOD_US, host_tractor, &sim);
+    sim_time_add(CONTROL_PERIOD_US, CONTROL_PERIOD_US, host_control, &sim);
+    sim_time_add(0, HOST_LOOP_MS * 1000, host_isobus_loop, &sim);
+
+    int64_t wall_start_us = esp_timer_get_time();
+    sim_time_run((int64_t)(duration_s * 1e6f));
+    int64_t wall_us = esp_timer_get_time() - wall_start_us;
+    int64_t sim_us = sim_time_now_us();
+
+    VtHostStats vt;
+    vt_host_get_stats(&vt);
+    metrics_print(&sim.metrics);
+    host_timing_print("control step", &sim.control_timing);
+    host_timing_print("isobus loop", &sim.loop_timing);
+    hw_DebugPrint("*** vt commands %u (strings %u numerics %u unchanged %u) frames %u bytes %u\n",
+        vt.commands, vt.strings, vt.numerics, vt.unchanged, vt.frames, vt.bytes);
+    VtShadowStats shadow;
+    vt_shadow_get_stats(&shadow);
+    hw_DebugPrint("*** vt shadow sent %u unchanged %u rate limited %u held %u refreshes %u rejected %u\n",
+        shadow.sent, shadow.unchanged, shadow.rate_limited, shadow.held, shadow.refreshes, shadow.rejected);
+    // every command sent is answered, timed out or still waiting
+    uint32_t answered = shadow.acked + shadow.errors + shadow.timeouts + (uint32_t)vt_shadow_waiting();
+    hw_DebugPrint("*** vt shadow acked %u errors %u timeouts %u waiting %d %s\n", shadow.acked, shadow.errors,
+        shadow.timeouts, vt_shadow_waiting(), answered == shadow.sent ? "ok" : "LOST");
+    const HostFeedback * fb = &sim.feedback;
+    uint32_t fb_max_ms = (uint32_t)(fb->max_us / 1000);
+    hw_DebugPrint("*** vt feedback latency %u/%u answers, mean %u ms max %u ms (target %u ms) %s\n", fb->n,
+        fb->presses, fb->n ? (uint32_t)(fb->sum_us / fb->n / 1000) : 0u, fb_max_ms, HOST_VT_FEEDBACK_MAX_MS,
+        (fb->n == fb->presses && fb_max_ms < HOST_VT_FEEDBACK_MAX_MS) ? "ok" : "LATE");
+    hw_DebugPrint("*** ddop %u uploads, %u frames refused by the CAN driver\n", sim.ddop.uploads, sim.ddop.refused);
+    if(sim.tunes > 0){
+        // as saved by lemca_loop once both axes are done
+        int32_t kp_ang = getS32("LEMCA", "KP_ANG", 0);
+        int32_t ki_ang = getS32("LEMCA", "KI_ANG", 0);
+        int32_t kp_h = getS32("LEMCA", "KP_H", 0);
+        int32_t ki_h = getS32("LEMCA", "KI_H", 0);
+        hw_DebugPrint("*** autotune %u runs, saved gains/1000 kp_ang %d ki_ang %d kp_h %d ki_h %d %s\n", sim.tunes,
+            kp_ang, ki_ang, kp_h, ki_h, (kp_ang > 0 && ki_ang > 0 && kp_h > 0 && ki_h > 0) ? "ok" : "FAILED");
+    }
+    vcan_print_stats();
+    hw_DebugPrint("*** bus load %u.%u %%\n",
+        (uint32_t)(vcan_busy_us() * 1000 / sim_us) / 10, (uint32_t)(vcan_busy_us() * 1000 / sim_us) % 10);
+    hw_DebugPrint("*** %s time, %u events, %.1f s simulated in %.1f ms\n", virtual_time ? "virtual" : "real",
+        sim_time_events(), sim_us * 1e-6, wall_us * 1e-3);
+    hw_Shutdown();
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "metrics.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "AppCommon/AppHW.h"
+
+static const char * const s_axis_names[Metrics_count] = { "angle", "height" };
+
+void metrics_init(Metrics * m, const char * trace_path){
+    memset(m, 0, sizeof(*m));
+    if(trace_path != NULL){
+        m->trace = fopen(trace_path, "w");
+        if(m->trace == NULL){
+            hw_DebugPrint("*** trace %s cannot be written\n", trace_path);
+        } else {
+            fprintf(m->trace, "t_s,error_ang,error_h,duty_left,duty_right,duty_up,duty_down\n");
+        }
+    }
+}
+
+void metrics_segment(Metrics * m, float t_s){
+    if(m->n_segments > 0 && m->segments[m->n_segments - 1].start_s == t_s){
+        return;
+    }
+    if(m->n_segments == METRICS_MAX_SEGMENTS){
+        return;
+    }
+    MetricsSegment * s = &m->segments[m->n_segments++];
+    memset(s, 0, sizeof(*s));
+    s->start_s = t_s;
+}
+
+void metrics_add(Metrics * m, float t_s, const float error[Metrics_count], const uint32_t duty[Valve_count], float dt_s){
+    if(m->n_segments > 0){
+        MetricsSegment * s = &m->segments[m->n_segments - 1];
+        for(int a = 0; a < Metrics_count; ++a){
+            float e = error[a];
+            if(e > s->max_pos[a]){
+                s->max_pos[a] = e;
+            }
+            if(-e > s->max_neg[a]){
+                s->max_neg[a] = -e;
+            }
+            s->out[a] = fabsf(e) > METRICS_BAND_PCT;
+            if(s->out[a]){
+                s->last_out_s[a] = t_s;
+            }
+        }
+    }
+    for(int a = 0; a < Metrics_count; ++a){
+        m->sum_sq[a] += (double)error[a] * error[a];
+    }
+    m->n_samples++;
+    for(int v = 0; v < Valve_count; ++v){
+        m->valve_s[v] += (double)duty[v] / VALVE_DUTY_MAX * dt_s;
+    }
+    if(m->trace != NULL){
+        fprintf(m->trace, "%.3f,%.2f,%.2f,%u,%u,%u,%u\n", t_s, error[Metrics_angle], error[Metrics_height],
+            duty[Valve_left], duty[Valve_right], duty[Valve_up], duty[Valve_down]);
+    }
+}
+
+void metrics_print(Metrics * m){
+    for(int i = 0; i < m->n_segments; ++i){
+        const MetricsSegment * s = &m->segments[i];
+        for(int a = 0; a < Metrics_count; ++a){
+            float big = s->max_pos[a] > s->max_neg[a] ? s->max_pos[a] : s->max_neg[a];
+            float small = s->max_pos[a] > s->max_neg[a] ? s->max_neg[a] : s->max_pos[a];
+            float settle_s = s->out[a] ? -1 : (s->last_out_s[a] > s->start_s ? s->last_out_s[a] - s->start_s : 0);
+            hw_DebugPrint("*** segment %5.1f s %-6s peak %5.1f %% overshoot %3.0f %% settling %5.2f s\n",
+                s->start_s, s_axis_names[a], big, big > 0 ? 100 * small / big : 0, settle_s);
+        }
+    }
+    for(int a = 0; a < Metrics_count; ++a){
+        hw_DebugPrint("*** rms %-6s %.2f %%\n", s_axis_names[a],
+            m->n_samples ? sqrt(m->sum_sq[a] / m->n_samples) : 0);
+    }
+    hw_DebugPrint("*** valve energy left %.2f right %.2f up %.2f down %.2f s at full opening\n",
+        m->valve_s[Valve_left], m->valve_s[Valve_right], m->valve_s[Valve_up], m->valve_s[Valve_down]);
+    if(m->trace != NULL){
+        fclose(m->trace);
+        m->trace = NULL;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef HOST_METRICS_H_
+#define HOST_METRICS_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "lemca/valve/valve_output.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Closed loop metrics of a simulation run, per axis:
+//   rms        of the error over the run
+//   settling   per segment (a segment starts at each scenario event): time of
+//              the last sample out of +-METRICS_BAND_PCT after the start,
+//              -1 when the segment ends out of the band
+//   overshoot  per segment: largest error on the side opposite to the
+//              largest one, % of the largest one
+// and the energy of each valve, in seconds at full opening.
+
+#define METRICS_MAX_SEGMENTS 64
+#define METRICS_BAND_PCT 2.0f
+
+enum MetricsAxis {
+    Metrics_angle = 0,     // row offset, %
+    Metrics_height = 1,    // work height - height, %
+    Metrics_count
+};
+
+typedef struct {
+    float start_s;
+    float max_pos[Metrics_count];
+    float max_neg[Metrics_count];
+    float last_out_s[Metrics_count];
+    uint8_t out[Metrics_count];     // last sample out of the band
+} MetricsSegment;
+
+typedef struct {
+    MetricsSegment segments[METRICS_MAX_SEGMENTS];
+    int n_segments;
+    double sum_sq[Metrics_count];
+    uint32_t n_samples;
+    double valve_s[Valve_count];
+    FILE * trace;
+} Metrics;
+
+// trace_path: CSV of every sample, NULL for none
+void metrics_init(Metrics * m, const char * trace_path);
+void metrics_segment(Metrics * m, float t_s);
+void metrics_add(Metrics * m, float t_s, const float error[Metrics_count], const uint32_t duty[Valve_count], float dt_s);
+void metrics_print(Metrics * m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,88 @@
+#include "plant.h"
+
+#include <math.h>
+
+#define PLANT_COUNTS_PER_PCT 32.0f      // ADC_CALIB_DEFAULT_MAX / 100
+
+void plant_default_config(PlantConfig * cfg){
+    cfg->shift_stroke_mm = 300;
+    cfg->shift_speed_mm_s = 80;
+    cfg->lift_stroke_mm = 400;
+    cfg->lift_up_mm_s = 100;
+    cfg->lift_down_mm_s = 150;
+    cfg->lift_start_mm = 100;
+    cfg->dead_band = 0.1f;
+    cfg->row_pct_per_mm = 0.5f;
+    cfg->noise_counts = 8;
+    cfg->seed = 1;
+}
+
+void plant_init(Plant * plant, const PlantConfig * cfg){
+    plant->cfg = *cfg;
+    plant->shift_mm = 0;
+    plant->lift_mm = cfg->lift_start_mm;
+    plant->row_mm = 0;
+    plant->ground_mm = 0;
+    plant->rng = cfg->seed ? cfg->seed : 1;
+}
+
+static float plant_flow(const Plant * plant, uint32_t duty){
+    float x = (float)duty / VALVE_DUTY_MAX;
+    float db = plant->cfg.dead_band;
+    if(x <= db){
+        return 0;
+    }
+    x = (x - db) / (1 - db);
+    return x > 1 ? 1 : x;
+}
+
+static float plant_clamp(float x, float lo, float hi){
+    return x < lo ? lo : (x > hi ? hi : x);
+}
+
+void plant_step(Plant * plant, const uint32_t duty[Valve_count], float dt_s){
+    const PlantConfig * c = &plant->cfg;
+    float shift_v = c->shift_speed_mm_s * (plant_flow(plant, duty[Valve_left]) - plant_flow(plant, duty[Valve_right]));
+    float lift_v = c->lift_up_mm_s * plant_flow(plant, duty[Valve_up]) - c->lift_down_mm_s * plant_flow(plant, duty[Valve_down]);
+    plant->shift_mm = plant_clamp(plant->shift_mm + shift_v * dt_s, -c->shift_stroke_mm / 2, c->shift_stroke_mm / 2);
+    plant->lift_mm = plant_clamp(plant->lift_mm + lift_v * dt_s, 0, c->lift_stroke_mm);
+}
+
+// xorshift32 + Box-Muller, reproducible from the seed
+static float plant_uniform(Plant * plant){
+    uint32_t x = plant->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    plant->rng = x;
+    return ((x >> 8) + 0.5f) / 16777216.0f;
+}
+
+static float plant_gauss(Plant * plant){
+    float u1 = plant_uniform(plant);
+    float u2 = plant_uniform(plant);
+    return sqrtf(-2 * logf(u1)) * cosf(2 * (float)M_PI * u2);
+}
+
+static int32_t plant_counts(Plant * plant, float pct){
+    float raw = pct * PLANT_COUNTS_PER_PCT + plant->cfg.noise_counts * plant_gauss(plant);
+    return (int32_t)plant_clamp(lrintf(raw), 0, 4095);
+}
+
+float plant_offset_pct(const Plant * plant){
+    return (plant->row_mm - plant->shift_mm) * plant->cfg.row_pct_per_mm;
+}
+
+float plant_height_pct(const Plant * plant){
+    return (plant->lift_mm - plant->ground_mm) * 100 / plant->cfg.lift_stroke_mm;
+}
+
+void plant_sensors(Plant * plant, int32_t raw[AdcSensor_count]){
+    const PlantConfig * c = &plant->cfg;
+    float offset = plant_offset_pct(plant);
+    float height = plant_height_pct(plant);
+    raw[AdcSensor_angle] = plant_counts(plant, 50 + plant->shift_mm * 100 / c->shift_stroke_mm);
+    raw[AdcSensor_h] = plant_counts(plant, plant->lift_mm * 100 / c->lift_stroke_mm);
+    raw[AdcSensor_machine_l] = plant_counts(plant, 100 - (height + offset / 2));
+    raw[AdcSensor_machine_r] = plant_counts(plant, height - offset / 2);
+}
@@ -0,0 +1,60 @@
+#ifndef HOST_PLANT_H_
+#define HOST_PLANT_H_
+
+#include <stdint.h>
+
+#include "lemca/adc/adc_sampler.h"
+#include "lemca/valve/valve_output.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Hitch model of the closed loop simulation. The side shift and the lift are
+// flow-limited integrators: speed = full speed * flow(duty), flow = 0 in the
+// dead band then linear up to the full opening, position clamped to the
+// stroke. The sensors see:
+//   row offset % = (row - shift) * row_pct_per_mm
+//   height %     = (lift - ground) * 100 / lift stroke
+//   machine_l    = height + offset/2 (mounted the other way, see adc_calib.c)
+//   machine_r    = height - offset/2
+//   angle        = side shift position, 50 % centred
+//   h            = lift position
+// on the default 3200 counts = 100 % scale of adc_calib, plus gaussian noise.
+
+typedef struct {
+    float shift_stroke_mm;      // side shift, centred
+    float shift_speed_mm_s;     // at full opening
+    float lift_stroke_mm;
+    float lift_up_mm_s;
+    float lift_down_mm_s;
+    float lift_start_mm;
+    float dead_band;            // 0..1 of VALVE_DUTY_MAX without flow
+    float row_pct_per_mm;
+    float noise_counts;         // standard deviation
+    uint32_t seed;
+} PlantConfig;
+
+typedef struct {
+    PlantConfig cfg;
+    float shift_mm;
+    float lift_mm;
+    float row_mm;               // lateral position of the row, set by the scenario
+    float ground_mm;            // ground level under the sensors, set by the scenario
+    uint32_t rng;
+} Plant;
+
+void plant_default_config(PlantConfig * cfg);
+void plant_init(Plant * plant, const PlantConfig * cfg);
+void plant_step(Plant * plant, const uint32_t duty[Valve_count], float dt_s);
+void plant_sensors(Plant * plant, int32_t raw[AdcSensor_count]);
+
+// noise free values seen by the row sensors, %
+float plant_offset_pct(const Plant * plant);
+float plant_height_pct(const Plant * plant);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,120 @@
+// Heap high-water mark of the pool loading of AppPool (pool channels of
+// App_VTClient.c). operator new / delete are counted, the pool buffers are
+// std::vector: the peak of each load is printed next to the pool size and the
+// exit code is 1 when a load needs more than one pool in RAM (file) or a copy
+// of the pool at all (byte array, read in place).
+//
+//   lemca_pool_heap [pool.iop]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#include "AppPool/AppPool.h"
+
+#ifndef POOL_IOP_FILE
+#define POOL_IOP_FILE "pools/MyProject1.iop"
+#endif
+
+// AppPool object, node of the channel map
+#define POOL_HEAP_OVERHEAD 512
+
+static size_t s_heap_cur = 0;
+static size_t s_heap_peak = 0;
+
+// size kept in front of the block, aligned for any type
+static const size_t HEADER = alignof(std::max_align_t);
+
+void * operator new(size_t size){
+    unsigned char * p = (unsigned char *)malloc(size + HEADER);
+    if(p == NULL){
+        throw std::bad_alloc();
+    }
+    *(size_t *)p = size;
+    s_heap_cur += size;
+    if(s_heap_cur > s_heap_peak){
+        s_heap_peak = s_heap_cur;
+    }
+    return p + HEADER;
+}
+
+void operator delete(void * ptr) noexcept {
+    if(ptr == NULL){
+        return;
+    }
+    unsigned char * p = (unsigned char *)ptr - HEADER;
+    s_heap_cur -= *(size_t *)p;
+    free(p);
+}
+
+void operator delete(void * ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+void * operator new[](size_t size){
+    return operator new(size);
+}
+
+void operator delete[](void * ptr) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete[](void * ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+static std::vector<unsigned char> read_file(const char * path){
+    std::vector<unsigned char> data;
+    FILE * f = fopen(path, "rb");
+    if(f != NULL){
+        fseek(f, 0, SEEK_END);
+        data.resize((size_t)ftell(f));
+        fseek(f, 0, SEEK_SET);
+        if(fread(data.data(), 1, data.size(), f) != data.size()){
+            data.clear();
+        }
+        fclose(f);
+    }
+    return data;
+}
+
+// peak above the heap in use before the load, the pool stays loaded until the check
+static int check(const char * name, uint8_t channel, size_t base, size_t pool_size, size_t limit){
+    size_t peak = s_heap_peak - base;
+    size_t held = s_heap_cur - base;
+    int ok = (channel != 0) && (poolGetSize(channel) == pool_size) && (peak <= limit);
+    printf("%-10s pool %6zu B  peak %6zu B (%.2f pools)  held %6zu B  %s\n", name, pool_size,
+        peak, (double)peak / pool_size, held, ok ? "ok" : "FAIL");
+    poolFree(channel);
+    return ok;
+}
+
+int main(int argc, char ** argv){
+    const char * path = (argc > 1) ? argv[1] : POOL_IOP_FILE;
+    std::vector<unsigned char> iop = read_file(path);
+    if(iop.empty()){
+        fprintf(stderr, "lemca_pool_heap: cannot read %s\n", path);
+        return 2;
+    }
+    size_t pool_size = iop.size();
+    int ok = 1;
+
+    // first load: the map of the pool channels allocates its state once
+    poolFree(poolLoadByByteArray(iop.data(), (uint32_t)pool_size));
+
+    size_t base = s_heap_cur;
+    s_heap_peak = base;
+    uint8_t channel = poolLoadByFilename(path);
+    poolOpen(channel, 0);
+    ok &= check("file", channel, base, pool_size, pool_size + POOL_HEAP_OVERHEAD);
+
+    base = s_heap_cur;
+    s_heap_peak = base;
+    channel = poolLoadByByteArray(iop.data(), (uint32_t)pool_size);
+    poolOpen(channel, 0);
+    ok &= check("byte array", channel, base, pool_size, POOL_HEAP_OVERHEAD);
+
+    return ok ? 0 : 1;
+}
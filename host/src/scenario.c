@@ -0,0 +1,152 @@
+#include "scenario.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "AppCommon/AppHW.h"
+
+static const char * const s_action_names[] = { "speed", "row", "ground", "work", "up", "ddop", "tune", "end" };
+
+static int scenario_add(Scenario * sc, float t_s, int action, float value, float ramp_s){
+    if(sc->n == SCENARIO_MAX_EVENTS){
+        return 0;
+    }
+    // kept sorted, the file may not be
+    int i = sc->n++;
+    while(i > 0 && sc->events[i - 1].t_s > t_s){
+        sc->events[i] = sc->events[i - 1];
+        --i;
+    }
+    ScenarioEvent * e = &sc->events[i];
+    e->t_s = t_s;
+    e->action = action;
+    e->value = value;
+    e->ramp_s = ramp_s;
+    if(action == Scenario_end){
+        sc->end_s = t_s;
+    }
+    return 1;
+}
+
+static void scenario_clear(Scenario * sc){
+    memset(sc, 0, sizeof(*sc));
+    sc->end_s = 0;
+}
+
+void scenario_default(Scenario * sc){
+    scenario_clear(sc);
+    scenario_add(sc, 0, Scenario_speed, 10, 0);
+    scenario_add(sc, 0, Scenario_work, 0, 0);
+    scenario_add(sc, 10, Scenario_row, 40, 0);
+    scenario_add(sc, 20, Scenario_row, -40, 0);
+    scenario_add(sc, 30, Scenario_end, 0, 0);
+}
+
+static int scenario_plant_field(PlantConfig * cfg, const char * name, float value){
+    if(strcmp(name, "shift_stroke_mm") == 0){
+        cfg->shift_stroke_mm = value;
+    } else if(strcmp(name, "shift_speed_mm_s") == 0){
+        cfg->shift_speed_mm_s = value;
+    } else if(strcmp(name, "lift_stroke_mm") == 0){
+        cfg->lift_stroke_mm = value;
+    } else if(strcmp(name, "lift_up_mm_s") == 0){
+        cfg->lift_up_mm_s = value;
+    } else if(strcmp(name, "lift_down_mm_s") == 0){
+        cfg->lift_down_mm_s = value;
+    } else if(strcmp(name, "lift_start_mm") == 0){
+        cfg->lift_start_mm = value;
+    } else if(strcmp(name, "dead_band") == 0){
+        cfg->dead_band = value;
+    } else if(strcmp(name, "row_pct_per_mm") == 0){
+        cfg->row_pct_per_mm = value;
+    } else if(strcmp(name, "noise_counts") == 0){
+        cfg->noise_counts = value;
+    } else if(strcmp(name, "seed") == 0){
+        cfg->seed = (uint32_t)value;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+int scenario_load(Scenario * sc, const char * path, PlantConfig * cfg){
+    FILE * file = fopen(path, "r");
+    if(file == NULL){
+        hw_DebugPrint("*** scenario %s not found\n", path);
+        return 0;
+    }
+    scenario_clear(sc);
+    char line[256];
+    int line_nb = 0;
+    while(fgets(line, sizeof(line), file) != NULL){
+        line_nb++;
+        char * comment = strchr(line, '#');
+        if(comment != NULL){
+            *comment = 0;
+        }
+        float t_s;
+        char name[32];
+        char arg[32] = "";
+        float ramp_s = 0;
+        int n = sscanf(line, "%f %31s %31s %f", &t_s, name, arg, &ramp_s);
+        if(n <= 0){
+            continue;
+        }
+        if(n >= 2 && strcmp(name, "plant") == 0){
+            char field[32];
+            float value;
+            if(sscanf(line, "%*f %*s %31s %f", field, &value) == 2 && scenario_plant_field(cfg, field, value)){
+                continue;
+            }
+        } else if(n >= 2){
+            int action = -1;
+            for(int a = 0; a <= Scenario_end; ++a){
+                if(strcmp(name, s_action_names[a]) == 0){
+                    action = a;
+                }
+            }
+            int needs_value = (action >= 0 && action <= Scenario_ground) || action == Scenario_ddop;
+            if(action >= 0 && (!needs_value || n >= 3)){
+                scenario_add(sc, t_s, action, needs_value ? strtof(arg, NULL) : 0, ramp_s);
+                continue;
+            }
+        }
+        hw_DebugPrint("*** scenario %s:%i not understood\n", path, line_nb);
+    }
+    fclose(file);
+    if(sc->end_s <= 0 && sc->n > 0){
+        sc->end_s = sc->events[sc->n - 1].t_s + 10;
+    }
+    return 1;
+}
+
+uint32_t scenario_update(Scenario * sc, float t_s){
+    uint32_t mask = 0;
+    while(sc->next < sc->n && sc->events[sc->next].t_s <= t_s){
+        const ScenarioEvent * e = &sc->events[sc->next++];
+        if(e->action < Scenario_end){
+            sc->values[e->action] = e->value;
+        }
+        if(e->action <= Scenario_ground){
+            ScenarioRamp * r = &sc->ramps[e->action];
+            r->from = scenario_value(sc, e->action, e->t_s);
+            r->to = e->value;
+            r->t0_s = e->t_s;
+            r->t1_s = e->t_s + e->ramp_s;
+        }
+        mask |= 1u << e->action;
+    }
+    return mask;
+}
+
+float scenario_value(const Scenario * sc, int action, float t_s){
+    const ScenarioRamp * r = &sc->ramps[action];
+    if(t_s >= r->t1_s){
+        return r->to;
+    }
+    if(t_s <= r->t0_s){
+        return r->from;
+    }
+    return r->from + (r->to - r->from) * (t_s - r->t0_s) / (r->t1_s - r->t0_s);
+}
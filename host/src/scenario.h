@@ -0,0 +1,74 @@
+#ifndef HOST_SCENARIO_H_
+#define HOST_SCENARIO_H_
+
+#include <stdint.h>
+
+#include "plant.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Field scenario of the closed loop simulation, one event per line:
+//   <time s> speed  <km/h> [ramp s]
+//   <time s> row    <lateral position of the row, mm> [ramp s]
+//   <time s> ground <ground level, mm> [ramp s]
+//   <time s> work | up          state of the machine (VT buttons)
+//   <time s> ddop   <bytes>     DDOP upload to the task controller (ETP)
+//   <time s> tune               autotune of the angle and height (key 't')
+//   <time s> end                end of the run
+//   0 plant <field of PlantConfig> <value>
+// '#' starts a comment. Without ramp the value is a step.
+
+#define SCENARIO_MAX_EVENTS 128
+
+enum ScenarioAction {
+    Scenario_speed = 0,
+    Scenario_row,
+    Scenario_ground,
+    Scenario_work,
+    Scenario_up,
+    Scenario_ddop,
+    Scenario_tune,
+    Scenario_end
+};
+
+typedef struct {
+    float t_s;
+    uint8_t action;
+    float value;
+    float ramp_s;
+} ScenarioEvent;
+
+typedef struct {
+    float from;
+    float to;
+    float t0_s;
+    float t1_s;
+} ScenarioRamp;
+
+typedef struct {
+    ScenarioEvent events[SCENARIO_MAX_EVENTS];
+    int n;
+    int next;
+    float end_s;
+    float values[Scenario_end];                 // of the last event of each action
+    ScenarioRamp ramps[Scenario_ground + 1];    // speed, row, ground
+} Scenario;
+
+// 10 km/h, work at 0, row steps of +-40 mm, 30 s
+void scenario_default(Scenario * sc);
+// the plant lines change cfg, returns 0 when the file cannot be read
+int scenario_load(Scenario * sc, const char * path, PlantConfig * cfg);
+
+// applies the events reached at t_s, returns the mask (1 << action) of
+// the events applied
+uint32_t scenario_update(Scenario * sc, float t_s);
+// speed, row or ground at t_s
+float scenario_value(const Scenario * sc, int action, float t_s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,299 @@
+/* ************************************************************************ */
+/*!
+   \file
+   \brief       Settings of the host build, kept in a text file.
+
+   Same behaviour as settingsNVS.cpp: the section is ignored (one NVS
+   namespace), a missing key is created with its default value and every
+   set is written through. One "key=value" per line, the file is
+   $LEMCA_SETTINGS or ./lemca_settings.ini.
+*/
+/* ************************************************************************ */
+#include "Settings/settings.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <map>
+#include <string>
+
+/* ************************************************************************ */
+
+static class Settings
+{
+private:
+    std::map<std::string, std::string> m_values;
+    std::string m_path;
+
+    void save(void)
+    {
+        FILE* file = fopen(m_path.c_str(), "w");
+        if (file == NULL)
+        {
+            printf("settings: cannot write %s\n", m_path.c_str());
+            return;
+        }
+        for (const auto& kv : m_values)
+        {
+            fprintf(file, "%s=%s\n", kv.first.c_str(), kv.second.c_str());
+        }
+        fclose(file);
+    }
+
+    bool get(const char key[], std::string& value)
+    {
+        auto it = m_values.find(key);
+        if (it == m_values.end())
+        {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+    void set(const char key[], const std::string& value)
+    {
+        m_values[key] = value;
+        save();
+    }
+
+    template <typename T>
+    T getNumber(const char key[], const T defaultValue, const char* format)
+    {
+        std::string text;
+        if (get(key, text))
+        {
+            return (T)strtoll(text.c_str(), NULL, 0);
+        }
+        setNumber(key, defaultValue, format);
+        return defaultValue;
+    }
+
+    template <typename T>
+    void setNumber(const char key[], const T value, const char* format)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), format, value);
+        set(key, text);
+    }
+
+public :
+    void init(void)
+    {
+        const char* path = getenv("LEMCA_SETTINGS");
+        m_path = (path != NULL) ? path : "lemca_settings.ini";
+        m_values.clear();
+
+        FILE* file = fopen(m_path.c_str(), "r");
+        if (file == NULL)
+        {
+            printf("settings: new file %s\n", m_path.c_str());
+            return;
+        }
+        char line[256];
+        while (fgets(line, sizeof(line), file) != NULL)
+        {
+            line[strcspn(line, "\r\n")] = 0;
+            char* eq = strchr(line, '=');
+            if ((eq == NULL) || (line[0] == '#'))
+            {
+                continue;
+            }
+            *eq = 0;
+            m_values[line] = eq + 1;
+        }
+        fclose(file);
+        printf("settings: %u values from %s\n", (unsigned)m_values.size(), m_path.c_str());
+    }
+
+    int64_t getS64(const char key[], const int64_t defaultValue)
+    {
+        return getNumber<int64_t>(key, defaultValue, "%" PRId64);
+    }
+
+    uint64_t getU64(const char key[], const uint64_t defaultValue)
+    {
+        std::string text;
+        if (get(key, text))
+        {
+            return strtoull(text.c_str(), NULL, 0);
+        }
+        setU64(key, defaultValue);
+        return defaultValue;
+    }
+
+    uint64_t getX64(const char key[], const uint64_t defaultValue)
+    {
+        std::string text;
+        if (get(key, text))
+        {
+            return strtoull(text.c_str(), NULL, 16);
+        }
+        setX64(key, defaultValue);
+        return defaultValue;
+    }
+
+    size_t getString(const char key[], const char defaultValue[], char captionOut[], size_t size)
+    {
+        std::string text;
+        if (!get(key, text))
+        {
+            if (defaultValue == nullptr)
+            {
+                return (size_t)0U;
+            }
+            text = defaultValue;
+            set(key, text);
+        }
+        if (size == 0u)
+        {
+            return (size_t)0U;
+        }
+        strncpy(captionOut, text.c_str(), size - 1u);
+        captionOut[size - 1u] = 0;
+        return strlen(captionOut);
+    }
+
+    void setS64(const char key[], const int64_t value)
+    {
+        setNumber<int64_t>(key, value, "%" PRId64);
+    }
+
+    void setU64(const char key[], const uint64_t value)
+    {
+        setNumber<uint64_t>(key, value, "%" PRIu64);
+    }
+
+    void setX64(const char key[], const uint64_t value)
+    {
+        setNumber<uint64_t>(key, value, "%" PRIX64);
+    }
+
+    void setString(const char key[], const char value[])
+    {
+        set(key, value);
+    }
+
+    void eraseString(const char key[])
+    {
+        m_values.erase(key);
+        save();
+    }
+
+} s_settings;
+
+
+
+void Settings_init(void)
+{
+    s_settings.init();
+}
+
+/* ************************************************************************ */
+/* all the integer types go through the 64 bits accessors */
+
+int8_t getS8(const char section[], const char key[], const int8_t defaultValue)
+{
+    return (int8_t)s_settings.getS64(key, defaultValue);
+}
+
+int16_t getS16(const char section[], const char key[], const int16_t defaultValue)
+{
+    return (int16_t)s_settings.getS64(key, defaultValue);
+}
+
+int32_t getS32(const char section[], const char key[], const int32_t defaultValue)
+{
+    return (int32_t)s_settings.getS64(key, defaultValue);
+}
+
+int64_t getS64(const char section[], const char key[], const int64_t defaultValue)
+{
+    return s_settings.getS64(key, defaultValue);
+}
+
+uint8_t getU8(const char section[], const char key[], const uint8_t defaultValue)
+{
+    return (uint8_t)s_settings.getU64(key, defaultValue);
+}
+
+uint16_t getU16(const char section[], const char key[], const uint16_t defaultValue)
+{
+    return (uint16_t)s_settings.getU64(key, defaultValue);
+}
+
+uint32_t getU32(const char section[], const char key[], const uint32_t defaultValue)
+{
+    return (uint32_t)s_settings.getU64(key, defaultValue);
+}
+
+uint64_t getU64(const char section[], const char key[], const uint64_t defaultValue)
+{
+    return s_settings.getU64(key, defaultValue);
+}
+
+uint64_t getX64(const char section[], const char key[], const uint64_t defaultValue)
+{
+    return s_settings.getX64(key, defaultValue);
+}
+
+size_t getString(const char section[], const char key[], const char defaultValue[], char caption[], size_t size)
+{
+    return s_settings.getString(key, defaultValue, caption, size);
+}
+
+void setS8(const char section[], const char key[], const int8_t value)
+{
+    s_settings.setS64(key, value);
+}
+
+void setS16(const char section[], const char key[], const int16_t value)
+{
+    s_settings.setS64(key, value);
+}
+
+void setS32(const char section[], const char key[], const int32_t value)
+{
+    s_settings.setS64(key, value);
+}
+
+void setS64(const char section[], const char key[], const int64_t value)
+{
+    s_settings.setS64(key, value);
+}
+
+void setU8(const char section[], const char key[], const uint8_t value)
+{
+    s_settings.setU64(key, value);
+}
+
+void setU16(const char section[], const char key[], const uint16_t value)
+{
+    s_settings.setU64(key, value);
+}
+
+void setU32(const char section[], const char key[], const uint32_t value)
+{
+    s_settings.setU64(key, value);
+}
+
+void setU64(const char section[], const char key[], const uint64_t value)
+{
+    s_settings.setU64(key, value);
+}
+
+void setX64(const char section[], const char key[], const uint64_t value)
+{
+    s_settings.setX64(key, value);
+}
+
+void setString(const char section[], const char key[], const char value[])
+{
+    s_settings.setString(key, value);
+}
+
+void eraseString(const char section[], const char key[])
+{
+    s_settings.eraseString(key);
+}
@@ -0,0 +1,147 @@
+#include "sim_io.h"
+
+#include <string.h>
+
+#include "esp_timer.h"
+#include "hal/cpu_hal.h"
+
+#include "AppCommon/AppHW.h"
+#include "lemca/lemca.h"
+#include "lemca/control_task.h"
+#include "lemca/uart/my_uart.h"
+
+static AdcSamples s_adc;
+static AdcSamplerStats s_adc_stats;
+
+static uint32_t s_duty[Valve_count];
+static ValveOutputStats s_valve_stats;
+
+static ControlTaskStats s_control_stats;
+static int s_control_started = 0;
+
+// adc_sampler.h
+
+void sim_io_set_adc(const int32_t raw[AdcSensor_count], int64_t timestamp_us){
+    memcpy(s_adc.raw, raw, sizeof(s_adc.raw));
+    s_adc.timestamp_us = timestamp_us;
+    s_adc_stats.samples += AdcSensor_count * ADC_SAMPLER_BLOCK;
+    s_adc_stats.blocks += AdcSensor_count;
+}
+
+void adc_sampler_start(void){
+    memset(&s_adc, 0, sizeof(s_adc));
+    memset(&s_adc_stats, 0, sizeof(s_adc_stats));
+}
+
+int adc_sampler_read(AdcSamples * samples){
+    *samples = s_adc;
+    return s_adc.timestamp_us != 0;
+}
+
+void adc_sampler_get_stats(AdcSamplerStats * stats){
+    *stats = s_adc_stats;
+}
+
+// valve_output.h
+
+void sim_io_get_duty(uint32_t duty[Valve_count]){
+    memcpy(duty, s_duty, sizeof(s_duty));
+}
+
+void valve_output_init(uint32_t ramp_us){
+    (void)ramp_us;
+    memset(s_duty, 0, sizeof(s_duty));
+}
+
+void valve_output_write(const uint32_t duty[Valve_count]){
+    uint32_t start = cpu_hal_get_cycle_count();
+    for(int v = 0; v < Valve_count; ++v){
+        uint32_t d = duty[v] > VALVE_DUTY_MAX ? VALVE_DUTY_MAX : duty[v];
+        if(d != s_duty[v]){
+            s_duty[v] = d;
+            s_valve_stats.channel_updates++;
+        }
+    }
+    s_valve_stats.writes++;
+    s_valve_stats.last_cycles = cpu_hal_get_cycle_count() - start;
+    if(s_valve_stats.last_cycles > s_valve_stats.max_cycles){
+        s_valve_stats.max_cycles = s_valve_stats.last_cycles;
+    }
+}
+
+void valve_output_get_stats(ValveOutputStats * stats){
+    *stats = s_valve_stats;
+}
+
+void valve_output_reset_max(void){
+    s_valve_stats.max_cycles = 0;
+}
+
+// control_task.h
+
+void control_task_start(){
+    if(s_control_started){
+        return;
+    }
+    hw_DebugPrint("*** control_task_start %i Hz, host loop\n", CONTROL_RATE_HZ);
+    lemca_control_init();
+    s_control_started = 1;
+}
+
+void control_task_host_step(int64_t tick_us){
+    // latency on the simulation clock, execution time on the wall clock
+    int64_t start_us = hw_GetTimeUs();
+    uint32_t latency_us = (uint32_t)(start_us - tick_us);
+
+    int64_t exec_start_us = esp_timer_get_time();
+    lemca_control_step(start_us);
+    uint32_t exec_us = (uint32_t)(esp_timer_get_time() - exec_start_us);
+    s_control_stats.last_latency_us = latency_us;
+    if(latency_us > s_control_stats.max_latency_us){
+        s_control_stats.max_latency_us = latency_us;
+    }
+    s_control_stats.last_exec_us = exec_us;
+    if(exec_us > s_control_stats.max_exec_us){
+        s_control_stats.max_exec_us = exec_us;
+    }
+    s_control_stats.cycles++;
+}
+
+void control_task_get_stats(ControlTaskStats * stats){
+    *stats = s_control_stats;
+}
+
+void control_task_reset_max(){
+    s_control_stats.max_latency_us = 0;
+    s_control_stats.max_exec_us = 0;
+}
+
+void control_task_print_stats(){
+    hw_DebugPrint("*** control cycles %u overruns %u latency %u/%u us exec %u/%u us\n",
+        s_control_stats.cycles, s_control_stats.overruns,
+        s_control_stats.last_latency_us, s_control_stats.max_latency_us,
+        s_control_stats.last_exec_us, s_control_stats.max_exec_us);
+}
+
+// my_uart.h
+
+void uart_init(){
+}
+
+void uart_loop(){
+}
+
+void uart_print_stats(){
+}
+
+void uart_send_loop_message(int millis){
+    (void)millis;
+}
+
+void uart_send_message_aux(int touch){
+    (void)touch;
+}
+
+void uart_send_message(char * c){
+    (void)c;
+}
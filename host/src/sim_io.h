@@ -0,0 +1,32 @@
+#ifndef HOST_SIM_IO_H_
+#define HOST_SIM_IO_H_
+
+#include <stdint.h>
+
+#include "lemca/adc/adc_sampler.h"
+#include "lemca/valve/valve_output.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Simulated hardware of the host build, behind the headers of the target:
+//  adc_sampler.h   the filtered values are set by the simulation
+//  valve_output.h  the duties are kept for the simulation
+//  control_task.h  no timer task, the host loop calls control_task_host_step()
+//  my_uart.h       no serial port, IMU frames can be given to imu_parse()
+
+// values returned by adc_sampler_read() from now on, 12 bits scale
+void sim_io_set_adc(const int32_t raw[AdcSensor_count], int64_t timestamp_us);
+// last duties written by valve_output_write(), 0..VALVE_DUTY_MAX
+void sim_io_get_duty(uint32_t duty[Valve_count]);
+
+// runs lemca_control_step() for the tick of tick_us and times it like the
+// control task does
+void control_task_host_step(int64_t tick_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,114 @@
+#include "sim_time.h"
+
+#include <time.h>
+
+#include "esp_timer.h"
+
+#include "AppCommon/AppHW.h"
+
+typedef struct {
+    int64_t at_us;
+    int64_t period_us;
+    SimEventFn fn;
+    void * ctx;
+    uint32_t order;     // ties, order of sim_time_add()
+} SimEvent;
+
+static SimEvent s_events[SIM_MAX_EVENTS];
+static int s_n_events = 0;
+static uint32_t s_order = 0;
+static int s_virtual = 1;
+static int s_stop = 0;
+static int64_t s_now_us = 0;
+static int64_t s_real_start_us = 0;
+static uint32_t s_events_run = 0;
+
+static int64_t sim_time_source(void){
+    if(s_virtual){
+        return s_now_us;
+    }
+    return esp_timer_get_time() - s_real_start_us;
+}
+
+void sim_time_init(int virtual_time){
+    s_virtual = virtual_time;
+    s_n_events = 0;
+    s_order = 0;
+    s_stop = 0;
+    s_now_us = 0;
+    s_events_run = 0;
+    s_real_start_us = esp_timer_get_time();
+    hw_SetTimeSource(sim_time_source);
+}
+
+int64_t sim_time_now_us(void){
+    return sim_time_source();
+}
+
+int sim_time_add(int64_t at_us, int64_t period_us, SimEventFn fn, void * ctx){
+    if(s_n_events == SIM_MAX_EVENTS){
+        return 0;
+    }
+    SimEvent * e = &s_events[s_n_events++];
+    e->at_us = at_us;
+    e->period_us = period_us;
+    e->fn = fn;
+    e->ctx = ctx;
+    e->order = s_order++;
+    return 1;
+}
+
+// a few periodic events: a linear search beats a heap
+static int sim_time_next(void){
+    int next = 0;
+    for(int i = 1; i < s_n_events; ++i){
+        const SimEvent * e = &s_events[i];
+        const SimEvent * n = &s_events[next];
+        if(e->at_us < n->at_us || (e->at_us == n->at_us && e->order < n->order)){
+            next = i;
+        }
+    }
+    return next;
+}
+
+static void sim_time_sleep_until(int64_t t_us){
+    int64_t wait_us = t_us - sim_time_source();
+    if(wait_us > 0){
+        struct timespec ts = { (time_t)(wait_us / 1000000), (long)(wait_us % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+void sim_time_run(int64_t end_us){
+    s_stop = 0;
+    while(!s_stop && s_n_events > 0){
+        int i = sim_time_next();
+        SimEvent e = s_events[i];
+        if(e.at_us > end_us){
+            break;
+        }
+        if(e.period_us > 0){
+            s_events[i].at_us += e.period_us;
+        } else {
+            s_events[i] = s_events[--s_n_events];
+        }
+        if(s_virtual){
+            s_now_us = e.at_us;
+        } else {
+            sim_time_sleep_until(e.at_us);
+        }
+        e.fn(e.ctx, e.at_us);
+        s_events_run++;
+    }
+    if(s_virtual && !s_stop && s_now_us < end_us){
+        s_now_us = end_us;
+    }
+}
+
+void sim_time_stop(void){
+    s_stop = 1;
+}
+
+uint32_t sim_time_events(void){
+    return s_events_run;
+}
@@ -0,0 +1,38 @@
+#ifndef HOST_SIM_TIME_H_
+#define HOST_SIM_TIME_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Clock and discrete-event scheduler of the host simulation.
+// In virtual time the clock (hw_SetTimeSource, so hw_GetTimeMs, CB_GetTimeMs
+// and the lemca clock) jumps from one event to the next: an hour of field
+// work runs in the time the code takes. In real time the scheduler sleeps
+// until each event like the superloop of App_Main.c.
+// Events at the same time run in the order they were added.
+
+#define SIM_MAX_EVENTS 16
+
+typedef void (*SimEventFn)(void * ctx, int64_t now_us);
+
+// installs the clock, starts at 0
+void sim_time_init(int virtual_time);
+int64_t sim_time_now_us(void);
+
+// first run at at_us then every period_us (0 = once), returns 0 when full
+int sim_time_add(int64_t at_us, int64_t period_us, SimEventFn fn, void * ctx);
+// runs the events until end_us or sim_time_stop()
+void sim_time_run(int64_t end_us);
+void sim_time_stop(void);
+
+// events run since sim_time_init()
+uint32_t sim_time_events(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
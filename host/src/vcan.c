@@ -0,0 +1,109 @@
+#include "vcan.h"
+
+#include <string.h>
+
+#include "AppCommon/AppHW.h"
+#include "lemca/common/spsc_ring.h"
+
+typedef struct {
+    const char * name;
+    SpscRing ring;
+    VcanFrame buf[VCAN_RX_RING_SIZE];
+    uint32_t sent;
+    uint32_t received;
+    uint64_t bits;
+} VcanNode;
+
+static VcanNode s_nodes[VCAN_MAX_NODES];
+static int s_num_nodes = 0;
+
+// extended frame: 67 bits of overhead + data, with the worst case stuffing
+// on the 54 bits of identifier, control, data and CRC that are stuffed
+uint32_t vcan_frame_bits(uint8_t dlc){
+    uint32_t stuffed = 54 + 8 * dlc;
+    return 67 + 8 * dlc + (stuffed - 1) / 4;
+}
+
+int vcan_open(const char * name){
+    if(s_num_nodes == VCAN_MAX_NODES){
+        return -1;
+    }
+    VcanNode * n = &s_nodes[s_num_nodes];
+    memset(n, 0, sizeof(*n));
+    n->name = name;
+    spsc_ring_init(&n->ring, n->buf, sizeof(VcanFrame), VCAN_RX_RING_SIZE);
+    return s_num_nodes++;
+}
+
+int vcan_send(int node, uint32_t id, const uint8_t * data, uint8_t dlc){
+    return vcan_send_at(node, id, data, dlc, hw_GetTimeUs());
+}
+
+int vcan_send_at(int node, uint32_t id, const uint8_t * data, uint8_t dlc, int64_t timestamp_us){
+    if(node < 0 || node >= s_num_nodes){
+        return 0;
+    }
+    VcanFrame frame;
+    frame.id = id & 0x1FFFFFFFu;
+    frame.dlc = dlc > 8 ? 8 : dlc;
+    memset(frame.data, 0xFF, sizeof(frame.data));
+    memcpy(frame.data, data, frame.dlc);
+    frame.timestamp_us = timestamp_us;
+
+    s_nodes[node].sent++;
+    s_nodes[node].bits += vcan_frame_bits(frame.dlc);
+    int delivered = 0;
+    for(int i = 0; i < s_num_nodes; ++i){
+        if(i != node){
+            delivered += spsc_ring_push(&s_nodes[i].ring, &frame, 1);
+        }
+    }
+    return delivered;
+}
+
+int vcan_receive(int node, VcanFrame * frame){
+    if(node < 0 || node >= s_num_nodes){
+        return 0;
+    }
+    if(spsc_ring_pop(&s_nodes[node].ring, frame, 1) != 1){
+        return 0;
+    }
+    s_nodes[node].received++;
+    return 1;
+}
+
+uint32_t vcan_pending(int node){
+    if(node < 0 || node >= s_num_nodes){
+        return 0;
+    }
+    return spsc_ring_count(&s_nodes[node].ring);
+}
+
+void vcan_get_stats(int node, VcanStats * stats){
+    memset(stats, 0, sizeof(*stats));
+    if(node < 0 || node >= s_num_nodes){
+        return;
+    }
+    const VcanNode * n = &s_nodes[node];
+    stats->sent = n->sent;
+    stats->received = n->received;
+    stats->dropped = n->ring.dropped;
+    stats->high_water = n->ring.high_water;
+    stats->bits = n->bits;
+}
+
+uint64_t vcan_busy_us(void){
+    uint64_t bits = 0;
+    for(int i = 0; i < s_num_nodes; ++i){
+        bits += s_nodes[i].bits;
+    }
+    return bits * 1000000 / VCAN_BITRATE;
+}
+
+void vcan_print_stats(void){
+    for(int i = 0; i < s_num_nodes; ++i){
+        const VcanNode * n = &s_nodes[i];
+        hw_DebugPrint("*** vcan %s sent %u received %u dropped %u high water %u/%u\n",
+            n->name, n->sent, n->received, n->ring.dropped, n->ring.high_water, VCAN_RX_RING_SIZE);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef HOST_VCAN_H_
+#define HOST_VCAN_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// In-process virtual CAN bus of the host build. Each node (the ECU, the
+// simulated tractor, a bus monitor...) has its own receive ring; a frame
+// sent by one node is delivered to all the others, stamped with
+// esp_timer_get_time() like the RX task of the ESP driver does.
+
+#define VCAN_MAX_NODES 4
+#define VCAN_RX_RING_SIZE 1024      // power of 2, per node
+#define VCAN_BITRATE 250000         // ISOBUS, used for the bus load
+
+typedef struct {
+    uint32_t id;            // 29 bits identifier
+    uint8_t dlc;
+    uint8_t data[8];
+    int64_t timestamp_us;
+} VcanFrame;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t received;
+    uint32_t dropped;       // frames lost because the ring of this node was full
+    uint32_t high_water;
+    uint64_t bits;          // bus time of the frames sent, stuff bits included (worst case)
+} VcanStats;
+
+// returns the node index, -1 when all the nodes are taken
+int vcan_open(const char * name);
+
+// returns the number of nodes the frame was delivered to
+int vcan_send(int node, uint32_t id, const uint8_t * data, uint8_t dlc);
+// same, stamped with the end of its transmission by a TX queue model
+int vcan_send_at(int node, uint32_t id, const uint8_t * data, uint8_t dlc, int64_t timestamp_us);
+// returns 1 when a frame was read
+int vcan_receive(int node, VcanFrame * frame);
+uint32_t vcan_pending(int node);
+
+// bus time of a frame, stuff bits included (worst case)
+uint32_t vcan_frame_bits(uint8_t dlc);
+
+void vcan_get_stats(int node, VcanStats * stats);
+// bus time of all the frames sent since the start, us
+uint64_t vcan_busy_us(void);
+void vcan_print_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
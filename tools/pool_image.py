@@ -0,0 +1,34 @@
+#!/usr/bin/env python3
+"""Image of the raw "pools" partition, read in place by PoolPartition.c.
+
+    pool_image.py <pool.iop> <pools.bin> [partition size]
+
+Layout, little endian:
+    u32 magic 'LPOL'
+    u32 size of the pool
+    u32 crc32 of the pool (zlib, = esp_rom_crc32_le(0, ...))
+    u32 reserved, 0xFFFFFFFF
+    pool
+"""
+
+import struct
+import sys
+import zlib
+
+POOL_IMAGE_MAGIC = 0x4C4F504C  # "LPOL"
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit(__doc__)
+    with open(sys.argv[1], "rb") as f:
+        pool = f.read()
+    image = struct.pack("<IIII", POOL_IMAGE_MAGIC, len(pool), zlib.crc32(pool) & 0xFFFFFFFF, 0xFFFFFFFF) + pool
+    if len(sys.argv) > 3 and len(image) > int(sys.argv[3], 0):
+        sys.exit("pool_image.py: %s does not fit the partition (%i > %s bytes)" % (sys.argv[1], len(image), sys.argv[3]))
+    with open(sys.argv[2], "wb") as f:
+        f.write(image)
+
+
+if __name__ == "__main__":
+    main()